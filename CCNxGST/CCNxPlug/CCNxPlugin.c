@@ -40,6 +40,9 @@
 #include "ccnxsrc.h"
 #include "ccnxsink.h"
 
+#include <stdlib.h>
+#include <openssl/crypto.h>
+
 #ifdef WIN32
 #include <windows.h>
 #include <winsock2.h>
@@ -57,6 +60,79 @@ _get_output_format (void)
 #endif
 
 
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+static GMutex **crypto_locks = NULL;    /**< the locks libcrypto asks us for, by number */
+
+/**
+ * Takes or releases one of libcrypto's locks
+ *
+ * \param mode		CRYPTO_LOCK to take the lock, otherwise it is released
+ * \param n		number of the lock
+ * \param file		source file asking, unused
+ * \param line		source line asking, unused
+ */
+static void
+crypto_lock (int mode, int n, const char *file, int line)
+{
+  if (mode & CRYPTO_LOCK)
+    g_mutex_lock (crypto_locks[n]);
+  else
+    g_mutex_unlock (crypto_locks[n]);
+}
+
+#if OPENSSL_VERSION_NUMBER < 0x10000000L
+/**
+ * Tells libcrypto which thread is calling
+ *
+ * \return an identifier for the calling thread
+ */
+static unsigned long
+crypto_thread_id (void)
+{
+  return (unsigned long) g_thread_self ();
+}
+#else
+/**
+ * Tells libcrypto which thread is calling
+ *
+ * \param id		where we set the identifier for the calling thread
+ */
+static void
+crypto_thread_id (CRYPTO_THREADID * id)
+{
+  CRYPTO_THREADID_set_pointer (id, g_thread_self ());
+}
+#endif
+#endif
+
+/**
+ * Makes libcrypto safe to use from several threads at once
+ *
+ * Before 1.1, OpenSSL leaves its locking to the application. ccnxsrc checks signatures
+ * on a pool of worker threads, so unless the application has done so already we install
+ * the callbacks here, once, for as long as the process lives.
+ */
+static void
+crypto_threads_init (void)
+{
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+  int i;
+
+  if (crypto_locks || CRYPTO_get_locking_callback ())
+    return;
+  if ((crypto_locks = calloc (CRYPTO_num_locks (), sizeof (GMutex *))) == NULL)
+    return;
+  for (i = 0; i < CRYPTO_num_locks (); ++i)
+    crypto_locks[i] = g_mutex_new ();
+#if OPENSSL_VERSION_NUMBER < 0x10000000L
+  CRYPTO_set_id_callback (crypto_thread_id);
+#else
+  CRYPTO_THREADID_set_callback (crypto_thread_id);
+#endif
+  CRYPTO_set_locking_callback (crypto_lock);
+#endif
+}
+
 /**
  * Entry point to initialize the plug-in
  *
@@ -66,6 +142,7 @@ _get_output_format (void)
 gboolean
 plug_init (GstPlugin * ccnx)
 {
+  crypto_threads_init ();
   if (!gst_element_register (ccnx, "ccnxsrc", GST_RANK_NONE, GST_TYPE_CCNXSRC))
     return FALSE;
   if (!gst_element_register (ccnx, "ccnxsink", GST_RANK_NONE,
@@ -0,0 +1,222 @@
+/** \file capture.c
+ * \brief Capture files of received content objects, for replaying traffic without a network
+ *
+ * A capture is written by the thread receiving the content, so each record is a single
+ * buffered write; nothing is parsed or copied on the way in. Reading back hands each
+ * object over exactly as it arrived, with the time it arrived.
+ */
+/*
+ * GStreamer-CCNx, capture files
+ * Copyright (C) 2009, 2010 Alcatel-Lucent Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#ifdef WIN32
+#include "StdAfx.h"
+#endif
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "conf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "capture.h"
+
+/**
+ * Largest object we accept when reading back; anything bigger means the file is damaged
+ */
+#define CAPTURE_MAX_OBJECT (1024 * 1024)
+
+/**
+ * \brief An open capture file
+ */
+struct ccn_capture {
+  FILE *f;                      /**< the file, written or read through stdio's buffering */
+};
+
+/**
+ * Opens a capture file and checks or writes its magic
+ *
+ * \param path		file to open
+ * \param mode		fopen() mode
+ * \return the capture, NULL on failure
+ */
+static struct ccn_capture *
+capture_fopen (const char *path, const char *mode)
+{
+  struct ccn_capture *cap;
+  char magic[CAPTURE_MAGIC_SIZE];
+  int ok;
+
+  cap = calloc (1, sizeof (*cap));
+  if (NULL == cap)
+    return NULL;
+  cap->f = fopen (path, mode);
+  if (NULL == cap->f) {
+    free (cap);
+    return NULL;
+  }
+  if ('w' == mode[0])
+    ok = fwrite (CAPTURE_MAGIC, CAPTURE_MAGIC_SIZE, 1, cap->f) == 1;
+  else
+    ok = fread (magic, CAPTURE_MAGIC_SIZE, 1, cap->f) == 1
+        && 0 == memcmp (magic, CAPTURE_MAGIC, CAPTURE_MAGIC_SIZE);
+  if (!ok)
+    capture_close (&cap);
+  return cap;
+}
+
+/**
+ * Creates a capture file, replacing any file of that name
+ *
+ * \param path		file to create
+ * \return the capture, NULL if the file could not be created
+ */
+struct ccn_capture *
+capture_create (const char *path)
+{
+  return capture_fopen (path, "wb");
+}
+
+/**
+ * Opens a capture file to be read back
+ *
+ * \param path		file to read
+ * \return the capture, NULL if the file could not be opened or is not a capture
+ */
+struct ccn_capture *
+capture_open (const char *path)
+{
+  return capture_fopen (path, "rb");
+}
+
+/**
+ * Appends one object to a capture
+ *
+ * \param cap		capture being written
+ * \param ns		nanoseconds since the capture was created that the object arrived
+ * \param ccnb		the object, as received
+ * \param size		its size
+ * \return 0, or -1 if the write failed
+ */
+int
+capture_write (struct ccn_capture *cap, uint64_t ns, const unsigned char *ccnb,
+    size_t size)
+{
+  unsigned char hdr[CAPTURE_RECORD_HEADER];
+  int i;
+
+  if (NULL == cap || NULL == ccnb)
+    return -1;
+  for (i = 0; i < 8; ++i)
+    hdr[i] = ns >> (56 - 8 * i);
+  for (i = 0; i < 4; ++i)
+    hdr[8 + i] = size >> (24 - 8 * i);
+  if (fwrite (hdr, sizeof (hdr), 1, cap->f) != 1
+      || fwrite (ccnb, size, 1, cap->f) != 1)
+    return -1;
+  return 0;
+}
+
+/**
+ * Reads the next object of a capture
+ *
+ * \param cap		capture being read
+ * \param ns		where we return when the object arrived
+ * \param out		where we return the object, replacing what it held
+ * \return 1 when an object was read, 0 at the end of the file, -1 if the file is damaged
+ */
+int
+capture_read (struct ccn_capture *cap, uint64_t * ns, struct ccn_charbuf *out)
+{
+  unsigned char hdr[CAPTURE_RECORD_HEADER];
+  unsigned char *p;
+  size_t size = 0;
+  size_t got;
+  int i;
+
+  if (NULL == cap || NULL == out)
+    return -1;
+  got = fread (hdr, 1, sizeof (hdr), cap->f);
+  if (0 == got)
+    return 0;
+  if (got != sizeof (hdr))
+    return -1;
+  *ns = 0;
+  for (i = 0; i < 8; ++i)
+    *ns = (*ns << 8) | hdr[i];
+  for (i = 0; i < 4; ++i)
+    size = (size << 8) | hdr[8 + i];
+  if (size > CAPTURE_MAX_OBJECT)
+    return -1;
+  out->length = 0;
+  p = ccn_charbuf_reserve (out, size);
+  if (NULL == p || fread (p, 1, size, cap->f) != size)
+    return -1;
+  out->length = size;
+  return 1;
+}
+
+/**
+ * Goes back to the first object of a capture being read
+ *
+ * \param cap		capture being read
+ * \return 0, or -1 if the file cannot be repositioned
+ */
+int
+capture_rewind (struct ccn_capture *cap)
+{
+  if (NULL == cap)
+    return -1;
+  return fseek (cap->f, CAPTURE_MAGIC_SIZE, SEEK_SET);
+}
+
+/**
+ * Pushes the records written so far out to the file
+ *
+ * Called now and then by the thread writing the capture, so that little is lost should
+ * the element never be cleaned up.
+ *
+ * \param cap		capture being written, may be NULL
+ */
+void
+capture_flush (struct ccn_capture *cap)
+{
+  if (cap)
+    fflush (cap->f);
+}
+
+/**
+ * Flushes and closes a capture file, and frees its state
+ *
+ * \param capp		the capture to close; set to NULL
+ */
+void
+capture_close (struct ccn_capture **capp)
+{
+  struct ccn_capture *cap = *capp;
+
+  if (NULL == cap)
+    return;
+  fclose (cap->f);
+  free (cap);
+  *capp = NULL;
+}
@@ -0,0 +1,89 @@
+/** \file capture.h
+
+\brief Capture files of received content objects, for replaying traffic without a network
+
+*/
+/*
+ * GStreamer-CCNx, interface GStreamer media flow with a CCNx network
+ * Copyright (C) 2009, 2010 Alcatel-Lucent Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include <ccn/charbuf.h>
+
+/**
+ * The first bytes of every capture file
+ *
+ * It is followed by one record per content object: the arrival time in nanoseconds since
+ * the capture was opened, as 8 bytes, the size of the object as 4 bytes, both most
+ * significant byte first, and then the ccnb encoded object itself.
+ */
+#define CAPTURE_MAGIC		"CCNXCAP1"
+
+/**
+ * Size of the magic at the start of the file
+ */
+#define CAPTURE_MAGIC_SIZE	8
+
+/**
+ * Size of the header in front of each object
+ */
+#define CAPTURE_RECORD_HEADER	12
+
+/**
+ * Opaque capture file state; see capture.c
+ */
+struct ccn_capture;
+
+/*
+ * Create a capture file, replacing any file of that name, or open one to be read back.
+ * Both return NULL if the file cannot be opened, or is not a capture file.
+ */
+struct ccn_capture* capture_create( const char *path );
+struct ccn_capture* capture_open( const char *path );
+
+/*
+ * Append one object that arrived when ns nanoseconds into the capture.
+ * Returns 0, or -1 if the write failed.
+ */
+int capture_write( struct ccn_capture *cap, uint64_t ns, const unsigned char *ccnb, size_t size );
+
+/*
+ * Read the next object into out, replacing what it held, and when it arrived into *ns.
+ * Returns 1 when an object was read, 0 at the end of the file, -1 if the file is damaged.
+ */
+int capture_read( struct ccn_capture *cap, uint64_t *ns, struct ccn_charbuf *out );
+
+/*
+ * Go back to the first object of a capture being read.
+ */
+int capture_rewind( struct ccn_capture *cap );
+
+/*
+ * Push what has been written so far out to the file; a NULL capture is ignored.
+ */
+void capture_flush( struct ccn_capture *cap );
+
+/*
+ * Flush and close the file, and free the state.
+ */
+void capture_close( struct ccn_capture **capp );
+
+#endif
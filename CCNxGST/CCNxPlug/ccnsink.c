@@ -45,6 +45,9 @@
 #include <limits.h>
 #include <stdlib.h>
 #include "utils.h"
+#include "segenc.h"
+#include "trace.h"
+#include "probes.h"
 
 /**
  * Delcare debugging structure types
@@ -75,6 +78,22 @@ GST_DEBUG_CATEGORY_STATIC (gst_ccnxsink_debug);
  * I forget what this timeout is for
  */
 #define CCN_HEADER_TIMEOUT 400
+/**
+ * Bytes reserved in the charbufs we publish from; a chunk plus room for its name and signature
+ */
+#define CCN_POOL_RESERVE (CCN_CHUNK_SIZE + 2048)
+/**
+ * Number of idle charbufs we keep around for reuse
+ */
+#define CCN_POOL_MAX 4
+/**
+ * By default no statistics messages are posted
+ */
+#define CCNX_DEFAULT_STATS_INTERVAL 0
+/**
+ * By default no parity segments are published
+ */
+#define CCNX_DEFAULT_FEC 0
 
 
 /**
@@ -90,7 +109,8 @@ enum
  */
 enum
 {
-  PROP_0, PROP_URI, PROP_SILENT
+  PROP_0, PROP_URI, PROP_SILENT, PROP_ALLOCATIONS, PROP_STATS,
+  PROP_STATS_INTERVAL, PROP_LATENCY, PROP_RESET_LATENCY, PROP_FEC
 };
 
 /**
@@ -147,6 +167,7 @@ static void gst_ccnxsink_init (Gstccnxsink * me, GstccnxsinkClass * gclass);
 static void gst_ccnxsink_finalize (GObject * object);
 static gboolean gst_ccnxsink_start (GstBaseSink * bsrc);
 static gboolean gst_ccnxsink_stop (GstBaseSink * sink);
+static gboolean gst_ccnxsink_event (GstBaseSink * sink, GstEvent * event);
 
 static void gst_ccnxsink_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
@@ -156,6 +177,10 @@ static GstCaps *gst_ccnxsink_getcaps (GstBaseSink * src);
 
 static GstFlowReturn gst_ccnxsink_publish (GstBaseSink * sink, GstBuffer * buf);
 
+static GstStructure *gst_ccnxsink_stats (Gstccnxsink * me);
+
+static GstStructure *gst_ccnxsink_latency (Gstccnxsink * me);
+
 /**
  * The first function called which typically performs environmental initialization
  *
@@ -249,10 +274,42 @@ gst_ccnxsink_class_init (GstccnxsinkClass * klass)
       g_param_spec_boolean ("silent", "Silent", "Produce verbose output ?",
           FALSE, G_PARAM_READWRITE));
 
+  g_object_class_install_property (gobject_class, PROP_ALLOCATIONS,
+      g_param_spec_uint64 ("allocations", "Allocations",
+          "Number of message buffers allocated while publishing; steady once warmed up",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Counters describing how publishing is going, as a ccnxsink-stats structure",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_STATS_INTERVAL,
+      g_param_spec_uint ("stats-interval", "Statistics interval",
+          "Msecs between ccnxsink-stats element messages (0 = none)",
+          0, G_MAXUINT, CCNX_DEFAULT_STATS_INTERVAL, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_LATENCY,
+      g_param_spec_boxed ("latency", "Latency",
+          "Histogram of the latency from a buffer being rendered to its data being put, as a ccnxsink-latency structure",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_RESET_LATENCY,
+      g_param_spec_boolean ("reset-latency", "Reset latency",
+          "Setting this clears the latency histogram", FALSE,
+          G_PARAM_WRITABLE));
+
+  g_object_class_install_property (gobject_class, PROP_FEC,
+      g_param_spec_uint ("fec", "FEC",
+          "Segments covered by each XOR parity segment published next to them; receivers"
+          " rebuild a lost one without asking again (0 = no parity)",
+          0, CCN_FEC_MAX_GROUP, CCNX_DEFAULT_FEC, G_PARAM_READWRITE));
+
   /* Now setup the call-back functions for our lifecycle */
   gobject_class->finalize = gst_ccnxsink_finalize;
   gstbasesink_class->start = gst_ccnxsink_start;
   gstbasesink_class->stop = gst_ccnxsink_stop;
+  gstbasesink_class->event = gst_ccnxsink_event;
   gstbasesink_class->get_times = NULL;
   gstbasesink_class->get_caps = gst_ccnxsink_getcaps;
   gstbasesink_class->render = gst_ccnxsink_publish;     // Here in particular is where we process data from the pipeline
@@ -279,19 +336,35 @@ gst_ccnxsink_init (Gstccnxsink * me,
   me->silent = FALSE;
   me->uri = g_strdup (CCNX_DEFAULT_URI);
   me->name = NULL;
+  me->seqname = NULL;
   me->keylocator = NULL;
   me->keystore = NULL;
   me->ts = GST_CLOCK_TIME_NONE;
   me->temp = NULL;
-  me->partial = NULL;
+  me->n_views = 0;
+  me->view_bytes = 0;
+  me->segenc = NULL;
   me->lastPublish = NULL;
   me->signed_info = NULL;
+  me->pool = NULL;
   me->keylocator = NULL;
   me->keystore = NULL;
   memcpy (&(me->sp), &CCNX_DEFAULT_SIGNING_PARAMS,
       sizeof (CCNX_DEFAULT_SIGNING_PARAMS));
   me->expire = CCNX_DEFAULT_EXPIRATION;
   me->segment = 0;
+  me->gop_next = 0;
+  me->n_gops = 0;
+  me->gop_meta = ccn_charbuf_create ();
+  me->fec = CCNX_DEFAULT_FEC;
+  me->fec_seqname = NULL;
+  me->fec_parity = ccn_charbuf_create ();
+  me->stats_interval = CCNX_DEFAULT_STATS_INTERVAL;
+  me->stats_posted = 0;
+  memset (&me->stats, 0, sizeof (me->stats));
+  histo_clear (&me->lat_put);
+  me->stopping = FALSE;
+  me->ending = FALSE;
   me->fifo_head = 0;
   me->fifo_tail = 0;
   me->buf = gst_buffer_new_and_alloc (CCN_FIFO_BLOCK_SIZE);
@@ -354,10 +427,12 @@ fifo_empty (Gstccnxsink * me)
  * \param me		element context where the fifo is kept
  * \param buf		the buffer we are to put on the queue
  * \param overwrite	flag indicating if we should throw away data [true] or wait [false] when the queue is full
+ * \param rendered	when the pipeline handed us the buffer
  * \return true if the put succeeded, false otherwise
  */
 static gboolean
-fifo_put (Gstccnxsink * me, GstBuffer * buf, int overwrite)
+fifo_put (Gstccnxsink * me, GstBuffer * buf, int overwrite,
+    GstClockTime rendered)
 {
   int next;
 
@@ -376,6 +451,7 @@ fifo_put (Gstccnxsink * me, GstBuffer * buf, int overwrite)
         /* need to release the buffer prior to the overwrite, or memory will leak */
         gst_buffer_unref (me->fifo[me->fifo_head]);
         me->fifo_head = h;
+        me->stats.fifo_drops++;
         GST_LOG_OBJECT (me, "fifo put: overwriting a buffer");
       }
     } else {
@@ -388,6 +464,7 @@ fifo_put (Gstccnxsink * me, GstBuffer * buf, int overwrite)
     GST_DEBUG ("FIFO: queue is OK");
   }
   me->fifo[me->fifo_tail] = buf;
+  me->fifo_rendered[me->fifo_tail] = rendered;
   me->fifo_tail = next;
   return TRUE;
 }
@@ -403,11 +480,12 @@ fifo_put (Gstccnxsink * me, GstBuffer * buf, int overwrite)
  * \todo we can be smarter here and only use the lock if the queue is full.
  *
  * \param me		element context where the fifo is kept
+ * \param rendered	where we return when the pipeline handed us the buffer
  * \return buffer containing the next element, NULL if the queue is empty
  */
 /*@null@*/
 static GstBuffer *
-fifo_pop (Gstccnxsink * me)
+fifo_pop (Gstccnxsink * me, GstClockTime * rendered)
 {
   GstBuffer *ans;
   int next;
@@ -417,6 +495,7 @@ fifo_pop (Gstccnxsink * me)
   }
   next = me->fifo_head;
   ans = me->fifo[next];
+  *rendered = me->fifo_rendered[next];
   if (++next >= CCNX_SINK_FIFO_MAX)
     next = 0;
   g_mutex_lock (me->fifo_lock);
@@ -485,6 +564,192 @@ makeTimespec (GstClockTime t, struct timespec *ts)
   ts->tv_nsec = t % A_BILLION;
 }
 
+/**
+ * Release the buffer views making up the chunk we were assembling
+ *
+ * \param me		element context holding the views
+ */
+static void
+release_views (Gstccnxsink * me)
+{
+  gint i;
+
+  for (i = 0; i < me->n_views; ++i)
+    gst_buffer_unref (me->views[i].buf);
+  me->n_views = 0;
+  me->view_bytes = 0;
+}
+
+/**
+ * Copy the views of a chunk together into one buffer
+ *
+ * Only needed when a chunk is made of more, very small, pipeline buffers than
+ * we have room to keep views of.
+ *
+ * \param me		element context holding the views
+ */
+static void
+coalesce_views (Gstccnxsink * me)
+{
+  GstBuffer *buf;
+  GstClockTime rendered = me->views[0].rendered;
+  guint off = 0;
+  gint i;
+
+  buf = gst_buffer_new_and_alloc (me->view_bytes);
+  for (i = 0; i < me->n_views; ++i) {
+    memcpy (GST_BUFFER_DATA (buf) + off,
+        GST_BUFFER_DATA (me->views[i].buf) + me->views[i].offset,
+        me->views[i].size);
+    off += me->views[i].size;
+  }
+  release_views (me);
+  me->views[0].buf = buf;
+  me->views[0].offset = 0;
+  me->views[0].size = off;
+  me->views[0].rendered = rendered;
+  me->n_views = 1;
+  me->view_bytes = off;
+}
+
+/**
+ * Sign and send out the parity segment of a group of segments
+ *
+ * The parity is the XOR of the sizes of the group's payloads, followed by the XOR of the
+ * payloads themselves. A receiver missing any one segment of the group rebuilds it from
+ * the others and the parity, rather than asking for it again. The group size goes in
+ * front, in CCN_FEC_GROUP_BYTES, so a receiver counting groups differently can tell.
+ *
+ * \param me		element context holding the parity
+ * \param group		number of the group; its first segment divided by the fec attribute
+ * \return a GST flow return value indicating the result of our attempt
+ */
+static GstFlowReturn
+publish_parity (Gstccnxsink * me, long group)
+{
+  struct ccn_segview sv[2];
+  unsigned char k[CCN_FEC_GROUP_BYTES];
+  struct ccn_charbuf *sname;
+  struct ccn_charbuf *temp;
+  gint rc = -1;
+
+  k[0] = me->fec;
+  sv[0].data = k;
+  sv[0].size = sizeof (k);
+  sv[1].data = me->fec_parity->buf;
+  sv[1].size = me->fec_parity->length;
+  sname = seqname_encode (me->fec_seqname, group);
+  temp = charbuf_pool_get (me->pool);
+  if (sname && temp)
+    rc = segenc_encode (me->segenc, temp, sname, sv, 2);
+  me->fec_parity->length = 0;
+  if (rc >= 0)
+    rc = ccn_put (me->ccn, temp->buf, temp->length);
+  if (rc < 0) {
+    GST_LOG_OBJECT (me, "parity of group %ld not sent (rc == %d)\n", group,
+        rc);
+    charbuf_pool_put (me->pool, &temp);
+    return GST_FLOW_ERROR;
+  }
+  me->stats.puts++;
+  me->stats.parity++;
+  charbuf_pool_put (me->pool, &temp);
+  return GST_FLOW_OK;
+}
+
+/**
+ * Name, sign and send out the chunk held in the buffer views
+ *
+ * The message is encoded straight from the pipeline buffers' memory, so a chunk
+ * straddling two buffers is not copied together first.
+ *
+ * \param me		element context holding the views
+ * \return a GST flow return value indicating the result of our attempt
+ */
+static GstFlowReturn
+publish_views (Gstccnxsink * me)
+{
+  struct ccn_segview sv[CCNX_SINK_MAX_VIEWS];   /* the pieces of the chunk */
+  struct ccn_charbuf *sname;    /* name of this data message, owned by the name encoder */
+  struct ccn_charbuf *temp;     /* where we construct the message to send */
+  GstClockTime rendered = me->views[0].rendered;        /* when the oldest piece reached us */
+  GstClockTime start;
+  size_t off;
+  long seg;
+  gint rc;
+  gint i;
+
+  for (i = 0; i < me->n_views; ++i) {
+    sv[i].data = GST_BUFFER_DATA (me->views[i].buf) + me->views[i].offset;
+    sv[i].size = me->views[i].size;
+  }
+  if (me->fec > 0) {
+    for (i = 0, off = 0; i < me->n_views; ++i) {
+      fec_fold (me->fec_parity, CCN_FEC_HEADER + off, sv[i].data, sv[i].size);
+      off += sv[i].size;
+    }
+    fec_fold_size (me->fec_parity, off);
+  }
+  seg = me->segment++;
+  sname = seqname_encode (me->seqname, seg);
+  temp = charbuf_pool_get (me->pool);
+  if (NULL == sname || NULL == temp)
+    goto Trouble;
+
+  start = gst_util_get_timestamp ();
+  CCNX_PROBE2 (sign_start, seg, me->view_bytes);
+  rc = segenc_encode (me->segenc, temp, sname, sv, me->n_views);
+  CCNX_PROBE2 (sign_end, seg, temp->length);
+  release_views (me);
+  if (rc < 0) {
+    GST_LOG_OBJECT (me, "encoding failed\n");
+    goto Trouble;
+  }
+  me->stats.sign_time += gst_util_get_timestamp () - start;
+  me->stats.segments++;
+  rc = ccn_put (me->ccn, temp->buf, temp->length);
+  CCNX_PROBE3 (ccn_put, seg, temp->length, rc);
+  if (rc < 0) {
+    GST_LOG_OBJECT (me, "ccn_put failed (rc == %d)\n", rc);
+    goto Trouble;
+  }
+  me->stats.puts++;
+  if (GST_CLOCK_TIME_NONE != rendered)
+    histo_record (&me->lat_put, gst_util_get_timestamp () - rendered);
+
+  /* keep the last block published, giving back the one before */
+  charbuf_pool_put (me->pool, &me->lastPublish);
+  me->lastPublish = temp;
+
+  /* the group is complete, send its parity along right behind it */
+  if (me->fec > 0 && 0 == (seg + 1) % me->fec)
+    return publish_parity (me, seg / me->fec);
+  return GST_FLOW_OK;
+
+Trouble:
+  release_views (me);
+  charbuf_pool_put (me->pool, &temp);
+  return GST_FLOW_ERROR;
+}
+
+/**
+ * Send out what the stream ended with
+ *
+ * The chunk still being assembled goes out short, and a group of segments the stream
+ * ended part way through gets its parity all the same, covering the segments it has.
+ * Once that is done there is nothing left to send, so calling this again does nothing.
+ *
+ * \param me		element context holding the views and the parity
+ */
+static void
+publish_tail (Gstccnxsink * me)
+{
+  if (me->n_views > 0 && GST_FLOW_OK != publish_views (me))
+    GST_LOG_OBJECT (me, "the last segment was not sent");
+  if (me->fec > 0 && me->fec_parity->length > 0)
+    publish_parity (me, (me->segment - 1) / me->fec);
+}
+
 /**
  * Send out a message onto the CCNx network
  *
@@ -493,205 +758,64 @@ makeTimespec (GstClockTime t, struct timespec *ts)
  * The CCN stack dictates that all data content messages must contain
  * a proper name, and be signed by the sender.
  * \todo some day we should also encrypt the data; I don't think it is now
- * Much of the information we need to accomplish the message preperation is
- * found in the element context or as one of the parameters.
  *
  * Most of the work is dealing with changing from the internal buffer size and
  * the message size of the CCN network.
  * We chop things up as needed and send each data message out, properly named and signed.
- * The naming will include the timestamp as well as a segment number.
- * If there are some partial bytes left over, that do not fill a CCN message packet,
- * we retain those to be sent out on the next call to this method.
- * The bytes are kept in the element context as is other pertinent information.
- *
- * \param me
- * \param data		pointer to the data buffer to send
- * \param size		number of bytes to send in the message
+ * Rather than copying, we keep views into the pipeline buffers, holding a reference
+ * on each, until a chunk's worth has been gathered. Bytes left over that do not fill
+ * a CCN message packet stay in the views to be sent out on the next call to this method.
+ *
+ * \param me		element context
+ * \param buffer	the pipeline buffer holding the data to send
  * \param ts		timestamp to use on the outbound message
+ * \param rendered	when the pipeline handed us the buffer
  * \return a GST flow return value indicating the result of our attempt
  * \retval GST_FLOW_OK everything went well
  * \retval GST_FLOW_ERROR something went wrong
  */
 static GstFlowReturn
-gst_ccnxsink_send (Gstccnxsink * me, guint8 * data, guint size, /*@unused@ */
-    GstClockTime ts)
+gst_ccnxsink_send (Gstccnxsink * me, GstBuffer * buffer, /*@unused@ */
+    GstClockTime ts, GstClockTime rendered)
 {
-  struct ccn_charbuf *sname;    /* where we construct the name of this data message */
-  struct ccn_charbuf *hold;     /* holds the last block published so we can properly manage memory */
-  struct ccn_charbuf *temp;     /* where we construct the message to send */
-  struct ccn_charbuf *signed_info;      /* signing data within the message */
-  gint rc;                      /* return status on various calls */
-  guint8 *xferStart;            /* points into the source buffer, data, as we packetize into CCN blocks */
-  size_t bytesLeft;             /* keeps track of how much more we have to do */
-
-  /* Initialize our local storage and allocate buffers we will need */
-  xferStart = data;
-  bytesLeft = size;
-  sname = ccn_charbuf_create ();
-  temp = ccn_charbuf_create ();
-  signed_info = ccn_charbuf_create ();
-
-  /* Hang onto this pointer so we can release the buffer as we exit this function */
-  hold = me->lastPublish;
-
-/*
- * I am hanging onto this code for now to handle the day when we want to encode the data.
- * I do not know why id did not work during development, but I am sure it is close to working 8-)
- * In the future, feel free to purge this if we never get around to using it.
- * Similarly for the code block that is down below a little bit.
- *
-  if( me->keystore ) {
-    signed_info->length = 0;
-GST_LOG_OBJECT( me, "send - signing info\n" );
-    rc = ccn_signed_info_create(signed_info
-                                 , ccn_keystore_public_key_digest(me->keystore) //pubkeyid 
-                                 , ccn_keystore_public_key_digest_length(me->keystore) //publisher_key_id_size 
-                                 , NULL			//datetime
-                                 , CCN_CONTENT_DATA	//type
-                                 , me->expire		//freshness
-                                 , NULL			//finalblockid
-                                 , me->keylocator);
-    // Put the keylocator in the first block only. 
-    ccn_charbuf_destroy(&(me->keylocator));
-    if (rc < 0) {
-        GST_LOG_OBJECT(me, "Failed to create signed_info (rc == %d)\n", rc);
-        goto Trouble;
-    }
+  guint xferStart;              /* where we are in the source buffer, as we packetize into CCN blocks */
+  guint size;                   /* how much data the source buffer holds */
+  guint n;                      /* number of bytes going into the chunk being assembled */
+
+  xferStart = 0;
+  size = GST_BUFFER_SIZE (buffer);
+
+  /* note where each keyframe starts, so receivers can switch renditions at them */
+  if (GST_BUFFER_TIMESTAMP_IS_VALID (buffer)
+      && !GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT)) {
+    me->gops[me->gop_next].pts = GST_BUFFER_TIMESTAMP (buffer);
+    me->gops[me->gop_next].segment = me->segment;
+    me->gops[me->gop_next].offset = me->view_bytes;
+    me->gop_next = (me->gop_next + 1) % CCN_GOP_HISTORY;
+    if (me->n_gops < CCN_GOP_HISTORY)
+      me->n_gops++;
+    me->stats.keyframes++;
   }
-	*/
-
-  if (me->partial) {            /* We had some left over from the last send */
-    size_t extra;
-    uintmax_t seg;
 
-    /* find out how much room we have left, and copy over the bytes we have, or need to fill the block */
-    extra = CCN_CHUNK_SIZE - me->partial->length;
-    if (extra > bytesLeft)
-      extra = bytesLeft;
-    GST_LOG_OBJECT (me, "send - had a partial left: %d\n", extra);
-    ccn_charbuf_append (me->partial, xferStart, extra);
-
-    /* Adjust count and pointer to reflect the bytes we have taken */
-    bytesLeft -= extra;
-    xferStart += extra;
+  while (xferStart < size) {
+    n = MIN (CCN_CHUNK_SIZE - me->view_bytes, size - xferStart);
+    if (me->n_views == CCNX_SINK_MAX_VIEWS)
+      coalesce_views (me);
+    me->views[me->n_views].buf = gst_buffer_ref (buffer);
+    me->views[me->n_views].offset = xferStart;
+    me->views[me->n_views].size = n;
+    me->views[me->n_views].rendered = rendered;
+    me->n_views++;
+    me->view_bytes += n;
+    xferStart += n;
 
     /* Filling to the size of the CCN packet means we need to send it out */
-    if (me->partial->length == CCN_CHUNK_SIZE) {
-      sname->length = 0;
-      seg = me->segment++;
-
-      /* build up a name starting with the prefix, then the sequence number */
-      ccn_charbuf_append (sname, me->name->buf, me->name->length);
-      ccn_name_append_numeric (sname, CCN_MARKER_SEQNUM, seg);
-      temp->length = 0;
-
-      /* Signing via this function does a lot of work. The result is a buffer, temp, that is ready to be sent */
-      ccn_sign_content (me->ccn, temp, sname, &me->sp, me->partial->buf,
-          CCN_CHUNK_SIZE);
-      //  hDump( sname->buf, sname->length );
-      /*
-       * See the comment above about holding this code.
-       *
-       if( me->keystore ) {
-
-       rc = ccn_encode_ContentObject(temp,
-       sname,
-       signed_info,
-       me->partial->buf,
-       CCN_CHUNK_SIZE,
-       NULL,
-       ccn_keystore_private_key(me->keystore));
-       if (rc != 0) {
-       GST_LOG_OBJECT( me, "Failed to encode ContentObject (rc == %d)\n", rc);
-       goto Trouble;
-       }
-       */
-      /* send the data message on its way */
-      rc = ccn_put (me->ccn, temp->buf, temp->length);
-      if (rc < 0) {
-        GST_LOG_OBJECT (me, "ccn_put failed (rc == %d)\n", rc);
-        goto Trouble;
-      }
-      /* free the buffer we used for the partial data */
-      ccn_charbuf_destroy (&me->partial);
-      me->partial = NULL;
-/*
-} else {
-		GST_LOG_OBJECT( me, "No keystore. What should we do?\n" );
-		goto Trouble;
-	  }
-*/
-    }
-  }
-
-  /* No left over means we can send direct out of the data buffer */
-  /* Now that we are done with the partial block, go and process the new data in much the same fashion */
-  while (bytesLeft >= CCN_CHUNK_SIZE) {
-    uintmax_t seg;
-    GST_LOG_OBJECT (me, "send - bytesLeft: %d\n", bytesLeft);
-    sname->length = 0;
-    seg = me->segment++;
-    ccn_charbuf_append (sname, me->name->buf, me->name->length);
-    ccn_name_append_numeric (sname, CCN_MARKER_SEQNUM, seg);
-    GST_LOG_OBJECT (me, "send - name is ready\n");
-    temp->length = 0;
-
-    ccn_sign_content (me->ccn, temp, sname, &me->sp, xferStart, CCN_CHUNK_SIZE);
-    //  hDump( sname->buf, sname->length );
-    /*
-       if( me->keystore ) {
-
-       GST_LOG_OBJECT( me, "send - encoding\n" );
-       rc = ccn_encode_ContentObject(temp,
-       sname,
-       signed_info,
-       xferStart,
-       CCN_CHUNK_SIZE,
-       NULL,
-       ccn_keystore_private_key(me->keystore));
-       if (rc != 0) {
-       GST_LOG_OBJECT( me, "Failed to encode ContentObject (rc == %d)\n", rc);
-       goto Trouble;
-       }
-     */
-    GST_LOG_OBJECT (me, "send - putting\n");
-    rc = ccn_put (me->ccn, temp->buf, temp->length);
-    if (rc < 0) {
-      GST_LOG_OBJECT (me, "ccn_put failed (rc == %d)\n", rc);
-      goto Trouble;
-    }
-    /*
-       } else {
-       GST_LOG_OBJECT( me, "No keystore. What should we do?\n" );
-       goto Trouble;
-       }
-     */
-    GST_LOG_OBJECT (me, "send - adjusting buffers\n");
-    /* msleep(5); */
-    bytesLeft -= CCN_CHUNK_SIZE;
-    xferStart += CCN_CHUNK_SIZE;
-  }                             /* end of while() */
-
-  if (bytesLeft) {              /* We have some left over for next time */
-    GST_LOG_OBJECT (me, "send - for next time: %d\n", bytesLeft);
-    me->partial = ccn_charbuf_create ();
-    me->partial->length = 0;
-    ccn_charbuf_append (me->partial, xferStart, bytesLeft);
+    if (me->view_bytes == CCN_CHUNK_SIZE
+        && GST_FLOW_OK != publish_views (me))
+      return GST_FLOW_ERROR;
   }
-
-  /* Do proper memory management, then return */
-  ccn_charbuf_destroy (&sname);
-  me->lastPublish = temp;
-  ccn_charbuf_destroy (&hold);
-  ccn_charbuf_destroy (&signed_info);
-  GST_LOG_OBJECT (me, "send - leaving length: %d\n", me->lastPublish->length);
+  CCNX_TRACE_OBJECT (me, "send - for next time: %d", me->view_bytes);
   return GST_FLOW_OK;
-
-Trouble:
-  ccn_charbuf_destroy (&sname);
-  ccn_charbuf_destroy (&temp);
-  ccn_charbuf_destroy (&signed_info);
-  return GST_FLOW_ERROR;
 }
 
 /**
@@ -714,12 +838,13 @@ gst_ccnxsink_publish (GstBaseSink * sink, GstBuffer * buffer)
 {
   Gstccnxsink *me;
 
-  GST_DEBUG ("CCNxSink: publishing");
+  CCNX_TRACE ("CCNxSink: publishing");
 
   me = GST_CCNXSINK (sink);
 
   gst_buffer_ref (buffer);
-  fifo_put (me, buffer, TRUE);
+  CCNX_PROBE1 (sink_fifo_put, GST_BUFFER_SIZE (buffer));
+  fifo_put (me, buffer, TRUE, gst_util_get_timestamp ());
   return GST_FLOW_OK;
 }
 
@@ -732,6 +857,7 @@ gst_ccnxsink_publish (GstBaseSink * sink, GstBuffer * buffer)
  * Currently the things we produce are:
  * \li last block - we resend the last block we have published for a given name
  * \li last segment - we produce a data message that only contains the latest segment number we used
+ * \li keyframes - we produce a data message listing where the recent keyframes start, see gop_meta_append()
  *
  * \param	selfp		-> a context structure we created when registering this call-back
  * \param	kind		specifies the type of call-back being processed, see the \b switch statement
@@ -753,33 +879,23 @@ new_interests (struct ccn_closure *selfp,
   size_t sz1;
   size_t sz2;
   long lastSeq;
+  const void *meta;
+  size_t meta_size;
   struct ccn_signing_params myparams;
   unsigned int i;
   int rc;
 
 
-  GST_DEBUG ("something has arrived!");
-  GST_DEBUG ("matched is: %d", info->matched_comps);    // number of filter components that were matched by the interest
-  cb = interestAsUri (info);
-  GST_DEBUG ("as URI: %s", ccn_charbuf_as_string (cb));
-  ccn_charbuf_destroy (&cb);
+  /* only build the URI when somebody is going to read it */
+  if (CCNX_TRACE_ENABLED () && info && info->interest_ccnb) {
+    cb = interestAsUri (info);
+    CCNX_TRACE ("something has arrived! matched %d of %s",
+        info->matched_comps, ccn_charbuf_as_string (cb));
+    ccn_charbuf_destroy (&cb);
+  }
 
   myparams = me->sp;
 
-  /* Some debugging stuff */
-  for (i = 0; i < 10; ++i) {
-    const unsigned char *cp;
-    size_t sz;
-    GST_DEBUG ("%3d: ", i);
-    if (0 > ccn_name_comp_get (info->interest_ccnb, info->interest_comps, i,
-            &cp, &sz)) {
-      // fprintf(stderr, "could not get comp\n");
-      break;
-    } else {
-      // hDump( DUMP_ADDR( cp ), DUMP_SIZE( sz ) );
-    }
-  }
-
   switch (kind) {
 
     case CCN_UPCALL_FINAL:
@@ -824,7 +940,8 @@ new_interests (struct ccn_closure *selfp,
 
       /* Here is the most interesting case...when an interest arrives */
     case CCN_UPCALL_INTEREST:
-      GST_INFO ("We got an interest\n");
+      CCNX_TRACE ("We got an interest");
+      me->stats.interests++;
       myparams.freshness = 1;   /* meta data is old very quickly */
 
       /* See if any meta information is sought */
@@ -849,12 +966,24 @@ new_interests (struct ccn_closure *selfp,
       if (cp1) {
         // hDump( DUMP_ADDR(cp1), DUMP_SIZE(sz1) );
         // hDump( DUMP_ADDR(cp2), DUMP_SIZE(sz2) );
-        if (strncmp ((const char *) cp2, ".segment", 8))
+        if (sz2 >= 8 && 0 == strncmp ((const char *) cp2, ".segment", 8)) {
+          /* publish what segment we are up to in reply to the meta request */
+          lastSeq = me->segment - 1;
+          GST_INFO ("sending meta data....segment: %d", lastSeq);
+          meta = &lastSeq;
+          meta_size = sizeof (lastSeq);
+        } else if (sz2 >= 4 && 0 == strncmp ((const char *) cp2, ".gop", 4)) {
+          /* publish where the recent keyframes start, oldest first */
+          me->gop_meta->length = 0;
+          for (i = 0; i < me->n_gops; ++i)
+            gop_meta_append (me->gop_meta, &me->gops[(me->gop_next +
+                        CCN_GOP_HISTORY - me->n_gops + i) % CCN_GOP_HISTORY]);
+          GST_INFO ("sending meta data....%d keyframes", me->n_gops);
+          meta = me->gop_meta->buf;
+          meta_size = me->gop_meta->length;
+        } else
           goto Exit_Interest;   /* not a match */
-
-        /* publish what segment we are up to in reply to the meta request */
-        lastSeq = me->segment - 1;
-        GST_INFO ("sending meta data....segment: %d", lastSeq);
+        me->stats.meta_requests++;
 
         sname = ccn_charbuf_create ();
         ccn_name_init (sname);
@@ -866,7 +995,7 @@ new_interests (struct ccn_closure *selfp,
         // if (rc < 0) goto Error_Interest;
         me->temp->length = 0;
         rc = ccn_sign_content (me->ccn, me->temp, sname, &myparams,
-            &lastSeq, sizeof (lastSeq));
+            meta, meta_size);
         // hDump(DUMP_ADDR(sname->buf), DUMP_SIZE(sname->length));
         if (rc != 0) {
           GST_LOG_OBJECT (me, "Failed to encode ContentObject (rc == %d)\n",
@@ -882,6 +1011,7 @@ new_interests (struct ccn_closure *selfp,
           GST_LOG_OBJECT (me, "ccn_put failed (res == %d)\n", rc);
           goto Error_Interest;
         }
+        me->stats.puts++;
         GST_INFO ("meta data sent");
 
       } else
@@ -957,6 +1087,22 @@ setup_ccn (Gstccnxsink * me)
         ("ccn_create_version() failed"));
     return;
   }
+  if ((me->seqname = seqname_create (me->name)) == NULL) {
+    GST_ELEMENT_ERROR (me, RESOURCE, READ, (NULL), ("seqname alloc failed"));
+    return;
+  }
+  if (me->fec > 0) {
+    me->temp->length = 0;
+    ccn_charbuf_append_charbuf (me->temp, me->name);
+    ccn_name_append_str (me->temp, CCN_FEC_COMPONENT);
+    if ((me->fec_seqname = seqname_create (me->temp)) == NULL) {
+      GST_ELEMENT_ERROR (me, RESOURCE, READ, (NULL),
+          ("parity seqname alloc failed"));
+      return;
+    }
+    me->temp->length = 0;
+    me->fec_parity->length = 0;
+  }
 
 
   GST_DEBUG ("CCNxSink: setting up keystore");
@@ -965,6 +1111,10 @@ setup_ccn (Gstccnxsink * me)
      if( me->keystore ) me->keylocator = makeLocator( ccn_keystore_public_key(me->keystore) );
    */
   loadKey (me->ccn, &me->sp);
+  if ((me->segenc = segenc_create (me->ccn, &me->sp)) == NULL) {
+    GST_ELEMENT_ERROR (me, RESOURCE, READ, (NULL), ("segenc alloc failed"));
+    return;
+  }
   GST_DEBUG ("CCNxSink: done; have keys!");
 }
 
@@ -986,18 +1136,18 @@ static void
 check_fifo (Gstccnxsink * me)
 {
   GstClockTime ts;
+  GstClockTime rendered;
   gint i;
   guint size;
-  guint8 *data;
   GstBuffer *buffer;
 
   for (i = 0; i < 3; ++i) {
     if (fifo_empty (me))
       return;
-    if (!(buffer = fifo_pop (me)))
+    if (!(buffer = fifo_pop (me, &rendered)))
       return;
     size = GST_BUFFER_SIZE (buffer);
-    data = GST_BUFFER_DATA (buffer);
+    CCNX_PROBE1 (sink_fifo_pop, size);
     ts = 0;
 
     GST_INFO ("CCNxSink: pubish size: %d\n", size);
@@ -1009,12 +1159,81 @@ check_fifo (Gstccnxsink * me)
     }
 
     GST_INFO ("CCNxSink: pubish time: %0X\n", ts);
-    gst_ccnxsink_send (me, data, size, ts);
-    gst_buffer_unref (buffer);
+    gst_ccnxsink_send (me, buffer, ts, rendered);
+    gst_buffer_unref (buffer);  /* the views we kept hold their own references */
   }
 
 }
 
+/**
+ * Takes a snapshot of our counters
+ *
+ * The counters are read without a lock while other threads may be updating them,
+ * so the snapshot can be a packet out of date, but costs the hot path nothing.
+ *
+ * \param me		sink context holding the counters
+ * \return a new ccnxsink-stats structure, owned by the caller
+ */
+static GstStructure *
+gst_ccnxsink_stats (Gstccnxsink * me)
+{
+  CcnxSinkStats st = me->stats;
+
+  return gst_structure_new ("ccnxsink-stats",
+      "segments", G_TYPE_UINT64, st.segments,
+      "sign-time", G_TYPE_UINT64, st.sign_time,
+      "puts", G_TYPE_UINT64, st.puts,
+      "interests", G_TYPE_UINT64, st.interests,
+      "meta-requests", G_TYPE_UINT64, st.meta_requests,
+      "keyframes", G_TYPE_UINT64, st.keyframes,
+      "parity-segments", G_TYPE_UINT64, st.parity,
+      "fifo-drops", G_TYPE_UINT64, st.fifo_drops,
+      "reconnects", G_TYPE_UINT64, st.reconnects, NULL);
+}
+
+/**
+ * Posts a ccnxsink-stats element message, if one is due
+ *
+ * \param me		sink context holding the counters
+ */
+static void
+post_stats (Gstccnxsink * me)
+{
+  GstClockTime now;
+
+  if (0 == me->stats_interval)
+    return;
+  now = gst_util_get_timestamp ();
+  if (now < me->stats_posted + me->stats_interval * GST_MSECOND)
+    return;
+  me->stats_posted = now;
+  gst_element_post_message (GST_ELEMENT (me),
+      gst_message_new_element (GST_OBJECT (me), gst_ccnxsink_stats (me)));
+}
+
+/**
+ * Describes our latency histogram
+ *
+ * \em buffer-to-put is the time from the pipeline rendering a buffer to ccn_put() returning
+ * for the message holding its data, in nanoseconds; see histo_to_structure().
+ * A message made of several buffers is timed from the oldest.
+ *
+ * \param me		sink context holding the histogram
+ * \return a new ccnxsink-latency structure, owned by the caller
+ */
+static GstStructure *
+gst_ccnxsink_latency (Gstccnxsink * me)
+{
+  GstStructure *ans;
+  GstStructure *put;
+
+  put = histo_to_structure (&me->lat_put, "buffer-to-put");
+  ans = gst_structure_new ("ccnxsink-latency",
+      "buffer-to-put", GST_TYPE_STRUCTURE, put, NULL);
+  gst_structure_free (put);
+  return ans;
+}
+
 static GstTask *eventTask;                      /**< -> to a GST task structure */
 static GMutex *eventLock;                       /**< -> a lock that helps control the task */
 static GCond *eventCond;                        /**< -> a condition structure to help with synchronization */
@@ -1037,6 +1256,7 @@ ccn_event_thread (void *data)
   struct ccn_charbuf *filtName;
   struct ccn_charbuf *temp;
   int res = 0;
+  int attempt;
 
   GST_DEBUG ("CCNxSink event: *** event thread starting");
 
@@ -1074,11 +1294,26 @@ ccn_event_thread (void *data)
     GST_DEBUG ("CCNxSink event: *** looping");
     res = ccn_run (me->ccn, 50);
     check_fifo (me);
+    if (me->ending && fifo_empty (me))
+      publish_tail (me);
+    post_stats (me);
     if (res < 0 && ccn_get_connection_fd (me->ccn) == -1) {
       GST_DEBUG ("CCNxSink event: need to reconnect...");
-      /* Try reconnecting, after a bit of delay */
-      msleep ((30 + (getpid () % 30)) * 1000);
-      res = ccn_connect (me->ccn, ccndHost ());
+      /* Try reconnecting, waiting a little longer after each failure, unless we are stopped */
+      for (attempt = 0; res < 0 && !me->stopping; ++attempt) {
+        msleep (reconnect_backoff (attempt));
+        res = ccn_connect (me->ccn, ccndHost ());
+      }
+      if (res < 0) {            /* stopped; nobody is left to fetch what we hold */
+        GST_DEBUG ("CCNxSink event: stopped while reconnecting, giving up");
+        gst_task_pause (eventTask);
+        return;
+      }
+      me->stats.reconnects++;
+      /* Our prefix registration went with the old connection, make it again */
+      ccn_set_interest_filter (me->ccn, filtName, NULL);
+      ccn_set_interest_filter (me->ccn, filtName, me->ccn_closure);
+      GST_DEBUG ("CCNxSink event: reconnected, interest filter registered\n");
     }
   }
   GST_DEBUG ("CCNxSink event: *** event thread ending");
@@ -1112,8 +1347,18 @@ gst_ccnxsink_start (GstBaseSink * bsink)
   gboolean b_ret = FALSE;
 
   me = GST_CCNXSINK (bsink);
+  me->stopping = FALSE;
+  me->ending = FALSE;
+  memset (&me->stats, 0, sizeof (me->stats));
+  me->stats_posted = gst_util_get_timestamp ();
   me->temp = ccn_charbuf_create ();
-  me->lastPublish = ccn_charbuf_create ();
+  if (NULL == me->pool)
+    me->pool = charbuf_pool_create (CCN_POOL_MAX, CCN_POOL_RESERVE);
+  if (NULL == me->pool) {
+    GST_ELEMENT_ERROR (me, RESOURCE, READ, (NULL), ("pool alloc failed"));
+    return FALSE;
+  }
+  me->lastPublish = charbuf_pool_get (me->pool);
 
   GST_DEBUG ("CCNxSink: starting, getting connections");
 
@@ -1161,13 +1406,37 @@ gst_ccnxsink_stop (GstBaseSink * bsink)
   Gstccnxsink *me = GST_CCNXSINK (bsink);
 
   if (me->buf)
-    fifo_put (me, me->buf, TRUE);
+    fifo_put (me, me->buf, TRUE, GST_CLOCK_TIME_NONE);
+  me->ending = TRUE;
+  me->stopping = TRUE;
 
   GST_DEBUG ("stopping, closing connections");
 
   return TRUE;
 }
 
+/**
+ * Notes the end of the stream, so the event thread sends out what is left over
+ *
+ * A flush takes the end back, as data follows it again.
+ *
+ * \param bsink		element context receiving the event
+ * \param event		the event
+ * \return true, the base class handles the event as usual
+ */
+static gboolean
+gst_ccnxsink_event (GstBaseSink * bsink, GstEvent * event)
+{
+  Gstccnxsink *me = GST_CCNXSINK (bsink);
+
+  if (GST_EVENT_EOS == GST_EVENT_TYPE (event)) {
+    GST_DEBUG ("end of stream, sending out the tail");
+    me->ending = TRUE;
+  } else if (GST_EVENT_FLUSH_STOP == GST_EVENT_TYPE (event))
+    me->ending = FALSE;         /* the stream goes on after all */
+  return TRUE;
+}
+
 /**
  * Set the context attribute for URI
  *
@@ -1240,6 +1509,16 @@ gst_ccnxsink_set_property (GObject * object, guint prop_id,
     case PROP_SILENT:
       me->silent = g_value_get_boolean (value);
       break;
+    case PROP_STATS_INTERVAL:
+      me->stats_interval = g_value_get_uint (value);
+      break;
+    case PROP_RESET_LATENCY:
+      if (g_value_get_boolean (value))
+        histo_reset (&me->lat_put);
+      break;
+    case PROP_FEC:
+      me->fec = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1267,6 +1546,21 @@ gst_ccnxsink_get_property (GObject * object, guint prop_id,
     case PROP_SILENT:
       g_value_set_boolean (value, me->silent);
       break;
+    case PROP_ALLOCATIONS:
+      g_value_set_uint64 (value, me->pool ? me->pool->allocations : 0);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_ccnxsink_stats (me));
+      break;
+    case PROP_STATS_INTERVAL:
+      g_value_set_uint (value, me->stats_interval);
+      break;
+    case PROP_LATENCY:
+      g_value_take_boxed (value, gst_ccnxsink_latency (me));
+      break;
+    case PROP_FEC:
+      g_value_set_uint (value, me->fec);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1292,6 +1586,14 @@ gst_ccnxsink_finalize (GObject * obj)
   if (me->caps)
     gst_caps_unref (me->caps);
   g_free (me->uri);
+  seqname_destroy (&me->seqname);
+  release_views (me);
+  segenc_destroy (&me->segenc);
+  ccn_charbuf_destroy (&me->lastPublish);
+  ccn_charbuf_destroy (&me->gop_meta);
+  seqname_destroy (&me->fec_seqname);
+  ccn_charbuf_destroy (&me->fec_parity);
+  charbuf_pool_destroy (&me->pool);
 
   G_OBJECT_CLASS (parent_class)->finalize (obj);
 }
@@ -1420,4 +1722,14 @@ gst_ccnxsink_finalize (GObject * obj)
  * The pop code will modify its fifo index under the control of this same lock. It then always signals the condition
  * for which the put code might be waiting for.
  * This could be optimized by only sending the condition if the pop code finds it is going from a full to a non-full fifo.
+ *
+ * \section SINKSTATS Statistics
+ *
+ * The read-only \em stats attribute returns a \em ccnxsink-stats structure with the counts of
+ * segments signed and the time spent signing them, messages put to ccnd, interests served,
+ * meta data requests, and buffers dropped from a full FIFO queue. Setting \em stats-interval
+ * to a number of msecs also posts the same structure as an element message that often.
+ * Each counter has a single writer and is read without a lock.
+ * The read-only \em latency attribute gives a log bucketed histogram of the time from a buffer
+ * being rendered to its data being put to ccnd; setting \em reset-latency clears it.
  */
@@ -37,11 +37,20 @@
 
 #include "ccnxsrc.h"
 #include "utils.h"
+#include "trace.h"
+#include "probes.h"
 
 #ifdef HAVE_UNISTD_H
 #  include <unistd.h>
 #endif
+#ifdef HAVE_SYS_MMAN_H
+#  include <sys/mman.h>
+#endif
+#include <fcntl.h>
 #include <limits.h>
+#ifndef WIN32
+#  include <poll.h>
+#endif
 #include <stdlib.h>
 
 /**
@@ -67,6 +76,11 @@ GST_DEBUG_CATEGORY_STATIC (gst_ccnxsrc_debug);
  */
 #define CCN_WINDOW_SIZE 5
 
+/**
+ * Size of the CCN window of outstanding interests when retrieving reliably
+ */
+#define CCN_RELIABLE_WINDOW_SIZE 64
+
 /**
  * Size of a FIFO block
  */
@@ -82,6 +96,163 @@ GST_DEBUG_CATEGORY_STATIC (gst_ccnxsrc_debug);
  */
 #define CCN_HEADER_TIMEOUT 2000
 
+/**
+ * How long ccnd keeps the interests we send, as we give them no lifetime of our own
+ */
+#define CCN_INTEREST_LIFETIME (4 * GST_SECOND)
+
+/**
+ * Highest loss we credit a prefix with, so that even the worst of them has a finite cost
+ */
+#define CCN_PREFIX_MAX_LOSS 0.99
+
+/**
+ * How often we weigh switching to another rendition
+ */
+#define CCN_ABR_PERIOD GST_SECOND
+
+/**
+ * Share of the throughput we estimate a rendition's bitrate may take
+ */
+#define CCN_ABR_SAFETY 0.8
+
+/**
+ * Periods in a row without timeouts or skipped segments before we try a higher rendition
+ */
+#define CCN_ABR_UP_PERIODS 3
+
+/**
+ * Times we fetch the keyframe lists for a switch before giving up on it
+ */
+#define CCN_ABR_META_TRIES 5
+
+/**
+ * Number of msecs the event thread hands to ccn_run() between housekeeping passes
+ */
+#define CCN_RUN_TIMEOUT 1000
+
+/**
+ * Smallest hole wait, in msecs, we will derive from the round trip time
+ */
+#define CCN_MIN_HOLE_WAIT 50
+
+/**
+ * By default we wait on missing segments until they time out
+ */
+#define CCNX_DEFAULT_MAX_HOLE_WAIT 0
+
+/**
+ * Msecs we wait before re-expressing an interest that timed out once, in reliable mode
+ */
+#define CCN_RETRY_BACKOFF 50
+
+/**
+ * Longest we wait, in msecs, before re-expressing an interest that keeps timing out
+ */
+#define CCN_RETRY_BACKOFF_MAX 4000
+
+/**
+ * Number of bytes between the progress reports we post in reliable mode
+ */
+#define CCN_PROGRESS_INTERVAL (1024 * 1024)
+
+/**
+ * We default to following a live stream
+ */
+#define CCNX_DEFAULT_MODE CCNX_SRC_MODE_LIVE
+
+/**
+ * By default the window size is chosen to suit the mode
+ */
+#define CCNX_DEFAULT_WINDOW_SIZE 0
+
+/**
+ * By default we stream forward rather than serve random access reads
+ */
+#define CCNX_DEFAULT_RANDOM_ACCESS FALSE
+
+/**
+ * Number of segments kept in the cache that serves random access reads
+ */
+#define CCN_CACHE_SEGMENTS 256
+
+/**
+ * Number of msecs handed to ccn_run() while a random access read waits on a segment
+ */
+#define CCN_RANGE_RUN_TIMEOUT 20
+
+/**
+ * Number of times a random access read re-expresses an interest before failing
+ */
+#define CCN_RANGE_RETRIES 5
+
+/**
+ * Size of the CCN window of outstanding interests when downloading into a file
+ */
+#define CCN_BULK_WINDOW_SIZE 256
+
+/**
+ * By default we do not download into a file
+ */
+#define CCNX_DEFAULT_DOWNLOAD_LOCATION NULL
+
+/**
+ * By default no statistics messages are posted
+ */
+#define CCNX_DEFAULT_STATS_INTERVAL 0
+
+/**
+ * By default nothing received is captured
+ */
+#define CCNX_DEFAULT_CAPTURE_LOCATION NULL
+
+/**
+ * By default content comes from the network, not a capture
+ */
+#define CCNX_DEFAULT_REPLAY_LOCATION NULL
+
+/**
+ * By default a capture is replayed at the speed it was recorded
+ */
+#define CCNX_DEFAULT_REPLAY_SPEED 1.0
+
+/**
+ * By default up to this many interests go out back to back before pacing sets in
+ */
+#define CCNX_DEFAULT_PACING_BURST 4
+
+/**
+ * By default we keep a single connection to ccnd
+ */
+#define CCNX_DEFAULT_CONNECTIONS 1
+
+/**
+ * By default we connect to the ccnd named by CCND_HOST, see ccndHost()
+ */
+#define CCNX_DEFAULT_HOSTS NULL
+
+/**
+ * By default the stream is only fetched under its own uri
+ */
+#define CCNX_DEFAULT_ALTERNATES NULL
+
+/**
+ * By default the stream has a single rendition, the uri itself
+ */
+#define CCNX_DEFAULT_RENDITIONS NULL
+/**
+ * By default no parity is fetched
+ */
+#define CCNX_DEFAULT_FEC 0
+/**
+ * By default libccn checks signatures, as the content arrives
+ */
+#define CCNX_DEFAULT_VERIFY CCNX_SRC_VERIFY_INLINE
+/**
+ * Worker threads checking signatures, unless told otherwise
+ */
+#define CCNX_DEFAULT_VERIFY_THREADS 4
+
 
 /**
  * Filter signals and args
@@ -100,9 +271,87 @@ enum
 {
   PROP_0,         /**< Invalid property */
   PROP_URI,       /**< URI property */
-  PROP_SILENT     /**< Silent operation property */
+  PROP_SILENT,    /**< Silent operation property */
+  PROP_MAX_HOLE_WAIT, /**< How long data may wait behind a missing segment */
+  PROP_MODE,      /**< Live or reliable retrieval */
+  PROP_WINDOW_SIZE, /**< Number of outstanding interests */
+  PROP_RANDOM_ACCESS, /**< Serve byte ranges of finite content in pull mode */
+  PROP_DOWNLOAD_LOCATION, /**< File a complete object is fetched into */
+  PROP_STATS,     /**< Snapshot of our counters */
+  PROP_STATS_INTERVAL, /**< Msecs between statistics messages */
+  PROP_LATENCY,   /**< Latency histograms */
+  PROP_RESET_LATENCY, /**< Clears the latency histograms */
+  PROP_CAPTURE_LOCATION, /**< File every content object received is recorded in */
+  PROP_REPLAY_LOCATION, /**< Capture file fed through in place of the network */
+  PROP_REPLAY_SPEED, /**< How fast a capture is replayed */
+  PROP_PACING_BURST, /**< Interests sent back to back before pacing sets in */
+  PROP_CONNECTIONS, /**< Connections to ccnd the interests are spread over */
+  PROP_HOSTS,     /**< ccnds to connect to */
+  PROP_ALTERNATES, /**< Other uris the same stream is published under */
+  PROP_RENDITIONS, /**< Renditions of the stream to switch between */
+  PROP_FEC,       /**< Segments covered by each parity segment */
+  PROP_VERIFY,    /**< Where signatures are checked */
+  PROP_VERIFY_THREADS /**< Worker threads checking signatures */
 };
 
+/**
+ * Shorthand to acquire the type of the mode attribute
+ */
+#define GST_TYPE_CCNXSRC_MODE (gst_ccnxsrc_mode_get_type ())
+
+/**
+ * Register the enumeration used by the mode attribute
+ *
+ * \return the type of the mode enumeration
+ */
+static GType
+gst_ccnxsrc_mode_get_type (void)
+{
+  static GType mode_type = 0;
+  static const GEnumValue modes[] = {
+    {CCNX_SRC_MODE_LIVE, "Keep up with a live stream, skipping lost segments",
+        "live"},
+    {CCNX_SRC_MODE_RELIABLE,
+        "Retrieve every segment from the start, for recorded content",
+        "reliable"},
+    {0, NULL, NULL}
+  };
+
+  if (!mode_type)
+    mode_type = g_enum_register_static ("GstCcnxSrcMode", modes);
+  return mode_type;
+}
+
+/**
+ * Shorthand to acquire the type of the verify attribute
+ */
+#define GST_TYPE_CCNXSRC_VERIFY (gst_ccnxsrc_verify_get_type ())
+
+/**
+ * Register the enumeration used by the verify attribute
+ *
+ * \return the type of the verify enumeration
+ */
+static GType
+gst_ccnxsrc_verify_get_type (void)
+{
+  static GType verify_type = 0;
+  static const GEnumValue verifies[] = {
+    {CCNX_SRC_VERIFY_INLINE, "Checked by libccn as the content arrives",
+        "inline"},
+    {CCNX_SRC_VERIFY_OFFLOAD,
+          "Checked by a pool of worker threads, when signed with the key in our keystore",
+        "offload"},
+    {CCNX_SRC_VERIFY_NONE,
+        "Not checked at all; for trusted networks and benchmarks", "none"},
+    {0, NULL, NULL}
+  };
+
+  if (!verify_type)
+    verify_type = g_enum_register_static ("GstCcnxSrcVerify", verifies);
+  return verify_type;
+}
+
 /**
  * Capabilities of the input source.
  *
@@ -159,11 +408,52 @@ static gboolean gst_ccnxsrc_unlock (GstBaseSrc * bsrc);
 
 static gboolean gst_ccnxsrc_unlock_stop (GstBaseSrc * bsrc);
 
+static gboolean gst_ccnxsrc_is_seekable (GstBaseSrc * bsrc);
+
+static gboolean gst_ccnxsrc_check_get_range (GstBaseSrc * bsrc);
+
+static gboolean gst_ccnxsrc_get_size (GstBaseSrc * bsrc, guint64 * size);
+
 static enum ccn_upcall_res incoming_content (struct ccn_closure *selfp,
     enum ccn_upcall_kind kind, struct ccn_upcall_info *info);
 
 static void gst_ccnxsrc_finalize (GObject * object);
 
+static GstClockTime hole_wait (Gstccnxsrc * me);
+
+static void check_holes (Gstccnxsrc * me);
+
+static GstClockTime retry_timeouts (Gstccnxsrc * me);
+
+static GstStructure *gst_ccnxsrc_stats (Gstccnxsrc * me);
+
+static void post_stats (Gstccnxsrc * me);
+
+static GstStructure *gst_ccnxsrc_latency (Gstccnxsrc * me);
+
+static gboolean replay_start (Gstccnxsrc * me);
+
+static enum ccn_upcall_res post_next_interest (Gstccnxsrc * me);
+
+static void close_renditions (Gstccnxsrc * me);
+
+static gboolean open_fec (Gstccnxsrc * me);
+
+static void close_fec (Gstccnxsrc * me);
+
+static gboolean open_verify (Gstccnxsrc * me);
+
+static void close_verify (Gstccnxsrc * me);
+
+static void verify_drain (Gstccnxsrc * me);
+
+static void range_stop (Gstccnxsrc * me);
+
+static void bulk_stop (Gstccnxsrc * me);
+
+static uintmax_t *get_segment (struct ccn *h, struct ccn_charbuf *name,
+    int timeout);
+
 /**
  * The first function called which typically performs environmental initialization
  *
@@ -268,12 +558,123 @@ gst_ccnxsrc_class_init (GstccnxsrcClass * klass)
       g_param_spec_boolean ("silent", "Silent", "Produce verbose output ?",
           FALSE, G_PARAM_READWRITE));
 
+  g_object_class_install_property (gobject_class, PROP_MAX_HOLE_WAIT,
+      g_param_spec_int ("max-hole-wait", "Max hole wait",
+          "Msecs later data may wait on a missing segment before it is skipped"
+          " (0 = wait for the interest to time out, -1 = derive from the RTT)",
+          -1, G_MAXINT, CCNX_DEFAULT_MAX_HOLE_WAIT, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_MODE,
+      g_param_spec_enum ("mode", "Mode",
+          "Follow a live stream, or reliably retrieve recorded content",
+          GST_TYPE_CCNXSRC_MODE, CCNX_DEFAULT_MODE, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_WINDOW_SIZE,
+      g_param_spec_int ("window-size", "Window size",
+          "Number of interests kept outstanding (0 = suit the mode)",
+          0, G_MAXINT, CCNX_DEFAULT_WINDOW_SIZE, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_RANDOM_ACCESS,
+      g_param_spec_boolean ("random-access", "Random access",
+          "Serve byte ranges of finished, versioned content so demuxers can pull",
+          CCNX_DEFAULT_RANDOM_ACCESS, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_DOWNLOAD_LOCATION,
+      g_param_spec_string ("download-location", "Download location",
+          "Fetch the complete object into this file, out of order and with many interests in flight",
+          CCNX_DEFAULT_DOWNLOAD_LOCATION, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Counters describing how the retrieval is going, as a ccnxsrc-stats structure",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_STATS_INTERVAL,
+      g_param_spec_uint ("stats-interval", "Statistics interval",
+          "Msecs between ccnxsrc-stats element messages (0 = none)",
+          0, G_MAXUINT, CCNX_DEFAULT_STATS_INTERVAL, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_LATENCY,
+      g_param_spec_boxed ("latency", "Latency",
+          "Histograms of interest to data, and data to push, latencies as a ccnxsrc-latency structure",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_RESET_LATENCY,
+      g_param_spec_boolean ("reset-latency", "Reset latency",
+          "Setting this clears the latency histograms", FALSE,
+          G_PARAM_WRITABLE));
+
+  g_object_class_install_property (gobject_class, PROP_CAPTURE_LOCATION,
+      g_param_spec_string ("capture-location", "Capture location",
+          "Record every content object received, with its arrival time, in this file",
+          CCNX_DEFAULT_CAPTURE_LOCATION, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_REPLAY_LOCATION,
+      g_param_spec_string ("replay-location", "Replay location",
+          "Feed the content objects of this capture file through, without a network",
+          CCNX_DEFAULT_REPLAY_LOCATION, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_REPLAY_SPEED,
+      g_param_spec_double ("replay-speed", "Replay speed",
+          "Speed a capture is replayed at, relative to how it was recorded (0 = as fast as possible)",
+          0.0, G_MAXDOUBLE, CCNX_DEFAULT_REPLAY_SPEED, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_PACING_BURST,
+      g_param_spec_int ("pacing-burst", "Pacing burst",
+          "Interests that may go out back to back; the rest are spread over the round trip"
+          " (0 = no pacing)", 0, G_MAXINT, CCNX_DEFAULT_PACING_BURST,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_CONNECTIONS,
+      g_param_spec_int ("connections", "Connections",
+          "Connections to ccnd that segment interests are spread over, by segment number;"
+          " at least one per host", 1, CCNX_SRC_MAX_CONNECTIONS,
+          CCNX_DEFAULT_CONNECTIONS, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_HOSTS,
+      g_param_spec_string ("hosts", "Hosts",
+          "ccnds to connect to, separated by commas or spaces; the connections go to each in turn"
+          " (NULL = the one in " CCND_HOST_ENV_VAR ")", CCNX_DEFAULT_HOSTS,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_ALTERNATES,
+      g_param_spec_string ("alternates", "Alternates",
+          "Other uris the same stream is published under, separated by commas or spaces;"
+          " each segment is asked for under the one answering best", CCNX_DEFAULT_ALTERNATES,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_RENDITIONS,
+      g_param_spec_string ("renditions", "Renditions",
+          "Renditions of the stream published below the uri, as name:kbit/s separated by commas"
+          " or spaces; we switch between them at keyframes to suit the throughput",
+          CCNX_DEFAULT_RENDITIONS, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_FEC,
+      g_param_spec_uint ("fec", "FEC",
+          "Segments covered by each parity segment, as published by the ccnxsink; a lost"
+          " segment is rebuilt from the parity without asking again (0 = fetch no parity)",
+          0, CCN_FEC_MAX_GROUP, CCNX_DEFAULT_FEC, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_VERIFY,
+      g_param_spec_enum ("verify", "Verify",
+          "Where the signatures of the content received are checked",
+          GST_TYPE_CCNXSRC_VERIFY, CCNX_DEFAULT_VERIFY, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_VERIFY_THREADS,
+      g_param_spec_int ("verify-threads", "Verify threads",
+          "Worker threads checking signatures when they are offloaded",
+          1, CCNX_SRC_MAX_VERIFY_THREADS, CCNX_DEFAULT_VERIFY_THREADS,
+          G_PARAM_READWRITE));
+
   /* Now setup the call-back functions for our lifecycle */
   gstbasesrc_class->start = gst_ccnxsrc_start;
   gstbasesrc_class->stop = gst_ccnxsrc_stop;
   gstbasesrc_class->unlock = gst_ccnxsrc_unlock;
   gstbasesrc_class->unlock_stop = gst_ccnxsrc_unlock_stop;
   gstbasesrc_class->get_caps = gst_ccnxsrc_getcaps;
+  gstbasesrc_class->is_seekable = gst_ccnxsrc_is_seekable;
+  gstbasesrc_class->check_get_range = gst_ccnxsrc_check_get_range;
+  gstbasesrc_class->get_size = gst_ccnxsrc_get_size;
   gstbasesrc_class->create = gst_ccnxsrc_create;        // Here in particular is the function used when the pipeline wants more data
 }
 
@@ -291,8 +692,6 @@ static void
 gst_ccnxsrc_init (Gstccnxsrc * me,
     /*@unused@ */ GstccnxsrcClass * gclass)
 {
-  gint i;
-
   me->srcpad = gst_pad_new_from_static_template (&src_factory, "src");
   gst_pad_set_getcaps_function (me->srcpad,
       GST_DEBUG_FUNCPTR (gst_pad_proxy_getcaps));
@@ -303,12 +702,83 @@ gst_ccnxsrc_init (Gstccnxsrc * me,
   me->uri = g_strdup (CCNX_DEFAULT_URI);
   me->fifo_head = 0;
   me->fifo_tail = 0;
+  me->mode = CCNX_DEFAULT_MODE;
+  me->run_mode = CCNX_DEFAULT_MODE;
+  me->window_size = CCNX_DEFAULT_WINDOW_SIZE;
+  me->window = 0;
   me->intWindow = 0;
-  me->intStates = calloc (CCN_WINDOW_SIZE, sizeof (CcnxInterestState)); /* init the array of outstanding states */
-  for (i = 0; i < CCN_WINDOW_SIZE; ++i)
-    me->intStates[i].state = OInterest_idle;
+  me->intStates = NULL;         /* sized when we start, once we know the mode */
   me->i_pos = 0;
   me->i_bufoffset = 0;
+  me->i_offset = 0;
+  me->progress_mark = 0;
+  me->discont = FALSE;
+  me->max_hole_wait = CCNX_DEFAULT_MAX_HOLE_WAIT;
+  me->srtt = 0;
+  me->rttvar = 0;
+  me->pacing_burst = CCNX_DEFAULT_PACING_BURST;
+  me->pace_tokens = 0;
+  me->pace_last = GST_CLOCK_TIME_NONE;
+  me->pace_next = GST_CLOCK_TIME_NONE;
+  me->n_ccns = 0;
+  me->connections = CCNX_DEFAULT_CONNECTIONS;
+  me->hosts = CCNX_DEFAULT_HOSTS;
+  me->host_list = NULL;
+  me->n_hosts = 0;
+  me->alternates = CCNX_DEFAULT_ALTERNATES;
+  memset (me->prefixes, 0, sizeof (me->prefixes));
+  me->n_prefixes = 1;
+  me->renditions = CCNX_DEFAULT_RENDITIONS;
+  memset (me->rends, 0, sizeof (me->rends));
+  me->n_rends = 0;
+  me->rend_next = -1;
+  me->rend_target = -1;
+  me->rend_closure = NULL;
+  me->fec = CCNX_DEFAULT_FEC;
+  me->fec_group = 0;
+  me->fec_groups = NULL;
+  me->n_fec_groups = 0;
+  me->fec_last = UINTMAX_MAX;
+  me->fec_seqname = NULL;
+  me->fec_closure = NULL;
+  me->verify = CCNX_DEFAULT_VERIFY;
+  me->verify_threads = CCNX_DEFAULT_VERIFY_THREADS;
+  me->verify_pool = NULL;
+  me->verified = NULL;
+  me->verify_pending = 0;
+  me->verify_wake[0] = me->verify_wake[1] = -1;
+  me->verify_key = NULL;
+  me->goodput = 0;
+  me->rtt_min = GST_CLOCK_TIME_NONE;
+  me->random_access = CCNX_DEFAULT_RANDOM_ACCESS;
+  me->p_seqname = NULL;
+  me->content_size = 0;
+  me->last_seg = 0;
+  me->cache = NULL;
+  me->cache_size = 0;
+  me->cache_tick = 0;
+  me->flushing = FALSE;
+  me->stopping = FALSE;
+  me->stats_interval = CCNX_DEFAULT_STATS_INTERVAL;
+  me->stats_posted = 0;
+  memset (&me->stats, 0, sizeof (me->stats));
+  histo_clear (&me->lat_interest);
+  histo_clear (&me->lat_push);
+  me->seg_arrived = GST_CLOCK_TIME_NONE;
+  me->buf_arrived = GST_CLOCK_TIME_NONE;
+  me->download_location = CCNX_DEFAULT_DOWNLOAD_LOCATION;
+  me->dl_fd = -1;
+  me->dl_map = NULL;
+  me->dl_map_size = 0;
+  me->dl_done = NULL;
+  me->dl_count = 0;
+  me->dl_size = 0;
+  me->capture_location = CCNX_DEFAULT_CAPTURE_LOCATION;
+  me->capture = NULL;
+  me->capture_start = 0;
+  me->replay_location = CCNX_DEFAULT_REPLAY_LOCATION;
+  me->replay = NULL;
+  me->replay_speed = CCNX_DEFAULT_REPLAY_SPEED;
   me->buf = gst_buffer_new_and_alloc (CCN_FIFO_BLOCK_SIZE);
 
   gst_base_src_set_format (GST_BASE_SRC (me), GST_FORMAT_TIME);
@@ -386,6 +856,73 @@ gst_ccnxsrc_set_property (GObject * object, guint prop_id,
     case PROP_SILENT:
       me->silent = g_value_get_boolean (value);
       break;
+    case PROP_MAX_HOLE_WAIT:
+      me->max_hole_wait = g_value_get_int (value);
+      break;
+    case PROP_MODE:
+      me->mode = g_value_get_enum (value);
+      break;
+    case PROP_WINDOW_SIZE:
+      me->window_size = g_value_get_int (value);
+      break;
+    case PROP_RANDOM_ACCESS:
+      me->random_access = g_value_get_boolean (value);
+      /* pulled ranges are addressed in bytes, and have no meaningful capture time */
+      gst_base_src_set_format (GST_BASE_SRC (me),
+          me->random_access ? GST_FORMAT_BYTES : GST_FORMAT_TIME);
+      gst_base_src_set_do_timestamp (GST_BASE_SRC (me), !me->random_access);
+      break;
+    case PROP_DOWNLOAD_LOCATION:
+      g_free (me->download_location);
+      me->download_location = g_value_dup_string (value);
+      break;
+    case PROP_STATS_INTERVAL:
+      me->stats_interval = g_value_get_uint (value);
+      break;
+    case PROP_RESET_LATENCY:
+      if (g_value_get_boolean (value)) {
+        histo_reset (&me->lat_interest);
+        histo_reset (&me->lat_push);
+      }
+      break;
+    case PROP_CAPTURE_LOCATION:
+      g_free (me->capture_location);
+      me->capture_location = g_value_dup_string (value);
+      break;
+    case PROP_REPLAY_LOCATION:
+      g_free (me->replay_location);
+      me->replay_location = g_value_dup_string (value);
+      break;
+    case PROP_REPLAY_SPEED:
+      me->replay_speed = g_value_get_double (value);
+      break;
+    case PROP_PACING_BURST:
+      me->pacing_burst = g_value_get_int (value);
+      break;
+    case PROP_CONNECTIONS:
+      me->connections = g_value_get_int (value);
+      break;
+    case PROP_HOSTS:
+      g_free (me->hosts);
+      me->hosts = g_value_dup_string (value);
+      break;
+    case PROP_ALTERNATES:
+      g_free (me->alternates);
+      me->alternates = g_value_dup_string (value);
+      break;
+    case PROP_RENDITIONS:
+      g_free (me->renditions);
+      me->renditions = g_value_dup_string (value);
+      break;
+    case PROP_FEC:
+      me->fec = g_value_get_uint (value);
+      break;
+    case PROP_VERIFY:
+      me->verify = g_value_get_enum (value);
+      break;
+    case PROP_VERIFY_THREADS:
+      me->verify_threads = g_value_get_int (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -413,6 +950,63 @@ gst_ccnxsrc_get_property (GObject * object, guint prop_id,
     case PROP_SILENT:
       g_value_set_boolean (value, me->silent);
       break;
+    case PROP_MAX_HOLE_WAIT:
+      g_value_set_int (value, me->max_hole_wait);
+      break;
+    case PROP_MODE:
+      g_value_set_enum (value, me->mode);
+      break;
+    case PROP_WINDOW_SIZE:
+      g_value_set_int (value, me->window_size);
+      break;
+    case PROP_RANDOM_ACCESS:
+      g_value_set_boolean (value, me->random_access);
+      break;
+    case PROP_DOWNLOAD_LOCATION:
+      g_value_set_string (value, me->download_location);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_ccnxsrc_stats (me));
+      break;
+    case PROP_STATS_INTERVAL:
+      g_value_set_uint (value, me->stats_interval);
+      break;
+    case PROP_LATENCY:
+      g_value_take_boxed (value, gst_ccnxsrc_latency (me));
+      break;
+    case PROP_CAPTURE_LOCATION:
+      g_value_set_string (value, me->capture_location);
+      break;
+    case PROP_REPLAY_LOCATION:
+      g_value_set_string (value, me->replay_location);
+      break;
+    case PROP_REPLAY_SPEED:
+      g_value_set_double (value, me->replay_speed);
+      break;
+    case PROP_PACING_BURST:
+      g_value_set_int (value, me->pacing_burst);
+      break;
+    case PROP_CONNECTIONS:
+      g_value_set_int (value, me->connections);
+      break;
+    case PROP_HOSTS:
+      g_value_set_string (value, me->hosts);
+      break;
+    case PROP_ALTERNATES:
+      g_value_set_string (value, me->alternates);
+      break;
+    case PROP_RENDITIONS:
+      g_value_set_string (value, me->renditions);
+      break;
+    case PROP_FEC:
+      g_value_set_uint (value, me->fec);
+      break;
+    case PROP_VERIFY:
+      g_value_set_enum (value, me->verify);
+      break;
+    case PROP_VERIFY_THREADS:
+      g_value_set_int (value, me->verify_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -466,34 +1060,37 @@ gst_ccnxsrc_finalize (GObject * obj)
 {
 
   Gstccnxsrc *me;
+  gint i;
 
   me = GST_CCNXSRC (obj);
 
   if (me->caps)
     gst_caps_unref (me->caps);
   g_free (me->uri);
+  g_free (me->download_location);
+  g_free (me->capture_location);
+  g_free (me->replay_location);
+  g_free (me->hosts);
+  g_strfreev (me->host_list);
+  g_free (me->alternates);
+  for (i = 1; i < CCNX_SRC_MAX_PREFIXES; ++i)
+    seqname_destroy (&me->prefixes[i].seqname);
+  g_free (me->renditions);
+  close_renditions (me);
+  free (me->rend_closure);
+  close_fec (me);
+  free (me->fec_closure);
+  close_verify (me);
+  capture_close (&me->capture);
+  capture_close (&me->replay);
+  free (me->intStates);
+  bulk_stop (me);
+  range_stop (me);
+  seqname_destroy (&me->p_seqname);
 
   G_OBJECT_CLASS (parent_class)->finalize (obj);
 }
 
-/**
- * Create a name with a sequence number component
- *
- * \param basename	the prefix, possibly versioined with a timestamp, to be used in the new name
- * \param seq		the sequence number to add to the prefix
- * \return character buffer with the new name
-static struct ccn_charbuf *
-sequenced_name(struct ccn_charbuf *basename, uintmax_t seq)
-{
-    struct ccn_charbuf *name = NULL;
-
-    name = ccn_charbuf_create();
-    ccn_charbuf_append_charbuf(name, basename);
-    ccn_name_append_numeric(name, CCN_MARKER_SEQNUM, seq);
-    return(name);
-}
- */
-
 /**
  * Looks for an idle slot in the array
  *
@@ -513,7 +1110,7 @@ allocInterestState (Gstccnxsrc * me)
   if (NULL == me)
     return ans;
 
-  for (i = 0; i < CCN_WINDOW_SIZE; ++i) {
+  for (i = 0; i < me->window; ++i) {
     if (OInterest_idle == me->intStates[i].state) {
       ans = &(me->intStates[i]);
       ans->data = NULL;
@@ -521,6 +1118,9 @@ allocInterestState (Gstccnxsrc * me)
       ans->size = 0;
       ans->timeouts = 0;
       ans->lastBlock = FALSE;
+      ans->requested = GST_CLOCK_TIME_NONE;
+      ans->arrived = GST_CLOCK_TIME_NONE;
+      ans->timed_out = 0;
       me->intWindow++;
       break;
     }
@@ -569,7 +1169,7 @@ fetchSegmentInterest (Gstccnxsrc * me, uintmax_t seg)
   if (NULL == me)
     return NULL;
 
-  for (i = 0; i < CCN_WINDOW_SIZE; ++i)
+  for (i = 0; i < me->window; ++i)
     if (seg == me->intStates[i].seg && OInterest_idle != me->intStates[i].state)
       return &(me->intStates[i]);
   return NULL;
@@ -605,7 +1205,7 @@ nextSegmentInterest (Gstccnxsrc * me, uintmax_t seg)
 
   best = 0;
   best--;
-  for (i = 0; i < CCN_WINDOW_SIZE; ++i) {
+  for (i = 0; i < me->window; ++i) {
     if (OInterest_idle != me->intStates[i].state) {
       if (seg == me->intStates[i].seg)
         return &(me->intStates[i]);
@@ -619,90 +1219,474 @@ nextSegmentInterest (Gstccnxsrc * me, uintmax_t seg)
 }
 
 /**
- * Post an interests to the CCN network, and maintains the state information
+ * Fold a new round trip measurement into our running estimate
  *
- * This will create the name used to express the interest on the network. It takes
- * the given segment and includes it in the name. It will then manage the state information
- * we keep in the context to allow us to deliver segments in order, as oppose to how
- * they may be presented to us from the network.
+ * We keep a smoothed mean and variation in the same manner TCP does for its
+ * retransmit timer. Only interests answered on their first expression are
+ * measured, otherwise we cannot tell which expression the data answered.
  *
- * \param me		context holding the array of interest states and other ccn information
- * \param seg		the segment to express interest in
- * \return status value from the express call made to CCN
+ * \param me		source context holding the estimate
+ * \param sample	time from expressing the interest to the data arriving
  */
-static gint
-request_segment (Gstccnxsrc * me, uintmax_t seg)
+static void
+update_rtt (Gstccnxsrc * me, GstClockTime sample)
 {
-  struct ccn_charbuf *nm = NULL;
-  gint rc = 0;
+  GstClockTime err;
 
-  if (NULL == me)
-    return -1;
+  me->rtt_min = MIN (me->rtt_min, sample);
+  if (0 == me->srtt) {
+    me->srtt = sample;
+    me->rttvar = sample / 2;
+    return;
+  }
+  err = (sample > me->srtt) ? sample - me->srtt : me->srtt - sample;
+  me->rttvar = (3 * me->rttvar + err) / 4;
+  me->srtt = (7 * me->srtt + sample) / 8;
+}
 
-  // nm = sequenced_name(me->p_name, seg);
-  nm = ccn_charbuf_create ();
-  rc |= ccn_charbuf_append_charbuf (nm, me->p_name);
-  rc |= ccn_name_append_numeric (nm, CCN_MARKER_SEQNUM, seg);
+/**
+ * Finds which of our prefixes a name falls under
+ *
+ * One prefix may fall under another, so the longest one matching is taken.
+ *
+ * \param me		source context holding the prefixes
+ * \param name		a ccnb encoded name, from its Name tag on
+ * \return index of the prefix, -1 if it is under none of them
+ */
+static gint
+match_prefix (Gstccnxsrc * me, const unsigned char *name)
+{
+  struct ccn_seqname *sn;
+  gint best = -1;
+  gint i;
 
-  GST_INFO ("reqseg - name for interest...");
-  // hDump(nm->buf, nm->length);
-  rc |= ccn_express_interest (me->ccn, nm, me->ccn_closure, me->p_template);
-  ccn_charbuf_destroy (&nm);
-  if (rc < 0) {
-    return rc;
+  for (i = 0; i < me->n_prefixes; ++i) {
+    sn = me->prefixes[i].seqname;
+    /* the encoded prefix, less its closer, starts every name under it */
+    if ((best < 0 || sn->prefix_len > me->prefixes[best].seqname->prefix_len)
+        && 0 == memcmp (name, sn->name->buf, sn->prefix_len - 1))
+      best = i;
   }
-
-  GST_DEBUG ("interest sent for segment %d\n", seg);
-  return rc;
+  return best;
 }
 
 /**
- * test to see if a fifo queue is empty
+ * Tells whether some prefix has not yet timed out for a segment
  *
- * \param me	element context where the fifo is kept
- * \return true if the fifo is empty, false otherwise
+ * \param me		source context holding the prefixes
+ * \param timed_out	bit mask of the prefixes the segment timed out under
+ * \return true if there is a prefix left to try
  */
 static gboolean
-fifo_empty (Gstccnxsrc * me)
+alternate_left (Gstccnxsrc * me, guint timed_out)
 {
-  return me->fifo_head == me->fifo_tail;
+  guint all = (1u << me->n_prefixes) - 1;
+
+  return (timed_out & all) != all;
 }
 
 /**
- * add an element to the fifo queue
- *
- * Each element has its own fifo queue to use when communicating with
- * the background task. When adding information to a full queue, we block
- * waiting for the other task to take something out of the queue
- * thus making some room for the new entry.
+ * Picks the prefix a segment is best asked for under
  *
- * A normal put operation takes place without the use of any locking mechanism.
- * If a full queue is detected, then a lock is used to verify the condition
- * and is also used to coordinate with the fifo_pop() which signifies an
- * un-full queue.
+ * A prefix costs its round trip, plus the interest lifetime for each time we expect to
+ * lose an interest under it before one is answered. Prefixes not yet measured cost
+ * nothing, so each of them gets tried.
  *
- * \param me		element context where the fifo is kept
- * \param buf		the buffer we are to put on the queue
- * \return true if the put succeeded, false otherwise
+ * \param me		source context holding the prefixes
+ * \param avoid		bit mask of prefixes to pass over, unless that is all of them
+ * \return index of the prefix
  */
-static gboolean
-fifo_put (Gstccnxsrc * me, GstBuffer * buf)
+static gint
+best_prefix (Gstccnxsrc * me, guint avoid)
 {
-  int next;
-  GST_DEBUG ("FIFO: putting");
-  next = me->fifo_tail;
-  if (++next >= CCNX_SRC_FIFO_MAX)
-    next = 0;
-  if (next == me->fifo_head) {
-    g_mutex_lock (me->fifo_lock);
-    while (next == me->fifo_head) {
+  CcnxSrcPrefix *pf;
+  gdouble loss;
+  gdouble cost;
+  gdouble best_cost = 0;
+  gint best = 0;
+  gint i;
+
+  if (!alternate_left (me, avoid))
+    avoid = 0;
+  for (i = 0; i < me->n_prefixes; ++i) {
+    if (avoid & (1u << i))
+      continue;
+    pf = &me->prefixes[i];
+    loss = MIN (pf->loss, CCN_PREFIX_MAX_LOSS);
+    cost = pf->srtt + loss / (1.0 - loss) * CCN_INTEREST_LIFETIME;
+    if ((avoid & (1u << best)) || cost < best_cost) {
+      best = i;
+      best_cost = cost;
+    }
+  }
+  return best;
+}
+
+/**
+ * Accounts for a segment that arrived under one of our prefixes
+ *
+ * The round trip is only measured when no interest for the segment timed out under the
+ * same prefix, as we cannot tell which of them was answered.
+ *
+ * \param me		source context holding the prefixes
+ * \param pfx		index of the prefix
+ * \param is		interest state of the segment, NULL if we were not waiting for it
+ * \param now		when the segment arrived
+ */
+static void
+prefix_answered (Gstccnxsrc * me, gint pfx, CcnxInterestState * is,
+    GstClockTime now)
+{
+  CcnxSrcPrefix *pf = &me->prefixes[pfx];
+
+  pf->segments++;
+  pf->loss -= pf->loss / 8;
+  if (NULL == is || GST_CLOCK_TIME_NONE == is->requested
+      || (is->timed_out & (1u << pfx)))
+    return;
+  if (0 == pf->srtt)
+    pf->srtt = now - is->requested;
+  else
+    pf->srtt = (7 * pf->srtt + (now - is->requested)) / 8;
+}
+
+/**
+ * Opens the prefixes the stream is fetched under: its uri, and any alternates
+ *
+ * Each alternate is resolved to its latest version when the uri was, since each publisher
+ * versions the stream on its own. Alternates that cannot be used are left out with a warning.
+ * Random access reads stay on the uri.
+ *
+ * \param me		source context, with p_seqname made for the uri
+ * \param versioned	whether the uri was resolved to a version
+ */
+static void
+open_prefixes (Gstccnxsrc * me, gboolean versioned)
+{
+  struct ccn_charbuf *name;
+  gchar **uris;
+  gint i;
+
+  for (i = 0; i < CCNX_SRC_MAX_PREFIXES; ++i) {
+    if (i > 0)
+      seqname_destroy (&me->prefixes[i].seqname);
+    me->prefixes[i].srtt = 0;
+    me->prefixes[i].loss = 0;
+    me->prefixes[i].interests = 0;
+    me->prefixes[i].segments = 0;
+  }
+  me->prefixes[0].seqname = me->p_seqname;
+  me->n_prefixes = 1;
+  if (NULL == me->alternates || me->random_access)
+    return;
+
+  uris = g_strsplit_set (me->alternates, ", ", -1);
+  for (i = 0; uris[i] && me->n_prefixes < CCNX_SRC_MAX_PREFIXES; ++i) {
+    if (!*uris[i])
+      continue;
+    if ((name = ccn_charbuf_create ()) == NULL)
+      break;
+    if (ccn_name_from_uri (name, uris[i]) < 0
+        || (versioned && 0 != ccn_resolve_version (me->ccn, name,
+                CCN_V_HIGHEST, CCN_VERSION_TIMEOUT))) {
+      GST_ELEMENT_WARNING (me, RESOURCE, NOT_FOUND, (NULL),
+          ("alternate \"%s\" could not be resolved, it is left out", uris[i]));
+    } else if ((me->prefixes[me->n_prefixes].seqname =
+            seqname_create (name)) != NULL)
+      me->n_prefixes++;
+    ccn_charbuf_destroy (&name);
+  }
+  g_strfreev (uris);
+  GST_INFO ("fetching under %d prefix(es)", me->n_prefixes);
+}
+
+/**
+ * Releases the renditions, and what we fetched about them
+ *
+ * \param me		source context holding the renditions
+ */
+static void
+close_renditions (Gstccnxsrc * me)
+{
+  gint i;
+
+  for (i = 0; i < me->n_rends; ++i) {
+    g_free (me->rends[i].name);
+    ccn_charbuf_destroy (&me->rends[i].vname);
+    seqname_destroy (&me->rends[i].seqname);
+  }
+  memset (me->rends, 0, sizeof (me->rends));
+  me->n_rends = 0;
+}
+
+/**
+ * Sets up the renditions of the stream we switch between
+ *
+ * Each rendition is published by its own sink, under a name of its own below the uri,
+ * and versioned on its own. They are kept lowest bitrate first; we start on the lowest
+ * and work our way up. Renditions that cannot be resolved are left out with a warning.
+ * Random access reads and downloads take the uri as it is.
+ *
+ * \param me		source context, with the connections to ccnd made
+ * \return true if the renditions are usable, or none were asked for; false otherwise
+ */
+static gboolean
+open_renditions (Gstccnxsrc * me)
+{
+  CcnxSrcRendition r;
+  gchar **entries;
+  gchar *colon;
+  gchar *end;
+  gint i;
+  gint j;
+
+  close_renditions (me);
+  me->rend = 0;
+  me->rend_shift = 0;
+  me->rend_next = -1;
+  me->rend_target = -1;
+  me->abr_checked = gst_util_get_timestamp ();
+  me->abr_bytes = 0;
+  me->abr_troubles = 0;
+  me->abr_good = 0;
+  me->goodput = 0;
+  me->rtt_min = GST_CLOCK_TIME_NONE;
+  if (NULL == me->renditions || me->random_access || me->download_location)
+    return TRUE;
+
+  entries = g_strsplit_set (me->renditions, ", ", -1);
+  for (i = 0; entries[i] && me->n_rends < CCNX_SRC_MAX_RENDITIONS; ++i) {
+    if (!*entries[i])
+      continue;
+    memset (&r, 0, sizeof (r));
+    colon = strchr (entries[i], ':');
+    if (NULL == colon || colon == entries[i]
+        || 0 == (r.bitrate = strtoul (colon + 1, &end, 10)) || *end) {
+      GST_ELEMENT_ERROR (me, RESOURCE, SETTINGS, (NULL),
+          ("rendition \"%s\" is not name:kbps", entries[i]));
+      g_strfreev (entries);
+      return FALSE;
+    }
+    r.name = g_strndup (entries[i], colon - entries[i]);
+    r.vname = ccn_charbuf_create ();
+    if (ccn_name_from_uri (r.vname, me->uri) < 0
+        || ccn_name_append_str (r.vname, r.name) < 0
+        || 0 != ccn_resolve_version (me->ccn, r.vname, CCN_V_HIGHEST,
+            CCN_VERSION_TIMEOUT)
+        || (r.seqname = seqname_create (r.vname)) == NULL) {
+      GST_ELEMENT_WARNING (me, RESOURCE, NOT_FOUND, (NULL),
+          ("rendition \"%s\" could not be resolved, it is left out", r.name));
+      g_free (r.name);
+      ccn_charbuf_destroy (&r.vname);
+      continue;
+    }
+    for (j = me->n_rends; j > 0 && me->rends[j - 1].bitrate > r.bitrate; --j)
+      me->rends[j] = me->rends[j - 1];
+    me->rends[j] = r;
+    me->n_rends++;
+  }
+  g_strfreev (entries);
+  if (0 == me->n_rends) {
+    GST_ELEMENT_ERROR (me, RESOURCE, NOT_FOUND, (NULL),
+        ("none of the renditions of \"%s\" could be found", me->uri));
+    return FALSE;
+  }
+  if (NULL == me->rend_closure
+      && (me->rend_closure = calloc (1, sizeof (struct ccn_closure))) == NULL) {
+    GST_ELEMENT_ERROR (me, RESOURCE, READ, (NULL), ("closure alloc failed"));
+    return FALSE;
+  }
+  GST_INFO ("switching between %d renditions", me->n_rends);
+  return TRUE;
+}
+
+/**
+ * Works out which of our segments a segment of one of the renditions is
+ *
+ * Only the rendition we are on, and the one we are switching to, have segments we want;
+ * and of those, only the ones on their side of the switch.
+ *
+ * \param me		source context holding the renditions
+ * \param name		the ccnb encoded name of the segment, from its Name tag on
+ * \param seg		the segment number in the name; replaced by ours
+ * \param r		where we return the rendition
+ * \return true if it is one of our segments, false otherwise
+ */
+static gboolean
+rendition_segment (Gstccnxsrc * me, const unsigned char *name, uintmax_t * seg,
+    gint * r)
+{
+  struct ccn_seqname *sn;
+  gint i;
+
+  for (i = 0; i < me->n_rends; ++i) {
+    sn = me->rends[i].seqname;
+    if (0 == memcmp (name, sn->name->buf, sn->prefix_len - 1))
+      break;
+  }
+  *r = i;
+  if (i == me->rend_next) {
+    *seg -= me->rend_next_shift;
+    return (intmax_t) (*seg - me->rend_at) >= 0;
+  }
+  if (i == me->rend) {
+    *seg -= me->rend_shift;
+    return me->rend_next < 0 || (intmax_t) (*seg - me->rend_at) < 0;
+  }
+  return FALSE;
+}
+
+/**
+ * How long data may sit behind a missing segment before we give up on it
+ *
+ * A fixed value comes straight from the max-hole-wait attribute. When the
+ * attribute is negative we derive it from the round trip estimate: once a later
+ * segment has waited longer than the missing one should reasonably take to
+ * arrive, we assume it is lost. Reliable retrieval never gives up on a segment.
+ *
+ * \param me		source context holding the attribute and round trip estimate
+ * \return the time to wait, GST_CLOCK_TIME_NONE if we should wait for timeouts instead
+ */
+static GstClockTime
+hole_wait (Gstccnxsrc * me)
+{
+  GstClockTime wait;
+
+  if (CCNX_SRC_MODE_RELIABLE == me->run_mode || 0 == me->max_hole_wait)
+    return GST_CLOCK_TIME_NONE; /* nothing is ever given up on */
+  if (me->max_hole_wait > 0)
+    return me->max_hole_wait * GST_MSECOND;
+  if (0 == me->srtt)
+    return GST_CLOCK_TIME_NONE; /* nothing measured yet */
+  wait = me->srtt + 4 * me->rttvar;
+  return MAX (wait, CCN_MIN_HOLE_WAIT * GST_MSECOND);
+}
+
+/**
+ * Post an interests to the CCN network, and maintains the state information
+ *
+ * This will create the name used to express the interest on the network. It takes
+ * the given segment and includes it in the name; the encoder rewrites just the
+ * segment component of a name it keeps, so nothing is allocated or copied here. It will then manage the state information
+ * we keep in the context to allow us to deliver segments in order, as oppose to how
+ * they may be presented to us from the network.
+ *
+ * With several connections to ccnd, the segments are dealt out over them by number, so
+ * each connection carries an even share of the interests. With alternate prefixes, the
+ * interest goes under the best prefix the segment has not yet timed out under. With
+ * renditions, it goes to the rendition our segment is taken from, under its number there.
+ *
+ * \param me		context holding the array of interest states and other ccn information
+ * \param seg		the segment to express interest in
+ * \return status value from the express call made to CCN
+ */
+static gint
+request_segment (Gstccnxsrc * me, uintmax_t seg)
+{
+  struct ccn_charbuf *nm = NULL;
+  struct ccn_seqname *sn;
+  CcnxInterestState *is;
+  uintmax_t net = seg;
+  gint pfx = 0;
+  gint rc = 0;
+
+  if (NULL == me)
+    return -1;
+
+  /* when replaying a capture there is no network; the content is already on its way */
+  if (me->replay_location) {
+    me->stats.interests++;
+    return 0;
+  }
+
+  sn = me->p_seqname;
+  if (me->n_rends > 0) {
+    if (me->rend_next >= 0 && seg >= me->rend_at) {
+      sn = me->rends[me->rend_next].seqname;
+      net = seg + me->rend_next_shift;
+    } else {
+      sn = me->rends[me->rend].seqname;
+      net = seg + me->rend_shift;
+    }
+  } else if (me->n_prefixes > 1) {
+    is = fetchSegmentInterest (me, seg);
+    pfx = best_prefix (me, is ? is->timed_out : 0);
+    if (is && is->timed_out && !(is->timed_out & (1u << pfx)))
+      me->stats.switches++;
+    sn = me->prefixes[pfx].seqname;
+  }
+  nm = seqname_encode (sn, net);
+  if (NULL == nm)
+    return -1;
+
+  CCNX_TRACE ("reqseg - name for interest...");
+  // hDump(nm->buf, nm->length);
+  rc |= ccn_express_interest (me->ccns[seg % me->n_ccns], nm, me->ccn_closure,
+      me->p_template);
+  if (rc < 0) {
+    return rc;
+  }
+  me->stats.interests++;
+  me->prefixes[pfx].interests++;
+  CCNX_PROBE1 (interest_express, seg);
+
+  CCNX_TRACE ("interest sent for segment %d", seg);
+  return rc;
+}
+
+/**
+ * test to see if a fifo queue is empty
+ *
+ * \param me	element context where the fifo is kept
+ * \return true if the fifo is empty, false otherwise
+ */
+static gboolean
+fifo_empty (Gstccnxsrc * me)
+{
+  return me->fifo_head == me->fifo_tail;
+}
+
+/**
+ * add an element to the fifo queue
+ *
+ * Each element has its own fifo queue to use when communicating with
+ * the background task. When adding information to a full queue, we block
+ * waiting for the other task to take something out of the queue
+ * thus making some room for the new entry.
+ *
+ * A normal put operation takes place without the use of any locking mechanism.
+ * If a full queue is detected, then a lock is used to verify the condition
+ * and is also used to coordinate with the fifo_pop() which signifies an
+ * un-full queue.
+ *
+ * \param me		element context where the fifo is kept
+ * \param buf		the buffer we are to put on the queue
+ * \param arrived	when the oldest data in the buffer arrived from the network
+ * \return true if the put succeeded, false otherwise
+ */
+static gboolean
+fifo_put (Gstccnxsrc * me, GstBuffer * buf, GstClockTime arrived)
+{
+  int next;
+  GST_DEBUG ("FIFO: putting");
+  next = me->fifo_tail;
+  if (++next >= CCNX_SRC_FIFO_MAX)
+    next = 0;
+  if (next == me->fifo_head) {
+    g_mutex_lock (me->fifo_lock);
+    while (next == me->fifo_head && !me->stopping) {
       GST_DEBUG ("FIFO: queue is full");
       g_cond_wait (me->fifo_cond, me->fifo_lock);
     }
     g_mutex_unlock (me->fifo_lock);
+    if (next == me->fifo_head) {        /* stopping, nobody will take it */
+      gst_buffer_unref (buf);
+      return FALSE;
+    }
     GST_DEBUG ("FIFO: queue is OK");
   }
   me->fifo[me->fifo_tail] = buf;
+  me->fifo_arrived[me->fifo_tail] = arrived;
   me->fifo_tail = next;
   return TRUE;
 }
@@ -718,10 +1702,11 @@ fifo_put (Gstccnxsrc * me, GstBuffer * buf)
  * \todo we can be smarter here and only use the lock if the queue is full.
  *
  * \param me		element context where the fifo is kept
+ * \param arrived	where we return when the oldest data in the buffer arrived
  * \return buffer containing the next element, NULL if the queue is empty
  */
 static GstBuffer *
-fifo_pop (Gstccnxsrc * me)
+fifo_pop (Gstccnxsrc * me, GstClockTime * arrived)
 {
   GstBuffer *ans;
   int next;
@@ -731,6 +1716,7 @@ fifo_pop (Gstccnxsrc * me)
   }
   next = me->fifo_head;
   ans = me->fifo[next];
+  *arrived = me->fifo_arrived[next];
   if (++next >= CCNX_SRC_FIFO_MAX)
     next = 0;
   g_mutex_lock (me->fifo_lock);
@@ -740,6 +1726,412 @@ fifo_pop (Gstccnxsrc * me)
   return ans;
 }
 
+/**
+ * Asks again for everything outstanding, once the connection to ccnd is made again
+ *
+ * The interests we had expressed were lost with the connection. The closure they were
+ * expressed with is retired, so that anything still to come for them is ignored, and
+ * every segment from post_seg on that we are still waiting for, or were about to retry,
+ * is asked for again on a new closure. Data already held in the array is kept.
+ * With several connections, what was outstanding on the ones still up is asked for again
+ * as well, since it shared the retired closure.
+ *
+ * \param me		source context holding the interest array
+ */
+static void
+resume_interests (Gstccnxsrc * me)
+{
+  struct ccn_closure *cl;
+  CcnxInterestState *is;
+  GstClockTime now;
+  gint i;
+
+  if ((cl = calloc (1, sizeof (struct ccn_closure))) != NULL) {
+    cl->data = me;
+    cl->p = me->ccn_closure->p;
+    me->ccn_closure = cl;       /* the old one is freed at its final upcall */
+  }
+  now = gst_util_get_timestamp ();
+  for (i = 0; i < me->window; ++i) {
+    is = &(me->intStates[i]);
+    if ((OInterest_waiting != is->state && OInterest_timeout != is->state)
+        || is->seg < me->post_seg)
+      continue;
+    if (request_segment (me, is->seg) < 0) {
+      GST_LOG_OBJECT (me, "trouble re-sending the interest for segment: %d",
+          is->seg);
+      continue;
+    }
+    is->state = OInterest_waiting;
+    is->requested = now;
+    me->stats.reexpressions++;
+  }
+  GST_INFO ("reconnected, asked again for the outstanding segments");
+}
+
+/**
+ * Which ccnd a connection goes to
+ *
+ * \param me		source context holding the host list
+ * \param i		index of the connection
+ * \return the host, NULL for the default one
+ */
+static const char *
+connection_host (Gstccnxsrc * me, gint i)
+{
+  if (NULL == me->host_list)
+    return ccndHost ();
+  return me->host_list[i % me->n_hosts];
+}
+
+/**
+ * Lets go of every connection to ccnd we hold
+ *
+ * \param me		source context holding the connections
+ */
+static void
+close_connections (Gstccnxsrc * me)
+{
+  gint i;
+
+  for (i = 0; i < me->n_ccns; ++i)
+    ccn_destroy (&me->ccns[i]);
+  me->n_ccns = 0;
+  me->ccn = NULL;
+}
+
+/**
+ * Opens the connections to ccnd that interests are spread over
+ *
+ * There are as many connections as were asked for, but at least one for each host
+ * given, and the connections go to the hosts in turn. The first one is also kept as
+ * \a me->ccn, which the rest of the element uses for anything not striped.
+ * Connections from an earlier start are let go first, and on failure none are kept.
+ *
+ * \param me		source context
+ * \return true if every connection was made, false otherwise
+ */
+static gboolean
+open_connections (Gstccnxsrc * me)
+{
+  gchar **hosts;
+  gint i;
+  gint n;
+
+  close_connections (me);
+  g_strfreev (me->host_list);
+  me->host_list = NULL;
+  me->n_hosts = 0;
+  if (me->hosts) {
+    hosts = g_strsplit_set (me->hosts, ", ", -1);
+    me->host_list = g_new0 (gchar *, g_strv_length (hosts) + 1);
+    for (i = 0; hosts[i]; ++i)
+      if (*hosts[i])
+        me->host_list[me->n_hosts++] = g_strdup (hosts[i]);
+    g_strfreev (hosts);
+    if (0 == me->n_hosts) {
+      g_strfreev (me->host_list);
+      me->host_list = NULL;
+    }
+  }
+  n = CLAMP (MAX (me->connections, me->n_hosts), 1, CCNX_SRC_MAX_CONNECTIONS);
+
+  for (me->n_ccns = 0; me->n_ccns < n; ++me->n_ccns) {
+    i = me->n_ccns;
+    if ((me->ccns[i] = ccn_create ()) == NULL) {
+      GST_ELEMENT_ERROR (me, RESOURCE, READ, (NULL), ("ccn_create failed"));
+      close_connections (me);
+      return FALSE;
+    }
+    if (-1 == ccn_connect (me->ccns[i], connection_host (me, i))) {
+      GST_ELEMENT_ERROR (me, RESOURCE, READ, (NULL),
+          ("ccn_connect failed to %s", connection_host (me, i)));
+      ccn_destroy (&me->ccns[i]);
+      close_connections (me);
+      return FALSE;
+    }
+    loadKey (me->ccns[i], &me->sp);
+    /* libccn checks the signature before the upcall whenever it finds the key, and */
+    /* our sink's objects carry theirs; put that off, so content arrives unverified */
+    if (CCNX_SRC_VERIFY_INLINE != me->verify)
+      ccn_defer_verification (me->ccns[i], 1);
+  }
+  me->ccn = me->ccns[0];
+  GST_INFO ("%d connection(s) to ccnd", me->n_ccns);
+  return TRUE;
+}
+
+/**
+ * Works all of our connections to ccnd for a while
+ *
+ * With a single connection this is just ccn_run(). With several, we wait on all of their
+ * sockets at once and then give each a turn without blocking, so that every upcall still
+ * runs on this one thread and the interest array keeps its single writer.
+ * The signature workers' wake-up pipe is waited on along with them, so their results are
+ * taken back as soon as they are ready.
+ *
+ * \param me		source context holding the connections
+ * \param timeout_ms	longest we wait for something to happen
+ * \param failed	where we return the index of a connection that failed, may be NULL
+ * \return 0, or -1 if a connection failed
+ */
+static gint
+run_connections (Gstccnxsrc * me, gint timeout_ms, gint * failed)
+{
+#ifndef WIN32
+  struct pollfd fds[CCNX_SRC_MAX_CONNECTIONS + 1];
+  gint n;
+#endif
+  gint res = 0;
+  gint i;
+
+  if (me->n_ccns > 1 || me->verify_wake[0] >= 0) {
+#ifdef WIN32
+    timeout_ms /= me->n_ccns;   /* no poll(), so each connection gets a share of the wait */
+#else
+    for (i = 0; i < me->n_ccns; ++i) {
+      fds[i].fd = ccn_get_connection_fd (me->ccns[i]);
+      fds[i].events = POLLIN;
+      if (ccn_output_is_pending (me->ccns[i]))
+        fds[i].events |= POLLOUT;
+      fds[i].revents = 0;
+    }
+    n = me->n_ccns;
+    if (me->verify_wake[0] >= 0) {
+      fds[n].fd = me->verify_wake[0];
+      fds[n].events = POLLIN;
+      fds[n].revents = 0;
+      n++;
+    }
+    poll (fds, n, timeout_ms);
+    timeout_ms = 0;
+#endif
+  }
+  for (i = 0; i < me->n_ccns; ++i) {
+    if (ccn_run (me->ccns[i], timeout_ms) < 0) {
+      res = -1;
+      if (failed)
+        *failed = i;
+    }
+  }
+  return res;
+}
+
+/**
+ * Sets up a switch to the rendition whose keyframes we fetched
+ *
+ * We look for the oldest keyframe found in both renditions, at the same timestamp, that
+ * starts in a segment we have not yet pushed. Our segments up to the one it starts in
+ * come from the rendition we are on, cut short where the keyframe starts; the ones after
+ * come from the other rendition, starting where the keyframe starts there. Whatever we
+ * had already asked for or received past the switch is asked for again.
+ *
+ * \param me		source context holding the renditions
+ */
+static void
+rendition_splice (Gstccnxsrc * me)
+{
+  CcnxSrcRendition *cur = &me->rends[me->rend];
+  CcnxSrcRendition *nxt = &me->rends[me->rend_target];
+  CcnxInterestState *is;
+  GstClockTime now;
+  uintmax_t seg;
+  gint i;
+  gint j;
+
+  for (i = 0; i < cur->n_gops; ++i) {
+    seg = cur->gops[i].segment - me->rend_shift;
+    if ((intmax_t) (seg - me->post_seg) < 0 || 0 == seg)
+      continue;                 /* already pushed, or before we started */
+    for (j = 0; j < nxt->n_gops; ++j)
+      if (nxt->gops[j].pts == cur->gops[i].pts)
+        break;
+    if (j < nxt->n_gops)
+      break;
+  }
+  if (i == cur->n_gops) {
+    GST_DEBUG ("no keyframe to switch to %s at yet", nxt->name);
+    me->rend_meta = 0;          /* fetched again on the next check */
+    return;
+  }
+
+  me->rend_next = me->rend_target;
+  me->rend_target = -1;
+  me->rend_at = seg + 1;
+  me->rend_keep = cur->gops[i].offset;
+  me->rend_skip = nxt->gops[j].offset;
+  me->rend_next_shift = nxt->gops[j].segment - me->rend_at;
+  GST_INFO ("switching from %s to %s at our segment %ju", cur->name,
+      nxt->name, me->rend_at);
+
+  now = gst_util_get_timestamp ();
+  for (i = 0; i < me->window; ++i) {
+    is = &(me->intStates[i]);
+    if (OInterest_idle == is->state || is->seg + 1 < me->rend_at)
+      continue;
+    if (is->seg + 1 == me->rend_at) {
+      is->size = MIN (is->size, me->rend_keep);
+      continue;
+    }
+    free (is->data);
+    is->data = NULL;
+    is->size = 0;
+    is->lastBlock = FALSE;
+    is->timeouts = 0;
+    is->timed_out = 0;
+    is->state = OInterest_waiting;
+    is->requested = now;
+    if (request_segment (me, is->seg) < 0)
+      GST_LOG_OBJECT (me, "trouble asking for segment %d of the new rendition",
+          is->seg);
+  }
+}
+
+/**
+ * Call-back used by ccn for the keyframe lists of the renditions
+ *
+ * \param selfp		-> a context structure we created when registering this call-back
+ * \param kind		specifies the type of call-back being processed
+ * \param info		context information about the call-back itself; interests, data, etc.
+ * \return a response as to how successful we were in processing the call-back
+ */
+static enum ccn_upcall_res
+rendition_meta (struct ccn_closure *selfp,
+    enum ccn_upcall_kind kind, struct ccn_upcall_info *info)
+{
+  Gstccnxsrc *me = GST_CCNXSRC (selfp->data);
+  const unsigned char *val;
+  size_t size;
+  uintmax_t seg = 0;
+  gint r;
+
+  if (CCN_UPCALL_CONTENT_UNVERIFIED == kind) {
+    if (CCNX_SRC_VERIFY_NONE != me->verify)
+      return (CCN_UPCALL_RESULT_VERIFY);
+    kind = CCN_UPCALL_CONTENT;  /* not checking, take it as it is */
+  }
+  if (CCN_UPCALL_CONTENT != kind || me->rend_target < 0)
+    return (CCN_UPCALL_RESULT_OK);      /* timed out ones are asked again on the next check */
+
+  rendition_segment (me, info->content_ccnb + info->pco->offset[CCN_PCO_B_Name],
+      &seg, &r);
+  if ((r != me->rend && r != me->rend_target)
+      || ccn_content_get_value (info->content_ccnb,
+          info->pco->offset[CCN_PCO_E], info->pco, &val, &size) < 0)
+    return (CCN_UPCALL_RESULT_OK);
+  me->rends[r].n_gops = gop_meta_parse (val, size, me->rends[r].gops,
+      CCN_GOP_HISTORY);
+  me->rend_meta |= (r == me->rend) ? 1 : 2;
+  if (3 == me->rend_meta)
+    rendition_splice (me);
+  return (CCN_UPCALL_RESULT_OK);
+}
+
+/**
+ * Asks for the keyframe lists of the rendition we are on and the one we want
+ *
+ * \param me		source context holding the renditions
+ */
+static void
+rendition_fetch_meta (Gstccnxsrc * me)
+{
+  struct ccn_charbuf *nm;
+  gint r[2];
+  gint i;
+
+  me->rend_meta = 0;
+  me->rend_closure->data = me;
+  me->rend_closure->p = rendition_meta;
+  r[0] = me->rend;
+  r[1] = me->rend_target;
+  for (i = 0; i < 2; ++i) {
+    nm = ccn_charbuf_create ();
+    ccn_charbuf_append_charbuf (nm, me->rends[r[i]].vname);
+    ccn_name_from_uri (nm, "_meta_/.gop");
+    if (ccn_express_interest (me->ccn, nm, me->rend_closure, NULL) < 0)
+      GST_LOG_OBJECT (me, "trouble asking for the keyframes of %s",
+          me->rends[r[i]].name);
+    ccn_charbuf_destroy (&nm);
+  }
+}
+
+/**
+ * Weighs switching to another rendition, once a period
+ *
+ * The goodput is the payload we received over the period, smoothed. A period with
+ * timeouts or skipped segments means the rendition is more than we can get, and we go
+ * down to one the goodput can carry. After a few clean periods we go up a rendition, if
+ * the window could carry it at the shortest round trip we saw; that is what we could
+ * fetch at, were there more to fetch than the stream gives us.
+ *
+ * \param me		source context holding the renditions
+ */
+static void
+rendition_check (Gstccnxsrc * me)
+{
+  GstClockTime now;
+  GstClockTime rtt_min;
+  guint64 troubles;
+  gdouble rate;
+  gdouble capacity;
+  gint t = -1;
+
+  if (0 == me->n_rends)
+    return;
+  if (me->rend_next >= 0 && me->post_seg > me->rend_at) {
+    /* everything before the switch has been pushed */
+    me->rend = me->rend_next;
+    me->rend_shift = me->rend_next_shift;
+    me->rend_next = -1;
+    me->stats.rendition_switches++;
+  }
+  now = gst_util_get_timestamp ();
+  if (now < me->abr_checked + CCN_ABR_PERIOD)
+    return;
+
+  troubles = me->stats.timeouts + me->stats.skipped;
+  rate = (me->stats.bytes - me->abr_bytes) * 8.0 * GST_SECOND /
+      (now - me->abr_checked);
+  me->goodput = (me->goodput > 0) ? (3 * me->goodput + rate) / 4 : rate;
+  rtt_min = me->rtt_min;
+  troubles -= me->abr_troubles;
+  me->abr_troubles += troubles;
+  me->abr_bytes = me->stats.bytes;
+  me->abr_checked = now;
+  me->rtt_min = GST_CLOCK_TIME_NONE;
+
+  if (me->rend_next >= 0)
+    return;                     /* a switch is under way */
+  if (me->rend_target >= 0) {
+    if (++me->rend_tries < CCN_ABR_META_TRIES)
+      rendition_fetch_meta (me);
+    else
+      me->rend_target = -1;
+    return;
+  }
+
+  if (troubles > 0) {
+    me->abr_good = 0;
+    for (t = me->rend - 1; t > 0; --t)
+      if (me->rends[t].bitrate * 1000.0 <= CCN_ABR_SAFETY * me->goodput)
+        break;
+  } else if (++me->abr_good >= CCN_ABR_UP_PERIODS
+      && me->rend + 1 < me->n_rends && GST_CLOCK_TIME_NONE != rtt_min) {
+    capacity = me->window * CCN_CHUNK_SIZE * 8.0 * GST_SECOND /
+        MAX (rtt_min, 1);
+    if (me->rends[me->rend + 1].bitrate * 1000.0 <= CCN_ABR_SAFETY * capacity)
+      t = me->rend + 1;
+  }
+  if (t < 0)
+    return;
+  GST_DEBUG ("want rendition %s, goodput %.0f bit/s", me->rends[t].name,
+      me->goodput);
+  me->abr_good = 0;
+  me->rend_target = t;
+  me->rend_tries = 0;
+  rendition_fetch_meta (me);
+}
+
 static GstTask *eventTask;                              /**< -> to a GST task structure */
 static GMutex *eventLock;                               /**< -> a lock that helps control the task */
 static GCond *eventCond;                                /**< -> a condition structure to help with synchronization */
@@ -758,23 +2150,497 @@ static void
 ccn_event_thread (void *data)
 {
   Gstccnxsrc *src = (Gstccnxsrc *) data;
-  struct ccn *ccn = src->ccn;
   int res = 0;
+  int run_ms;
+  int failed = 0;
+  GstClockTime wait;
+  GstClockTime now;
+  GstClockTime next_retry = GST_CLOCK_TIME_NONE;
+  int attempt;
 
   GST_DEBUG ("*** event thread starting");
   /* We pass control to ccnx for a while so it can work with any incoming or outgoing data */
-  /* We check to see if any problems have caused our ccnd connection to fail, and we reconnect */
-  while (res >= 0) {
-    res = ccn_run (ccn, 1000);
-    if (res < 0 && ccn_get_connection_fd (ccn) == -1) {
-      /* Try reconnecting, after a bit of delay */
-      msleep ((30 + (getpid () % 30)) * 1000);
-      res = ccn_connect (ccn, ccndHost ());
+  /* When skipping over holes, we come back often enough to notice data waiting too long, */
+  /* and in reliable mode we come back when timed out interests are due to be re-sent */
+  /* We check to see if any problems have caused a ccnd connection to fail, and we reconnect */
+  while (res >= 0 && !src->stopping) {
+    run_ms = CCN_RUN_TIMEOUT;
+    wait = hole_wait (src);
+    if (GST_CLOCK_TIME_NONE != wait && wait / 2 < run_ms * GST_MSECOND)
+      run_ms = MAX (1, wait / (2 * GST_MSECOND));
+    if (GST_CLOCK_TIME_NONE != next_retry) {
+      now = gst_util_get_timestamp ();
+      run_ms = (next_retry > now) ?
+          MIN (run_ms, MAX (1, (next_retry - now) / GST_MSECOND)) : 1;
+    }
+    if (GST_CLOCK_TIME_NONE != src->pace_next) {
+      now = gst_util_get_timestamp ();
+      run_ms = (src->pace_next > now) ?
+          MIN (run_ms, MAX (1, (src->pace_next - now) / GST_MSECOND)) : 1;
+    }
+    if (src->stats_interval > 0)
+      run_ms = MIN (run_ms, src->stats_interval);
+    if (src->verify_pending > 0 && src->verify_wake[0] < 0)
+      run_ms = 1;               /* the workers have no way to wake us up */
+    res = run_connections (src, run_ms, &failed);
+    verify_drain (src);
+    if (res >= 0) {
+      check_holes (src);
+      next_retry = retry_timeouts (src);
+      if (GST_CLOCK_TIME_NONE != src->pace_next)
+        post_next_interest (src);
+      rendition_check (src);
+      post_stats (src);
+    }
+    capture_flush (src->capture);
+    if (res < 0 && ccn_get_connection_fd (src->ccns[failed]) == -1) {
+      /* Try reconnecting to the same ccnd, waiting a little longer after each failure */
+      /* unless we are being stopped, when gst_ccnxsrc_stop() is waiting for us to end */
+      for (attempt = 0; res < 0 && !src->stopping; ++attempt) {
+        msleep (reconnect_backoff (attempt));
+        res = ccn_connect (src->ccns[failed], connection_host (src, failed));
+      }
+      if (res < 0)
+        break;
+      src->stats.reconnects++;
+      resume_interests (src);
+      next_retry = GST_CLOCK_TIME_NONE;
     }
   }
   GST_DEBUG ("*** event thread ending");
 }
 
+/**
+ * Finds the cache entry holding, or waiting on, a segment
+ *
+ * \param me		context holding the segment cache
+ * \param seg		segment number we are looking for
+ * \return pointer to the cache entry, NULL if the segment is not in the cache
+ */
+static CcnxSegCacheEntry *
+cache_lookup (Gstccnxsrc * me, uintmax_t seg)
+{
+  gint i;
+
+  for (i = 0; i < me->cache_size; ++i)
+    if (OInterest_idle != me->cache[i].state && seg == me->cache[i].seg)
+      return &(me->cache[i]);
+  return NULL;
+}
+
+/**
+ * Makes sure a segment is in the cache, or on its way
+ *
+ * When the segment is not there, the least recently used entry that is not
+ * waiting on the network is taken over and an interest is expressed for it.
+ * An entry that gave up on the segment, read ahead and never read, counts as
+ * not there; it is asked for again.
+ *
+ * \param me		context holding the segment cache
+ * \param seg		segment number we want
+ * \return pointer to the cache entry for the segment, NULL if none could be had
+ */
+static CcnxSegCacheEntry *
+cache_fetch (Gstccnxsrc * me, uintmax_t seg)
+{
+  CcnxSegCacheEntry *ans;
+  CcnxSegCacheEntry *e;
+  gint i;
+
+  ans = cache_lookup (me, seg);
+  if (NULL != ans && OInterest_timeout == ans->state) {
+    ans->timeouts = 0;
+    ans->state = OInterest_waiting;
+    if (request_segment (me, seg) < 0) {
+      ans->state = OInterest_idle;
+      return NULL;
+    }
+  } else if (NULL == ans) {
+    for (i = 0; i < me->cache_size; ++i) {
+      e = &(me->cache[i]);
+      if (OInterest_waiting == e->state)
+        continue;
+      if (NULL == ans || OInterest_idle == e->state || e->used < ans->used)
+        ans = e;
+      if (OInterest_idle == e->state)
+        break;
+    }
+    if (NULL == ans)
+      return NULL;              /* everything is in flight */
+    ans->seg = seg;
+    ans->size = 0;
+    ans->timeouts = 0;
+    ans->state = OInterest_waiting;
+    if (request_segment (me, seg) < 0) {
+      ans->state = OInterest_idle;
+      return NULL;
+    }
+  }
+  ans->used = ++me->cache_tick;
+  return ans;
+}
+
+/**
+ * Waits for a segment to arrive in the cache, asking for those after it as well
+ *
+ * Interests go out for the window of segments following the one we need, so a
+ * demuxer reading its way through the content finds them waiting in the cache.
+ * The network is worked right here, on the streaming thread; in random access
+ * mode there is no background task.
+ *
+ * \param me		context holding the segment cache
+ * \param seg		segment number we need
+ * \param entry	where the cache entry holding the segment is returned
+ * \return a GST flow value
+ * \retval GST_FLOW_OK		the segment is in the cache
+ * \retval GST_FLOW_WRONG_STATE	we are being flushed
+ * \retval GST_FLOW_ERROR	the segment could not be had
+ */
+static GstFlowReturn
+range_segment (Gstccnxsrc * me, uintmax_t seg, CcnxSegCacheEntry ** entry)
+{
+  CcnxSegCacheEntry *e;
+  uintmax_t s;
+
+  e = cache_fetch (me, seg);
+  if (NULL == e)
+    return GST_FLOW_ERROR;
+  for (s = seg + 1; s <= me->last_seg && s < seg + me->window; ++s)
+    cache_fetch (me, s);
+  e->used = ++me->cache_tick;
+
+  while (OInterest_waiting == e->state) {
+    if (me->flushing)
+      return GST_FLOW_WRONG_STATE;
+    if (run_connections (me, CCN_RANGE_RUN_TIMEOUT, NULL) < 0)
+      return GST_FLOW_ERROR;
+  }
+  if (OInterest_havedata != e->state) {
+    GST_LOG_OBJECT (me, "could not get segment: %d", seg);
+    e->state = OInterest_idle;
+    return GST_FLOW_ERROR;
+  }
+  *entry = e;
+  return GST_FLOW_OK;
+}
+
+/**
+ * Call-back used by ccn for content arriving to fill the segment cache
+ *
+ * \param selfp		-> a context structure we created when registering this call-back
+ * \param kind		specifies the type of call-back being processed, see the \b switch statement
+ * \param info		context information about the call-back itself; interests, data, etc.
+ * \return a response as to how successful we were in processing the call-back
+ */
+static enum ccn_upcall_res
+range_content (struct ccn_closure *selfp,
+    enum ccn_upcall_kind kind, struct ccn_upcall_info *info)
+{
+  Gstccnxsrc *me = GST_CCNXSRC (selfp->data);
+  CcnxSegCacheEntry *e;
+  uintmax_t segment;
+  struct ccn_segment_info si;
+
+  if (CCN_UPCALL_FINAL == kind) {
+    if (selfp != me->ccn_closure)       /* retired by resume_interests() */
+      free (selfp);
+    return (CCN_UPCALL_RESULT_OK);
+  }
+  if (!info)
+    return CCN_UPCALL_RESULT_ERR;
+
+  if (CCN_UPCALL_INTEREST_TIMED_OUT == kind) {
+    segment =
+        ccn_ccnb_fetch_segment (info->interest_ccnb, info->interest_comps);
+    e = cache_lookup (me, segment);
+    if (NULL == e || OInterest_waiting != e->state)
+      return (CCN_UPCALL_RESULT_OK);
+    me->stats.timeouts++;
+    if (++e->timeouts > CCN_RANGE_RETRIES) {
+      e->state = OInterest_timeout;
+      return (CCN_UPCALL_RESULT_OK);
+    }
+    me->stats.reexpressions++;
+    me->stats.interests++;
+    return (CCN_UPCALL_RESULT_REEXPRESS);
+
+  } else if (CCN_UPCALL_CONTENT_UNVERIFIED == kind) {
+    if (CCNX_SRC_VERIFY_NONE != me->verify)
+      return (CCN_UPCALL_RESULT_VERIFY);
+
+  } else if (CCN_UPCALL_CONTENT != kind) {
+    return (CCN_UPCALL_RESULT_ERR);
+  }
+
+  if (0 > ccn_segment_parse (info->content_ccnb, info->pco,
+          info->content_comps, &si)) {
+    e = cache_lookup (me, ccn_ccnb_fetch_segment (info->content_ccnb,
+            info->content_comps));
+    if (e && OInterest_waiting == e->state)
+      e->state = OInterest_timeout;
+    return (CCN_UPCALL_RESULT_ERR);
+  }
+  me->stats.segments++;
+  me->stats.bytes += si.size;
+  CCNX_PROBE2 (content_arrive, si.segment, si.size);
+  e = cache_lookup (me, si.segment);
+  if (NULL == e || OInterest_waiting != e->state) {
+    me->stats.late++;
+    return (CCN_UPCALL_RESULT_OK);      /* nobody wants it anymore */
+  }
+  e->size = MIN (si.size, CCN_CHUNK_SIZE);
+  memcpy (e->data, si.data, e->size);
+  e->state = OInterest_havedata;
+  return (CCN_UPCALL_RESULT_OK);
+}
+
+/**
+ * Finds the number of the last segment of finished content
+ *
+ * We ask for the rightmost child of the versioned name, which is the highest segment.
+ * Should that come back as something other than a segment, we fall back
+ * on the segment meta data a sink may still be publishing.
+ *
+ * \param me		context holding the name and the ccn handle
+ * \param seg		where the last segment number is returned
+ * \return true if the last segment was found, false otherwise
+ */
+static gboolean
+find_last_segment (Gstccnxsrc * me, uintmax_t * seg)
+{
+  struct ccn_charbuf *templ;
+  struct ccn_charbuf *co;
+  struct ccn_indexbuf *comps;
+  struct ccn_parsed_ContentObject pco = { 0 };
+  const unsigned char *cp;
+  size_t sz;
+  uintmax_t *p_seg;
+  gboolean ans = FALSE;
+
+  templ = ccn_charbuf_create ();
+  ccn_charbuf_append_tt (templ, CCN_DTAG_Interest, CCN_DTAG);
+  ccn_charbuf_append_tt (templ, CCN_DTAG_Name, CCN_DTAG);
+  ccn_charbuf_append_closer (templ);    /* </Name> */
+  ccnb_tagged_putf (templ, CCN_DTAG_ChildSelector, "1");      /* rightmost */
+  ccn_charbuf_append_closer (templ);    /* </Interest> */
+  co = ccn_charbuf_create ();
+  comps = ccn_indexbuf_create ();
+
+  if (ccn_get (me->ccn, me->p_name, templ, CCN_HEADER_TIMEOUT, co, &pco,
+          comps, 0) >= 0
+      && 0 <= ccn_name_comp_get (co->buf, comps, comps->n - 2, &cp, &sz)
+      && sz > 0 && CCN_MARKER_SEQNUM == cp[0]) {
+    *seg = ccn_ccnb_fetch_segment (co->buf, comps);
+    ans = TRUE;
+  }
+  ccn_indexbuf_destroy (&comps);
+  ccn_charbuf_destroy (&co);
+  ccn_charbuf_destroy (&templ);
+
+  if (!ans) {
+    p_seg = get_segment (me->ccn, me->p_name, CCN_HEADER_TIMEOUT);
+    if (p_seg != NULL) {
+      *seg = *p_seg;
+      free (p_seg);
+      ans = TRUE;
+    }
+  }
+  return ans;
+}
+
+/**
+ * Gets ready to serve random access reads of finished content
+ *
+ * The segment cache is allocated, and the size of the content worked out
+ * from the number and size of its last segment; all others are full.
+ *
+ * \param me		context being started
+ * \return true if we are ready, false otherwise
+ */
+static gboolean
+range_start (Gstccnxsrc * me)
+{
+  CcnxSegCacheEntry *e;
+  gint window = me->window;
+  gint i;
+
+  range_stop (me);
+  me->cache_size = MAX (CCN_CACHE_SEGMENTS, 2 * me->window);
+  if ((me->cache = calloc (me->cache_size, sizeof (CcnxSegCacheEntry))) == NULL)
+    goto fail;
+  for (i = 0; i < me->cache_size; ++i) {
+    me->cache[i].state = OInterest_idle;
+    if ((me->cache[i].data = calloc (1, CCN_CHUNK_SIZE)) == NULL)
+      goto fail;
+  }
+  me->ccn_closure->p = range_content;
+  me->flushing = FALSE;
+
+  if (!find_last_segment (me, &me->last_seg))
+    goto fail;
+  me->window = 1;               /* no read ahead while we look at the end */
+  if (GST_FLOW_OK != range_segment (me, me->last_seg, &e)) {
+    me->window = window;
+    goto fail;
+  }
+  me->window = window;
+  me->content_size = (guint64) me->last_seg * CCN_CHUNK_SIZE + e->size;
+  GST_INFO ("random access content: %" G_GUINT64_FORMAT " bytes in %d segments",
+      me->content_size, me->last_seg + 1);
+  return TRUE;
+
+fail:
+  range_stop (me);
+  return FALSE;
+}
+
+/**
+ * Releases the segment cache of random access
+ *
+ * \param me		context being stopped, or started again
+ */
+static void
+range_stop (Gstccnxsrc * me)
+{
+  gint i;
+
+  if (me->cache) {
+    for (i = 0; i < me->cache_size; ++i)
+      free (me->cache[i].data);
+    free (me->cache);
+  }
+  me->cache = NULL;
+  me->cache_size = 0;
+}
+
+/**
+ * Gets ready to fetch a complete object into the download file
+ *
+ * The file is sized for the segments we know of, the last one being full
+ * until we learn better, and mapped into memory so arriving segments can be
+ * written straight to their final offsets.
+ *
+ * \param me		context being started
+ * \return true if we are ready, false otherwise
+ */
+static gboolean
+bulk_start (Gstccnxsrc * me)
+{
+#ifdef HAVE_SYS_MMAN_H
+  if (!find_last_segment (me, &me->last_seg))
+    return FALSE;
+  me->dl_map_size = (me->last_seg + 1) * CCN_CHUNK_SIZE;
+  me->dl_count = 0;
+  me->dl_size = me->dl_map_size;
+  free (me->dl_done);
+  if ((me->dl_done = calloc (1, me->last_seg / 8 + 1)) == NULL)
+    return FALSE;
+
+  me->dl_fd = open (me->download_location, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (me->dl_fd < 0)
+    return FALSE;
+  if (ftruncate (me->dl_fd, me->dl_map_size) == 0)
+    me->dl_map = mmap (NULL, me->dl_map_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED, me->dl_fd, 0);
+  if (NULL == me->dl_map || MAP_FAILED == me->dl_map) {
+    me->dl_map = NULL;
+    close (me->dl_fd);
+    me->dl_fd = -1;
+    return FALSE;
+  }
+  GST_INFO ("downloading %d segments into %s", me->last_seg + 1,
+      me->download_location);
+  return TRUE;
+#else
+  GST_WARNING ("downloading into a file needs mmap()");
+  return FALSE;
+#endif
+}
+
+/**
+ * Lets go of the download file
+ *
+ * The file is still open only if the download did not finish; it is
+ * removed then, rather than left behind at full size with holes in it.
+ *
+ * \param me		context being stopped
+ */
+static void
+bulk_stop (Gstccnxsrc * me)
+{
+#ifdef HAVE_SYS_MMAN_H
+  if (me->dl_map) {
+    munmap (me->dl_map, me->dl_map_size);
+    me->dl_map = NULL;
+  }
+  if (me->dl_fd >= 0) {
+    close (me->dl_fd);
+    me->dl_fd = -1;
+    if (unlink (me->download_location) < 0)
+      GST_WARNING ("could not remove the partial download %s",
+          me->download_location);
+    else
+      GST_INFO ("removed the partial download %s", me->download_location);
+  }
+#endif
+  free (me->dl_done);
+  me->dl_done = NULL;
+}
+
+/**
+ * Fills a buffer with a byte range of the content, for pull mode
+ *
+ * Byte offsets map straight onto segment numbers, every segment but the
+ * last holding CCN_CHUNK_SIZE bytes.
+ *
+ * \param me		context serving the read
+ * \param offset	byte offset of the range wanted
+ * \param size		number of bytes wanted
+ * \param buf		where the buffer is returned
+ * \return a GST flow value
+ * \retval GST_FLOW_UNEXPECTED	the offset is at or past the end of the content
+ */
+static GstFlowReturn
+range_create (Gstccnxsrc * me, guint64 offset, guint size, GstBuffer ** buf)
+{
+  GstBuffer *ans;
+  CcnxSegCacheEntry *e = NULL;
+  GstFlowReturn ret;
+  guint done = 0;
+  size_t skip;
+  size_t n;
+
+  post_stats (me);
+  if (offset >= me->content_size)
+    return GST_FLOW_UNEXPECTED;
+  size = MIN (size, me->content_size - offset);
+  ans = gst_buffer_new_and_alloc (size);
+
+  while (done < size) {
+    ret = range_segment (me, (offset + done) / CCN_CHUNK_SIZE, &e);
+    if (GST_FLOW_OK != ret) {
+      gst_buffer_unref (ans);
+      if (GST_FLOW_ERROR == ret)
+        GST_ELEMENT_ERROR (me, RESOURCE, READ, (NULL),
+            ("could not retrieve segment %" G_GUINT64_FORMAT,
+                (offset + done) / CCN_CHUNK_SIZE));
+      return ret;
+    }
+    skip = (offset + done) % CCN_CHUNK_SIZE;
+    if (e->size <= skip)
+      break;                    /* short segment, the content ends early */
+    n = MIN (e->size - skip, size - done);
+    memcpy (GST_BUFFER_DATA (ans) + done, e->data + skip, n);
+    done += n;
+  }
+
+  GST_BUFFER_SIZE (ans) = done;
+  GST_BUFFER_OFFSET (ans) = offset;
+  GST_BUFFER_OFFSET_END (ans) = offset + done;
+  *buf = ans;
+  return GST_FLOW_OK;
+}
+
 /**
  * Returns data to the pipeline for media processing
  *
@@ -784,30 +2650,36 @@ ccn_event_thread (void *data)
  * task. If it should be empty, we sit around and wait. Once data does
  * arrive, we take it and send it into the pipeline [we return].
  *
+ * In random access mode the byte range asked for is served from the segment cache instead.
+ *
  * \param psrc		-> to the element context needing to produce data
- * \param offset	\todo I don't use this, why?
- * \param size		\todo I don't use this, why?
+ * \param offset	byte offset wanted, only used in random access mode
+ * \param size		number of bytes wanted, only used in random access mode
  * \param buf		where the data is to be placed
  * \return a GST status showing if we were successful in getting data
  * \retval GST_FLOW_OK buffer has been loaded with data
  * \retval GST_FLOW_ERROR something bad has happened
  */
 static GstFlowReturn
-gst_ccnxsrc_create (GstBaseSrc * psrc, /*@unused@ */ guint64 offset,
-    /*@unused@ */ guint size, GstBuffer ** buf)
+gst_ccnxsrc_create (GstBaseSrc * psrc, guint64 offset,
+    guint size, GstBuffer ** buf)
 {
   Gstccnxsrc *me;
   gboolean looping = TRUE;
   GstBuffer *ans = NULL;
+  GstClockTime arrived = GST_CLOCK_TIME_NONE;
   me = GST_CCNXSRC (psrc);
   GST_DEBUG ("create called");
 
+  if (me->random_access)
+    return range_create (me, offset, size, buf);
+
   while (looping) {
     GST_DEBUG ("create looping");
     if (fifo_empty (me)) {
       msleep (50);
     } else {
-      ans = fifo_pop (me);
+      ans = fifo_pop (me, &arrived);
       looping = FALSE;
     }
   }
@@ -816,6 +2688,9 @@ gst_ccnxsrc_create (GstBaseSrc * psrc, /*@unused@ */ guint64 offset,
     guint sz;
     sz = GST_BUFFER_SIZE (ans);
     GST_LOG_OBJECT (me, "got some data %d", sz);
+    CCNX_PROBE2 (src_fifo_pop, sz, GST_BUFFER_OFFSET (ans));
+    if (GST_CLOCK_TIME_NONE != arrived)
+      histo_record (&me->lat_push, gst_util_get_timestamp () - arrived);
     *buf = ans;
   } else {
     return GST_FLOW_ERROR;
@@ -912,22 +2787,76 @@ gst_ccnxsrc_start (GstBaseSrc * bsrc)
   struct ccn_charbuf *p_name = NULL;
   uintmax_t *p_seg = NULL;
   gint i_ret = 0;
+  gint i;
   gboolean b_ret = FALSE;
 
   src = GST_CCNXSRC (bsrc);
   GST_DEBUG ("starting, getting connections");
+  src->stopping = FALSE;
+
+  /* Whatever an earlier run left in the fifo is of no use to this one */
+  while (!fifo_empty (src)) {
+    gst_buffer_unref (src->fifo[src->fifo_head]);
+    if (++src->fifo_head >= CCNX_SRC_FIFO_MAX)
+      src->fifo_head = 0;
+  }
+  src->fifo_head = 0;
+  src->fifo_tail = 0;
+  memset (&src->stats, 0, sizeof (src->stats));
+  src->stats_posted = gst_util_get_timestamp ();
+
+  /* Downloading a complete object is a reliable retrieval, with a window as big as we dare */
+  src->run_mode = src->download_location ? CCNX_SRC_MODE_RELIABLE : src->mode;
+
+  /* Size the interest window for the mode we are in */
+  src->window = src->window_size;
+  if (src->window <= 0 && src->download_location)
+    src->window = CCN_BULK_WINDOW_SIZE;
+  if (src->window <= 0)
+    src->window = (CCNX_SRC_MODE_RELIABLE == src->run_mode || src->random_access) ?
+        CCN_RELIABLE_WINDOW_SIZE : CCN_WINDOW_SIZE;
+  free (src->intStates);
+  if ((src->intStates =
+          calloc (src->window, sizeof (CcnxInterestState))) == NULL) {
+    GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
+        ("interest state alloc failed"));
+    return FALSE;
+  }
+  for (i = 0; i < src->window; ++i)
+    src->intStates[i].state = OInterest_idle;
+  src->intWindow = 0;
+  src->i_offset = 0;
+  src->progress_mark = CCN_PROGRESS_INTERVAL;
+  src->pace_tokens = src->pacing_burst;
+  src->pace_last = GST_CLOCK_TIME_NONE;
+  src->pace_next = GST_CLOCK_TIME_NONE;
+
+  /* Record what arrives, if we are asked to */
+  capture_close (&src->capture);
+  if (src->capture_location) {
+    if ((src->capture = capture_create (src->capture_location)) == NULL) {
+      GST_ELEMENT_ERROR (src, RESOURCE, OPEN_WRITE, (NULL),
+          ("could not create capture file %s", src->capture_location));
+      return FALSE;
+    }
+    src->capture_start = gst_util_get_timestamp ();
+  }
+
+  /* A capture stands in for the network; only the streaming path is replayed */
+  if (src->replay_location) {
+    if (src->random_access || src->download_location) {
+      GST_ELEMENT_ERROR (src, RESOURCE, SETTINGS, (NULL),
+          ("a capture cannot be replayed for random access or a download"));
+      return FALSE;
+    }
+    return replay_start (src);
+  }
 
-  /* setup the connection to ccnx */
-  if ((src->ccn = ccn_create ()) == NULL) {
-    GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL), ("ccn_create failed"));
+  /* setup the connections to ccnx */
+  if (!open_connections (src))
     return FALSE;
-  }
-  if (-1 == ccn_connect (src->ccn, ccndHost ())) {
-    GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL), ("ccn_connect failed to %s",
-            ccndHost ()));
+  if (!open_verify (src))
     return FALSE;
-  }
-  loadKey (src->ccn, &src->sp);
 
   /* A closure is what defines what to do when an inbound interest or data arrives */
   if ((src->ccn_closure = calloc (1, sizeof (struct ccn_closure))) == NULL) {
@@ -957,14 +2886,56 @@ gst_ccnxsrc_start (GstBaseSrc * bsrc)
   }
 
   /* Find out what the latest one of these is called, and keep it in our context */
-  ccn_charbuf_append (src->p_name, p_name->buf, p_name->length);
-  i_ret = ccn_resolve_version (src->ccn, src->p_name, CCN_V_HIGHEST,
-      CCN_VERSION_TIMEOUT);
+  /* With renditions, we start on the lowest, which is already resolved */
+  if (!open_renditions (src))
+    return FALSE;
+  if (src->n_rends > 0) {
+    ccn_charbuf_append_charbuf (src->p_name, src->rends[0].vname);
+    i_ret = 0;
+  } else {
+    ccn_charbuf_append (src->p_name, p_name->buf, p_name->length);
+    i_ret = ccn_resolve_version (src->ccn, src->p_name, CCN_V_HIGHEST,
+        CCN_VERSION_TIMEOUT);
+  }
+  seqname_destroy (&src->p_seqname);
+  if ((src->p_seqname = seqname_create (src->p_name)) == NULL) {
+    GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
+        ("src->p_seqname alloc failed"));
+    return FALSE;
+  }
+  open_prefixes (src, 0 == i_ret);
+  if (!open_fec (src))
+    return FALSE;
+
+  if (src->random_access) {
+    ccn_charbuf_destroy (&p_name);
+    if (i_ret != 0) {
+      GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
+          ("random access needs versioned content: \"%s\"", src->uri));
+      return FALSE;
+    }
+    if (!range_start (src)) {
+      GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
+          ("could not find the size of \"%s\"", src->uri));
+      return FALSE;
+    }
+    /* reads are served on the streaming thread, so no background task is needed */
+    return TRUE;
+  }
+  if (src->download_location) {
+    if (i_ret != 0 || !bulk_start (src)) {
+      GST_ELEMENT_ERROR (src, RESOURCE, OPEN_WRITE, (NULL),
+          ("could not start downloading \"%s\" into %s", src->uri,
+              src->download_location));
+      return FALSE;
+    }
+  }
 
   GST_INFO ("step 20 - name so far...");
   // hDump(src->p_name->buf, src->p_name->length);
   src->i_seg = 0;
-  if (i_ret == 0) {             /* name is versioned, so get the meta data to obtain the length */
+  /* Reliable retrieval wants every segment, so there is no point in asking where the stream is now */
+  if (i_ret == 0 && CCNX_SRC_MODE_RELIABLE != src->run_mode) {      /* name is versioned, so get the meta data to obtain the length */
     p_seg = get_segment (src->ccn, src->p_name, CCN_HEADER_TIMEOUT);
     if (p_seg != NULL) {
       src->i_seg = *p_seg;
@@ -973,6 +2944,8 @@ gst_ccnxsrc_start (GstBaseSrc * bsrc)
     }
   }
   ccn_charbuf_destroy (&p_name);
+  if (0 == src->i_seg)          /* segment 0 gets asked for below, the window starts after it */
+    src->i_seg = 1;
 
   /* Even though the recent segment published is likely to be >> 0, we still need to ask for segment 0 */
   /* because it seems to contain valuable stream information. Attempts to skip segment 0 resulted in no */
@@ -992,6 +2965,7 @@ gst_ccnxsrc_start (GstBaseSrc * bsrc)
   }
   istate->seg = 0;
   istate->state = OInterest_waiting;
+  istate->requested = gst_util_get_timestamp ();
 
   /* Now start up the background work which will fetch all the rest of the R/T segments */
   eventTask = gst_task_create (ccn_event_thread, src);
@@ -1021,7 +2995,10 @@ gst_ccnxsrc_start (GstBaseSrc * bsrc)
  * Stop processing packets and relinquish resources
  *
  * This should do the complimentary actions to undo what start did.
- * Currently we do nothing.
+ * The background task is stopped first, so nothing it uses goes away under it;
+ * it may be waiting for room in the fifo, so it is woken up to notice.
+ * The connections go next, while we are still stopping: their final upcalls flush
+ * into the fifo, and must not wait for room there. The closure goes with them.
  *
  * \param bsrc		element context that is being stopped
  * \return true if the stop worked properly, false otherwise
@@ -1034,14 +3011,31 @@ gst_ccnxsrc_stop (GstBaseSrc * bsrc)
   src = GST_CCNXSRC (bsrc);
 
   GST_DEBUG ("stopping, closing connections");
+  src->stopping = TRUE;
+  if (src->fifo_lock) {
+    g_mutex_lock (src->fifo_lock);
+    g_cond_signal (src->fifo_cond);
+    g_mutex_unlock (src->fifo_lock);
+  }
+  if (eventTask) {
+    gst_task_stop (eventTask);
+    gst_task_join (eventTask);
+    gst_object_unref (eventTask);
+    eventTask = NULL;
+  }
+  close_connections (src);
+  free (src->ccn_closure);      /* its final upcall does not free it */
+  src->ccn_closure = NULL;
+  bulk_stop (src);
+  range_stop (src);
 
   return TRUE;
 }
 
 /**
- * Not sure what this is used for
+ * Called when the base class needs create() to return quickly, as when flushing for a seek
  *
- * \todo find out what this is for some day
+ * Only a random access read, waiting on the network, pays attention to this.
  *
  * \param bsrc		element context for the work we do
  * \return true if all went ok, false otherwise
@@ -1054,14 +3048,13 @@ gst_ccnxsrc_unlock (GstBaseSrc * bsrc)
   src = GST_CCNXSRC (bsrc);
 
   GST_LOG_OBJECT (src, "unlocking");
+  src->flushing = TRUE;         /* a random access read waiting on the network gives up */
 
   return TRUE;
 }
 
 /**
- * Not sure what this is used for
- *
- * \todo find out what this is for some day
+ * Called when the base class is done with the unlock, and create() may block again
  *
  * \param bsrc		element context for the work we do
  * \return true if all went ok, false otherwise
@@ -1074,10 +3067,199 @@ gst_ccnxsrc_unlock_stop (GstBaseSrc * bsrc)
   src = GST_CCNXSRC (bsrc);
 
   GST_LOG_OBJECT (src, "No longer locked or whatever");
+  src->flushing = FALSE;
+
+  return TRUE;
+}
+
+/**
+ * Tell the base class if we can seek
+ *
+ * Only finished content served in random access mode can be.
+ *
+ * \param bsrc		element context for the work we do
+ * \return true if we can seek, false otherwise
+ */
+static gboolean
+gst_ccnxsrc_is_seekable (GstBaseSrc * bsrc)
+{
+  return GST_CCNXSRC (bsrc)->random_access;
+}
+
+/**
+ * Tell the base class if downstream elements may pull byte ranges from us
+ *
+ * \param bsrc		element context for the work we do
+ * \return true if we operate in pull mode, false otherwise
+ */
+static gboolean
+gst_ccnxsrc_check_get_range (GstBaseSrc * bsrc)
+{
+  return GST_CCNXSRC (bsrc)->random_access;
+}
+
+/**
+ * Tell the base class how big the content is
+ *
+ * \param bsrc		element context for the work we do
+ * \param size		where the size in bytes is returned
+ * \return true if the size is known, false otherwise
+ */
+static gboolean
+gst_ccnxsrc_get_size (GstBaseSrc * bsrc, guint64 * size)
+{
+  Gstccnxsrc *src = GST_CCNXSRC (bsrc);
 
+  if (!src->random_access || 0 == src->content_size)
+    return FALSE;
+  *size = src->content_size;
   return TRUE;
 }
 
+/**
+ * Let the application know how far along a reliable retrieval is
+ *
+ * Recorded content may be large, so in reliable mode we post an element message,
+ * named ccnxsrc-progress, each time another CCN_PROGRESS_INTERVAL bytes have been
+ * delivered, and once more when the last segment arrives.
+ *
+ * \param me		source context doing the retrieval
+ * \param done		flag telling us the retrieval is complete
+ */
+static void
+report_progress (Gstccnxsrc * me, gboolean done)
+{
+  GstStructure *s;
+
+  if (CCNX_SRC_MODE_RELIABLE != me->run_mode)
+    return;
+  if (!done && me->i_offset < me->progress_mark)
+    return;
+  me->progress_mark = me->i_offset + CCN_PROGRESS_INTERVAL;
+
+  s = gst_structure_new ("ccnxsrc-progress",
+      "bytes", G_TYPE_UINT64, me->i_offset,
+      "segment", G_TYPE_UINT64, (guint64) me->post_seg,
+      "done", G_TYPE_BOOLEAN, done, NULL);
+  gst_element_post_message (GST_ELEMENT (me),
+      gst_message_new_element (GST_OBJECT (me), s));
+}
+
+/**
+ * Takes a snapshot of our counters
+ *
+ * The counters are read without a lock while the ccn thread may be updating them,
+ * so the snapshot can be a packet out of date, but costs the hot path nothing.
+ * The RTT fields are the smoothed round trip time and its mean deviation, in nanoseconds.
+ *
+ * \param me		source context holding the counters
+ * \return a new ccnxsrc-stats structure, owned by the caller
+ */
+static GstStructure *
+gst_ccnxsrc_stats (Gstccnxsrc * me)
+{
+  CcnxSrcStats st = me->stats;
+  gint fill;
+
+  fill = (me->fifo_tail - me->fifo_head + CCNX_SRC_FIFO_MAX) % CCNX_SRC_FIFO_MAX;
+  return gst_structure_new ("ccnxsrc-stats",
+      "interests", G_TYPE_UINT64, st.interests,
+      "reexpressions", G_TYPE_UINT64, st.reexpressions,
+      "timeouts", G_TYPE_UINT64, st.timeouts,
+      "segments", G_TYPE_UINT64, st.segments,
+      "late", G_TYPE_UINT64, st.late,
+      "duplicates", G_TYPE_UINT64, st.duplicates,
+      "skipped", G_TYPE_UINT64, st.skipped,
+      "bytes", G_TYPE_UINT64, st.bytes,
+      "rtt-mean", G_TYPE_UINT64, (guint64) me->srtt,
+      "rtt-variation", G_TYPE_UINT64, (guint64) me->rttvar,
+      "window", G_TYPE_INT, me->window,
+      "reorder-depth", G_TYPE_UINT64, st.reorder_depth,
+      "reconnects", G_TYPE_UINT64, st.reconnects,
+      "prefix-switches", G_TYPE_UINT64, st.switches,
+      "rendition-switches", G_TYPE_UINT64, st.rendition_switches,
+      "rendition", G_TYPE_STRING,
+      (me->n_rends > 0) ? me->rends[me->rend].name : NULL,
+      "goodput", G_TYPE_UINT64, (guint64) me->goodput,
+      "parity-segments", G_TYPE_UINT64, st.parity,
+      "parity-bytes", G_TYPE_UINT64, st.parity_bytes,
+      "recovered", G_TYPE_UINT64, st.recovered,
+      "offloaded", G_TYPE_UINT64, st.offloaded,
+      "bad-signatures", G_TYPE_UINT64, st.bad_signatures,
+      "fifo-fill", G_TYPE_INT, fill, NULL);
+}
+
+/**
+ * Posts a ccnxsrc-stats element message, if one is due
+ *
+ * \param me		source context holding the counters
+ */
+static void
+post_stats (Gstccnxsrc * me)
+{
+  GstClockTime now;
+
+  if (0 == me->stats_interval)
+    return;
+  now = gst_util_get_timestamp ();
+  if (now < me->stats_posted + me->stats_interval * GST_MSECOND)
+    return;
+  me->stats_posted = now;
+  gst_element_post_message (GST_ELEMENT (me),
+      gst_message_new_element (GST_OBJECT (me), gst_ccnxsrc_stats (me)));
+}
+
+/**
+ * Describes our latency histograms
+ *
+ * \em interest-to-data is the time from expressing an interest to its content arriving,
+ * \em data-to-push the time from content arriving to the buffer holding it being handed
+ * downstream by create(). Both are in nanoseconds, see histo_to_structure().
+ * Random access reads are not measured.
+ *
+ * \param me		source context holding the histograms
+ * \return a new ccnxsrc-latency structure, owned by the caller
+ */
+static GstStructure *
+gst_ccnxsrc_latency (Gstccnxsrc * me)
+{
+  GstStructure *ans;
+  GstStructure *interest;
+  GstStructure *push;
+
+  interest = histo_to_structure (&me->lat_interest, "interest-to-data");
+  push = histo_to_structure (&me->lat_push, "data-to-push");
+  ans = gst_structure_new ("ccnxsrc-latency",
+      "interest-to-data", GST_TYPE_STRUCTURE, interest,
+      "data-to-push", GST_TYPE_STRUCTURE, push, NULL);
+  gst_structure_free (interest);
+  gst_structure_free (push);
+  return ans;
+}
+
+/**
+ * Sends the buffer being filled out on the fifo queue, and starts a new one
+ *
+ * The buffer is labeled with its byte offset in the stream.
+ *
+ * \param me		source context holding the buffer
+ */
+static void
+push_buffer (Gstccnxsrc * me)
+{
+  GST_BUFFER_SIZE (me->buf) = me->i_bufoffset;
+  GST_BUFFER_OFFSET (me->buf) = me->i_offset;
+  GST_BUFFER_OFFSET_END (me->buf) = me->i_offset + me->i_bufoffset;
+  me->i_offset += me->i_bufoffset;
+  CCNX_PROBE2 (src_fifo_put, GST_BUFFER_SIZE (me->buf),
+      GST_BUFFER_OFFSET (me->buf));
+  fifo_put (me, me->buf, me->buf_arrived);
+  me->buf = gst_buffer_new_and_alloc (CCN_FIFO_BLOCK_SIZE);
+  me->buf_arrived = GST_CLOCK_TIME_NONE;
+  me->i_bufoffset = 0;
+  report_progress (me, FALSE);
+}
+
 /**
  * Moves the data into an internal buffer and sends it out on the fifo queue
  *
@@ -1097,6 +3279,14 @@ process_segment (Gstccnxsrc * me, const guchar * data, const size_t data_size,
   size_t start_offset = 0;
 
   if (data_size > 0) {
+    if (me->discont) {
+      /* segments were skipped; send what came before the gap on its own */
+      /* and flag the next buffer so the decoders know to resync */
+      if (me->i_bufoffset > 0)
+        push_buffer (me);
+      GST_BUFFER_FLAG_SET (me->buf, GST_BUFFER_FLAG_DISCONT);
+      me->discont = FALSE;
+    }
     start_offset = me->i_pos % CCN_CHUNK_SIZE;
     if (start_offset > data_size) {
       GST_LOG_OBJECT (me, "start_offset %zu > data_size %zu", start_offset,
@@ -1105,12 +3295,11 @@ process_segment (Gstccnxsrc * me, const guchar * data, const size_t data_size,
       if ((data_size - start_offset) + me->i_bufoffset > CCN_FIFO_BLOCK_SIZE) {
         /* won't fit in buffer, release the buffer upstream via the fifo queue */
         GST_DEBUG ("pushing data");
-        GST_BUFFER_SIZE (me->buf) = me->i_bufoffset;
-        fifo_put (me, me->buf);
-        me->buf = gst_buffer_new_and_alloc (CCN_FIFO_BLOCK_SIZE);
-        me->i_bufoffset = 0;
+        push_buffer (me);
       }
       /* will fit in buffer */
+      if (0 == me->i_bufoffset)
+        me->buf_arrived = me->seg_arrived;
       memcpy (GST_BUFFER_DATA (me->buf) + me->i_bufoffset, data + start_offset,
           data_size - start_offset);
       me->i_bufoffset += (data_size - start_offset);
@@ -1122,18 +3311,44 @@ process_segment (Gstccnxsrc * me, const guchar * data, const size_t data_size,
    */
   if (b_last) {
     GST_DEBUG ("handling last block");
-    if (me->i_bufoffset > 0) {  // flush out any last bits we had
-      GST_BUFFER_SIZE (me->buf) = me->i_bufoffset;
-      fifo_put (me, me->buf);
-      me->buf = gst_buffer_new_and_alloc (CCN_FIFO_BLOCK_SIZE);
-      me->i_bufoffset = 0;
-    }
+    if (me->i_bufoffset > 0)    // flush out any last bits we had
+      push_buffer (me);
 /*
  * \todo should emit an eos here instead of the empty buffer
  */
-    GST_BUFFER_SIZE (me->buf) = 0;
-    fifo_put (me, me->buf);
-    me->i_bufoffset = 0;
+    push_buffer (me);
+    report_progress (me, TRUE);
+  }
+}
+
+/**
+ * Posts any segments that were waiting on the one we just processed
+ *
+ * Segments may have arrived ahead of 'schedule' and are sitting in the interest array.
+ * We post them in order for as long as we have the data. Segments that were dropped,
+ * having timed out or been given up on, no longer hold a slot in the array; stepping
+ * over one of these marks the stream as discontinuous.
+ *
+ * \param me		source context holding the interest array
+ */
+static void
+drain_queued_segments (Gstccnxsrc * me)
+{
+  CcnxInterestState *istate;
+
+  istate = nextSegmentInterest (me, me->post_seg);
+  while (istate && OInterest_havedata == istate->state) {
+    GST_INFO ("porq - also processing extra segment: %d", istate->seg);
+    if (istate->seg != me->post_seg) {
+      me->discont = TRUE;
+      me->stats.skipped += istate->seg - me->post_seg;
+    }
+    me->seg_arrived = istate->arrived;
+    CCNX_PROBE2 (reorder_drain, istate->seg, istate->size);
+    process_segment (me, istate->data, istate->size, istate->lastBlock);
+    me->post_seg = 1 + istate->seg;     // because we may skip some data, we use this segment to key off of
+    freeInterestState (me, istate);
+    istate = nextSegmentInterest (me, me->post_seg);
   }
 }
 
@@ -1156,55 +3371,447 @@ process_segment (Gstccnxsrc * me, const guchar * data, const size_t data_size,
  * that may have arrived ahead of 'schedule'. Care is taken to skip segments
  * that have for some reason been dropped; likely excessive time outs.
  *
- * \todo at this time I have yet to test the out-of-order code...creating a test for
- * this would take some time because the producer needs to be savy to it.
+ * \todo at this time I have yet to test the out-of-order code...creating a test for
+ * this would take some time because the producer needs to be savy to it.
+ *
+ * \param me		source context for the gst element controlling this data
+ * \param segment	number of the segment that this data is for
+ * \param data		pointer into the data buffer
+ * \param data_size	how many bytes we are to use
+ * \param b_last	flag telling us this is the last block of data; which can still arrive out of order of course
+ */
+static void
+process_or_queue (Gstccnxsrc * me, const uintmax_t segment, const guchar * data,
+    const size_t data_size, const gboolean b_last)
+{
+  CcnxInterestState *istate = NULL;
+
+  istate = fetchSegmentInterest (me, segment);
+  if (NULL == istate) {
+    CCNX_TRACE ("failed to find segment in interest array: %d", segment);
+    me->stats.duplicates++;
+    return;
+  }
+  istate->state = OInterest_havedata;
+
+  if (me->post_seg == segment) {        // This is the next segment we need
+    CCNX_TRACE ("porq - got the segment we need: %d", segment);
+    process_segment (me, data, data_size, b_last);
+    freeInterestState (me, istate);
+    if (0 == segment) {         // special case for segment zero, pick up where the stream starts
+      istate = nextSegmentInterest (me, 0);
+      me->post_seg = istate ? istate->seg : me->i_seg;
+    } else
+      me->post_seg++;
+
+    /* Also look to see if other segments have arrived earlier that need to be posted */
+    drain_queued_segments (me);
+  } else if (me->post_seg > segment) {  // this one is arriving very late, throw it out
+    me->stats.late++;
+    freeInterestState (me, istate);
+  } else {                      // This segment needs to await processing in the queue
+    CCNX_TRACE ("porq - segment needs to wait: %d", segment);
+    if (segment - me->post_seg > me->stats.reorder_depth)
+      me->stats.reorder_depth = segment - me->post_seg;
+    CCNX_PROBE2 (reorder_insert, segment, segment - me->post_seg);
+    istate->size = data_size;
+    istate->lastBlock = b_last;
+    istate->arrived = gst_util_get_timestamp ();
+    istate->data = calloc (1, data_size);       // We need to copy it to our own buffer
+    memcpy (istate->data, data, data_size);
+  }
+}
+
+/**
+ * Is a segment already in the download file
+ *
+ * \param me		source context doing the download
+ * \param seg		segment number to check
+ * \return true if the segment has been written, false otherwise
+ */
+static gboolean
+bulk_have (Gstccnxsrc * me, uintmax_t seg)
+{
+  return (me->dl_done[seg / 8] & (1 << (seg % 8))) != 0;
+}
+
+/**
+ * Writes an arriving segment straight to its place in the download file
+ *
+ * Unlike process_or_queue(), nothing is held back waiting for earlier segments,
+ * so the interest slot is free for the next request right away; the window is
+ * never held up by a slow segment. The bytes that have become contiguous
+ * from the start are still sent down the pipeline, in order.
+ * When the last segment is in, the file is cut to its true size and closed.
+ *
+ * \param me		source context doing the download
+ * \param segment	number of the segment that this data is for
+ * \param data		pointer into the data buffer
+ * \param data_size	how many bytes we are to use
+ */
+static void
+bulk_store (Gstccnxsrc * me, const uintmax_t segment, const guchar * data,
+    size_t data_size)
+{
+  CcnxInterestState *istate;
+  size_t size;
+
+  istate = fetchSegmentInterest (me, segment);
+  if (istate)
+    freeInterestState (me, istate);
+  if (NULL == me->dl_map || segment > me->last_seg || bulk_have (me, segment)) {
+    me->stats.duplicates++;
+    return;                     /* done already, or a duplicate */
+  }
+
+  data_size = MIN (data_size, CCN_CHUNK_SIZE);
+  memcpy (me->dl_map + segment * CCN_CHUNK_SIZE, data, data_size);
+  me->dl_done[segment / 8] |= 1 << (segment % 8);
+  me->dl_count++;
+  if (segment == me->last_seg)
+    me->dl_size = segment * CCN_CHUNK_SIZE + data_size;
+
+#ifdef HAVE_SYS_MMAN_H
+  if (me->dl_count == me->last_seg + 1) {
+    msync (me->dl_map, me->dl_size, MS_SYNC);
+    if (ftruncate (me->dl_fd, me->dl_size) < 0)
+      GST_ELEMENT_WARNING (me, RESOURCE, WRITE, (NULL),
+          ("could not trim %s", me->download_location));
+    close (me->dl_fd);
+    me->dl_fd = -1;
+    GST_INFO ("download complete: %" G_GUINT64_FORMAT " bytes", me->dl_size);
+  }
+#endif
+
+  /* pass along whatever is now contiguous from the start */
+  while (me->post_seg <= me->last_seg && bulk_have (me, me->post_seg)) {
+    size = (me->post_seg == me->last_seg) ?
+        me->dl_size - me->post_seg * CCN_CHUNK_SIZE : CCN_CHUNK_SIZE;
+    process_segment (me, me->dl_map + me->post_seg * CCN_CHUNK_SIZE, size,
+        me->post_seg == me->last_seg);
+    me->post_seg++;
+  }
+
+#ifdef HAVE_SYS_MMAN_H
+  if (me->post_seg > me->last_seg) {
+    munmap (me->dl_map, me->dl_map_size);
+    me->dl_map = NULL;
+  }
+#endif
+}
+
+/**
+ * Finds the slot a group of segments is being gathered in
+ *
+ * \param me		source context holding the parity groups
+ * \param group		number of the group
+ * \return the slot, NULL if the group is not held
+ */
+static CcnxFecGroup *
+fec_lookup (Gstccnxsrc * me, uintmax_t group)
+{
+  CcnxFecGroup *g;
+
+  if (0 == me->n_fec_groups)
+    return NULL;
+  g = &me->fec_groups[group % me->n_fec_groups];
+  return (g->active && g->group == group) ? g : NULL;
+}
+
+/**
+ * Which segments of a group have not been folded into its parity block
+ *
+ * The stream's last group may be short; segments past the last one are not missing.
+ *
+ * \param me		source context holding the parity groups
+ * \param g		the group
+ * \return a bit for each segment missing
+ */
+static guint32
+fec_missing (Gstccnxsrc * me, CcnxFecGroup * g)
+{
+  uintmax_t first = g->group * me->fec_group;
+  uintmax_t last = me->fec_last;
+  guint n = me->fec_group;
+
+  if (me->download_location && me->last_seg < last)
+    last = me->last_seg;
+  if (last < first)
+    return 0;
+  if (last - first < n)
+    n = last - first + 1;
+  if (n >= 32)
+    return ~g->have;
+  return ~g->have & ((1u << n) - 1);
+}
+
+/**
+ * Rebuilds the one segment missing from a group, once its parity is in
+ *
+ * The segment is handed on as if it had just arrived, provided we are still waiting
+ * for it; one given up on, or not yet asked for, is left alone.
+ *
+ * \param me		source context holding the parity groups
+ * \param g		the group
+ */
+static void
+fec_recover (Gstccnxsrc * me, CcnxFecGroup * g)
+{
+  CcnxInterestState *istate;
+  const unsigned char *data;
+  size_t size;
+  guint32 missing;
+  uintmax_t seg;
+  gint j;
+
+  missing = fec_missing (me, g);
+  if (!g->parity || 0 == missing || (missing & (missing - 1)))
+    return;                     /* nothing missing, or more than the parity can make up for */
+  for (j = 0; !(missing & (1u << j)); ++j);
+  seg = g->group * me->fec_group + j;
+  if (me->download_location) {
+    if (seg > me->last_seg || bulk_have (me, seg))
+      return;
+  } else {
+    istate = fetchSegmentInterest (me, seg);
+    if (NULL == istate || OInterest_havedata == istate->state)
+      return;
+  }
+  if (fec_recovered (g->block, &data, &size) < 0) {
+    GST_LOG_OBJECT (me, "parity of group %d does not add up", g->group);
+    return;
+  }
+  g->have |= missing;
+  me->stats.recovered++;
+  GST_LOG_OBJECT (me, "segment %d rebuilt from parity", seg);
+  me->seg_arrived = gst_util_get_timestamp ();
+  if (me->download_location)
+    bulk_store (me, seg, data, size);
+  else
+    process_or_queue (me, seg, data, size, size < CCN_CHUNK_SIZE);
+}
+
+/**
+ * Folds a segment that arrived into the parity of its group
+ *
+ * \param me		source context holding the parity groups
+ * \param segment	number of the segment
+ * \param data		its payload
+ * \param data_size	size of the payload
+ * \param last		true if it is the stream's last segment
+ */
+static void
+fec_have (Gstccnxsrc * me, uintmax_t segment, const guchar * data,
+    size_t data_size, gboolean last)
+{
+  CcnxFecGroup *g;
+  guint32 bit;
+
+  if (0 == me->fec_group)
+    return;
+  if (last && segment < me->fec_last)
+    me->fec_last = segment;
+  if (NULL == (g = fec_lookup (me, segment / me->fec_group)))
+    return;
+  bit = 1u << (segment % me->fec_group);
+  if (g->have & bit)
+    return;                     /* a duplicate, or rebuilt already */
+  fec_fold (g->block, CCN_FEC_HEADER, data, data_size);
+  fec_fold_size (g->block, data_size);
+  g->have |= bit;
+  fec_recover (me, g);
+}
+
+/**
+ * Call-back for the parity segments we asked for
+ *
+ * A timed out parity interest is expressed again for as long as its group is held and
+ * still short of segments; a group that is complete has no use for it.
+ *
+ * \param	selfp		-> a context structure we created when registering this call-back
+ * \param	kind		specifies the type of call-back being processed
+ * \param	info		context information about the call-back itself
+ * \return a response as to how successful we were in processing the call-back
+ */
+static enum ccn_upcall_res
+fec_content (struct ccn_closure *selfp,
+    enum ccn_upcall_kind kind, struct ccn_upcall_info *info)
+{
+  Gstccnxsrc *me = GST_CCNXSRC (selfp->data);
+  struct ccn_segment_info si;
+  CcnxFecGroup *g;
+  uintmax_t group;
+
+  if (CCN_UPCALL_CONTENT_UNVERIFIED == kind) {
+    if (CCNX_SRC_VERIFY_NONE != me->verify)
+      return (CCN_UPCALL_RESULT_VERIFY);
+    kind = CCN_UPCALL_CONTENT;  /* not checking, take it as it is */
+  }
+  if (CCN_UPCALL_INTEREST_TIMED_OUT == kind) {
+    if (0 == me->fec_group)
+      return (CCN_UPCALL_RESULT_OK);
+    group = ccn_ccnb_fetch_segment (info->interest_ccnb, info->interest_comps);
+    g = fec_lookup (me, group);
+    if (NULL == g || g->parity || 0 == fec_missing (me, g))
+      return (CCN_UPCALL_RESULT_OK);
+    return (CCN_UPCALL_RESULT_REEXPRESS);
+  }
+  if (CCN_UPCALL_CONTENT != kind
+      || 0 > ccn_segment_parse (info->content_ccnb, info->pco,
+          info->content_comps, &si))
+    return (CCN_UPCALL_RESULT_OK);
+  g = fec_lookup (me, si.segment);
+  if (NULL == g || g->parity)
+    return (CCN_UPCALL_RESULT_OK);
+  if (si.size < CCN_FEC_GROUP_BYTES || si.data[0] != me->fec_group) {
+    GST_LOG_OBJECT (me, "parity of group %d is not for groups of %d segments",
+        g->group, me->fec_group);
+    return (CCN_UPCALL_RESULT_OK);
+  }
+  fec_fold (g->block, 0, si.data + CCN_FEC_GROUP_BYTES,
+      si.size - CCN_FEC_GROUP_BYTES);
+  g->parity = TRUE;
+  me->stats.parity++;
+  me->stats.parity_bytes += si.size;
+  fec_recover (me, g);
+  post_next_interest (me);
+  return (CCN_UPCALL_RESULT_OK);
+}
+
+/**
+ * Asks for the parity of a segment's group, if it has not been asked for yet
+ *
+ * The group takes over the slot of the one it replaces in the ring.
+ *
+ * \param me		source context holding the parity groups
+ * \param seg		segment just asked for
+ */
+static void
+fec_request (Gstccnxsrc * me, uintmax_t seg)
+{
+  struct ccn_charbuf *nm;
+  CcnxFecGroup *g;
+  uintmax_t group;
+
+  if (0 == me->fec_group || me->replay_location)
+    return;
+  group = seg / me->fec_group;
+  if (fec_lookup (me, group))
+    return;
+  g = &me->fec_groups[group % me->n_fec_groups];
+  g->active = TRUE;
+  g->group = group;
+  g->have = 0;
+  g->parity = FALSE;
+  g->block->length = 0;
+  nm = seqname_encode (me->fec_seqname, group);
+  if (NULL == nm
+      || ccn_express_interest (me->ccn, nm, me->fec_closure,
+          me->p_template) < 0)
+    GST_LOG_OBJECT (me, "trouble asking for the parity of group %d", group);
+}
+
+/**
+ * Releases what we keep to rebuild segments from parity
+ *
+ * \param me		source context holding the parity groups
+ */
+static void
+close_fec (Gstccnxsrc * me)
+{
+  gint i;
+
+  for (i = 0; i < me->n_fec_groups; ++i)
+    ccn_charbuf_destroy (&me->fec_groups[i].block);
+  free (me->fec_groups);
+  me->fec_groups = NULL;
+  me->n_fec_groups = 0;
+  me->fec_group = 0;
+  me->fec_last = UINTMAX_MAX;
+  seqname_destroy (&me->fec_seqname);
+}
+
+/**
+ * Sets up fetching the parity segments published next to the stream's segments
+ *
+ * A ccnxsink with its fec attribute set follows every group of that many segments with
+ * their XOR, under CCN_FEC_COMPONENT next to the segments. We ask for the parity of each
+ * group as we ask for its first segment, and keep enough groups to span the window.
+ * Parity is not fetched across renditions, nor for random access reads. Parity saying
+ * its groups are not of our size is of no use, and dropped as it arrives.
  *
- * \param me		source context for the gst element controlling this data
- * \param segment	number of the segment that this data is for
- * \param data		pointer into the data buffer
- * \param data_size	how many bytes we are to use
- * \param b_last	flag telling us this is the last block of data; which can still arrive out of order of course
+ * \param me		source context, with p_name resolved
+ * \return true if parity is fetched, or was not asked for; false otherwise
  */
-static void
-process_or_queue (Gstccnxsrc * me, const uintmax_t segment, const guchar * data,
-    const size_t data_size, const gboolean b_last)
+static gboolean
+open_fec (Gstccnxsrc * me)
 {
-  CcnxInterestState *istate = NULL;
+  struct ccn_charbuf *nm;
+  gint i;
 
-  istate = fetchSegmentInterest (me, segment);
-  if (NULL == istate) {
-    GST_INFO ("failed to find segment in interest array: %d", segment);
-    return;
+  close_fec (me);
+  if (0 == me->fec || me->n_rends > 0 || me->random_access)
+    return TRUE;
+  nm = ccn_charbuf_create ();
+  ccn_charbuf_append_charbuf (nm, me->p_name);
+  ccn_name_append_str (nm, CCN_FEC_COMPONENT);
+  me->fec_seqname = seqname_create (nm);
+  ccn_charbuf_destroy (&nm);
+  me->n_fec_groups = me->window / me->fec + 2;
+  me->fec_groups = calloc (me->n_fec_groups, sizeof (CcnxFecGroup));
+  if (NULL == me->fec_closure)
+    me->fec_closure = calloc (1, sizeof (struct ccn_closure));
+  if (NULL == me->fec_seqname || NULL == me->fec_groups
+      || NULL == me->fec_closure) {
+    GST_ELEMENT_ERROR (me, RESOURCE, READ, (NULL), ("parity alloc failed"));
+    me->n_fec_groups = 0;
+    close_fec (me);
+    return FALSE;
   }
-  istate->state = OInterest_havedata;
-
-  if (me->post_seg == segment) {        // This is the next segment we need
-    GST_INFO ("porq - got the segment we need: %d", segment);
-    process_segment (me, data, data_size, b_last);
-    freeInterestState (me, istate);
-    if (0 == segment)
-      me->post_seg = me->i_seg; // special case for segment zero
-    else
-      me->post_seg++;
+  for (i = 0; i < me->n_fec_groups; ++i)
+    me->fec_groups[i].block = ccn_charbuf_create ();
+  me->fec_closure->data = me;
+  me->fec_closure->p = fec_content;
+  me->fec_group = me->fec;
+  GST_INFO ("fetching the parity of every %d segments", me->fec_group);
+  return TRUE;
+}
 
-    /* Also look to see if other segments have arrived earlier that need to be posted */
-    istate = nextSegmentInterest (me, me->post_seg);
-    while (istate && OInterest_havedata == istate->state) {
-      GST_INFO ("porq - also processing extra segment: %d", istate->seg);
-      process_segment (me, istate->data, istate->size, istate->lastBlock);
-      me->post_seg = 1 + istate->seg;   // because we may skip some data, we use this segment to key off of
-      freeInterestState (me, istate);
-      istate = nextSegmentInterest (me, me->post_seg);
-    }
-  } else if (me->post_seg > segment) {  // this one is arriving very late, throw it out
-    freeInterestState (me, istate);
-  } else {                      // This segment needs to await processing in the queue
-    GST_INFO ("porq - segment needs to wait: %d", segment);
-    istate->size = data_size;
-    istate->lastBlock = b_last;
-    istate->data = calloc (1, data_size);       // We need to copy it to our own buffer
-    memcpy (istate->data, data, data_size);
+/**
+ * Takes a token from the interest pacing bucket, if there is one
+ *
+ * Filling the whole window at once, at startup or after a stall, would have all of its
+ * data come back in one burst, overflowing buffers along the way. Instead, after a burst
+ * of up to pacing_burst, interests go out at a window's worth per round trip, the rate
+ * the data comes back at once the window is flowing. Until a round trip has been
+ * measured, and when replaying a capture, nothing is paced.
+ *
+ * \param me		source context holding the bucket
+ * \return true if an interest may go out now; if not, pace_next says when one may
+ */
+static gboolean
+pace_interest (Gstccnxsrc * me)
+{
+  GstClockTime gap;
+  GstClockTime now;
+
+  me->pace_next = GST_CLOCK_TIME_NONE;
+  if (me->pacing_burst <= 0 || me->replay_location)
+    return TRUE;
+  gap = me->srtt / MAX (me->window, 1);
+  if (0 == gap)
+    return TRUE;
+  now = gst_util_get_timestamp ();
+  if (GST_CLOCK_TIME_NONE != me->pace_last)
+    me->pace_tokens = MIN (me->pacing_burst,
+        me->pace_tokens + (gdouble) (now - me->pace_last) / gap);
+  me->pace_last = now;
+  if (me->pace_tokens >= 1) {
+    me->pace_tokens -= 1;
+    return TRUE;
   }
+  me->pace_next = now + (GstClockTime) ((1 - me->pace_tokens) * gap);
+  return FALSE;
 }
 
 /**
@@ -1216,7 +3823,7 @@ process_or_queue (Gstccnxsrc * me, const uintmax_t segment, const guchar * data,
  * Some aspects of response we cannot improve upon; it takes light
  * [electricity] a certain number of msecs to get from Qindao to Murray Hill.
  * However being tardy with asking for data is completely within
- * our control.
+ * our control. Being too eager is not good either; see pace_interest().
  *
  * \param me		source context holding the state for this element instance
  */
@@ -1227,7 +3834,11 @@ post_next_interest (Gstccnxsrc * me)
   gint res;
   uintmax_t segment;
 
-  while (me->intWindow < CCN_WINDOW_SIZE) {
+  while (me->intWindow < me->window) {
+    if (me->download_location && me->i_seg > me->last_seg)
+      break;                    /* everything in the object has been asked for */
+    if (!pace_interest (me))
+      break;                    /* the event thread comes back for the rest */
     /* Ask for the next segment from the producer */
     me->i_pos = CCN_CHUNK_SIZE * (1 + (me->i_pos / CCN_CHUNK_SIZE));
     segment = me->i_seg++;
@@ -1243,10 +3854,206 @@ post_next_interest (Gstccnxsrc * me)
     }
     is->seg = segment;
     is->state = OInterest_waiting;
+    is->requested = gst_util_get_timestamp ();
+    fec_request (me, segment);
   }
   return CCN_UPCALL_RESULT_OK;
 }
 
+/**
+ * How long to wait before expressing a timed out interest again
+ *
+ * The delay doubles with each timeout, up to CCN_RETRY_BACKOFF_MAX.
+ *
+ * \param timeouts	number of times the interest has timed out so far
+ * \return delay before the next expression
+ */
+static GstClockTime
+retry_backoff (gint timeouts)
+{
+  GstClockTime delay = CCN_RETRY_BACKOFF * GST_MSECOND;
+
+  while (--timeouts > 0 && delay < CCN_RETRY_BACKOFF_MAX * GST_MSECOND)
+    delay *= 2;
+  return MIN (delay, CCN_RETRY_BACKOFF_MAX * GST_MSECOND);
+}
+
+/**
+ * Re-expresses the timed out interests whose back off has run out
+ *
+ * Only used in reliable mode, where a timed out interest is parked in the
+ * OInterest_timeout state rather than being re-expressed right away.
+ *
+ * \param me		source context holding the interest array
+ * \return when the next parked interest is due, GST_CLOCK_TIME_NONE if there are none
+ */
+static GstClockTime
+retry_timeouts (Gstccnxsrc * me)
+{
+  CcnxInterestState *is;
+  GstClockTime now;
+  GstClockTime next = GST_CLOCK_TIME_NONE;
+  gint i;
+
+  now = gst_util_get_timestamp ();
+  for (i = 0; i < me->window; ++i) {
+    is = &(me->intStates[i]);
+    if (OInterest_timeout != is->state)
+      continue;
+    if (now < is->retry_at) {
+      next = MIN (next, is->retry_at);
+      continue;
+    }
+    GST_LOG_OBJECT (me, "retrying segment: %d", is->seg);
+    if (request_segment (me, is->seg) < 0) {
+      GST_LOG_OBJECT (me, "trouble re-sending the interest");
+      is->retry_at = now + retry_backoff (is->timeouts);
+      next = MIN (next, is->retry_at);
+      continue;
+    }
+    is->state = OInterest_waiting;
+    is->requested = now;
+    me->stats.reexpressions++;
+  }
+  return next;
+}
+
+/**
+ * Gives up on missing segments that are holding up data past its deadline
+ *
+ * With a long interest lifetime, a single lost segment would freeze the stream
+ * until it has timed out several times over. Instead, once data queued behind a hole
+ * has waited longer than hole_wait() allows, we give up on every segment still
+ * missing ahead of it and carry on; the next buffer is flagged as a discontinuity.
+ * Interests we give up on may still be answered, those late arrivals are thrown out.
+ *
+ * \param me		source context holding the interest array
+ */
+static void
+check_holes (Gstccnxsrc * me)
+{
+  CcnxInterestState *queued = NULL;
+  CcnxInterestState *is;
+  GstClockTime wait;
+  GstClockTime now;
+  gint i;
+
+  wait = hole_wait (me);
+  if (GST_CLOCK_TIME_NONE == wait)
+    return;
+  now = gst_util_get_timestamp ();
+
+  /* Find the furthest segment that has waited too long */
+  for (i = 0; i < me->window; ++i) {
+    is = &(me->intStates[i]);
+    if (OInterest_havedata == is->state && now - is->arrived >= wait
+        && (NULL == queued || is->seg > queued->seg))
+      queued = is;
+  }
+  if (NULL == queued)
+    return;
+
+  /* Everything still missing ahead of it is abandoned */
+  for (i = 0; i < me->window; ++i) {
+    is = &(me->intStates[i]);
+    if (OInterest_idle != is->state && OInterest_havedata != is->state
+        && is->seg < queued->seg) {
+      GST_LOG_OBJECT (me, "hole wait expired, skipping segment: %d", is->seg);
+      freeInterestState (me, is);
+    }
+  }
+  drain_queued_segments (me);
+  post_next_interest (me);
+}
+
+/**
+ * Releases a signature check job
+ *
+ * \param jobp		the job; set to NULL
+ */
+static void
+verify_job_free (CcnxVerifyJob ** jobp)
+{
+  CcnxVerifyJob *job = *jobp;
+
+  if (NULL == job)
+    return;
+  ccn_charbuf_destroy (&job->ccnb);
+  ccn_indexbuf_destroy (&job->comps);
+  free (job);
+  *jobp = NULL;
+}
+
+/**
+ * Checks the signature of one content object; run by the worker threads
+ *
+ * Nothing is touched but the job and our key, which the workers only read. A byte
+ * written to the wake-up pipe gets the event thread to take the job back.
+ *
+ * \param data		the job
+ * \param user_data	source context holding the key and the queue of finished jobs
+ */
+static void
+verify_job (gpointer data, gpointer user_data)
+{
+  CcnxVerifyJob *job = data;
+  Gstccnxsrc *me = user_data;
+
+  job->ok = 1 == ccn_verify_signature (job->ccnb->buf, job->ccnb->length,
+      &job->pco, ccn_keystore_public_key (me->verify_key));
+  g_async_queue_push (me->verified, job);
+#ifndef WIN32
+  if (me->verify_wake[1] >= 0 && write (me->verify_wake[1], "", 1) < 0)
+    GST_LOG_OBJECT (me, "wake-up pipe is full, the event thread is awake already");
+#endif
+}
+
+/**
+ * Hands unverified content to the worker pool, if we hold the key it was signed with
+ *
+ * The content object and its parse are copied, since libccn reuses its buffers once the
+ * upcall returns. Content signed with another key is left for libccn to check; it knows
+ * how to go and get that key.
+ *
+ * \param me		source context holding the worker pool
+ * \param info		the content upcall
+ * \return true if the content was handed over, false if it is to be checked inline
+ */
+static gboolean
+verify_offload (Gstccnxsrc * me, struct ccn_upcall_info *info)
+{
+  CcnxVerifyJob *job;
+  const unsigned char *digest;
+  size_t size;
+
+  if (NULL == me->verify_pool
+      || ccn_ref_tagged_BLOB (CCN_DTAG_PublisherPublicKeyDigest,
+          info->content_ccnb,
+          info->pco->offset[CCN_PCO_B_PublisherPublicKeyDigest],
+          info->pco->offset[CCN_PCO_E_PublisherPublicKeyDigest], &digest,
+          &size) < 0
+      || size != ccn_keystore_public_key_digest_length (me->verify_key)
+      || memcmp (digest, ccn_keystore_public_key_digest (me->verify_key),
+          size))
+    return FALSE;
+  if ((job = calloc (1, sizeof (*job))) == NULL)
+    return FALSE;
+  job->ccnb = ccn_charbuf_create ();
+  job->comps = ccn_indexbuf_create ();
+  if (NULL == job->ccnb || NULL == job->comps
+      || ccn_charbuf_append (job->ccnb, info->content_ccnb,
+          info->pco->offset[CCN_PCO_E]) < 0
+      || ccn_indexbuf_append (job->comps, info->content_comps->buf,
+          info->content_comps->n) < 0) {
+    verify_job_free (&job);
+    return FALSE;
+  }
+  job->pco = *info->pco;
+  me->verify_pending++;
+  g_thread_pool_push (me->verify_pool, job, NULL);
+  return TRUE;
+}
+
 /**
  * Main working loop for stuff coming in from the CCNx network
  *
@@ -1275,38 +4082,33 @@ incoming_content (struct ccn_closure *selfp,
 {
   Gstccnxsrc *me = GST_CCNXSRC (selfp->data);
 
-  const unsigned char *ccnb = NULL;
-  size_t ccnb_size = 0;
-  const unsigned char *ib = NULL;       /* info->interest_ccnb */
-  struct ccn_indexbuf *ic = NULL;
-  unsigned int i;
   uintmax_t segment;
   CcnxInterestState *istate = NULL;
-  gint res;
-  const unsigned char *cp;
-  size_t sz;
+  struct ccn_segment_info si;
   const unsigned char *data = NULL;
   size_t data_size = 0;
   gboolean b_last = FALSE;
+  GstClockTime now;
+  gint pfx = 0;
+  gint r;
+  gsize skip;
 
-  GST_INFO ("content has arrived!");
+  CCNX_TRACE ("content has arrived!");
 
   /* Do some basic sanity and type checks to see if we want to process this data */
 
   if (CCN_UPCALL_FINAL == kind) {
     GST_LOG_OBJECT (me, "CCN upcall final %p", selfp);
-    if (me->i_bufoffset > 0) {
-      GST_BUFFER_SIZE (me->buf) = me->i_bufoffset;
-      fifo_put (me, me->buf);
-      me->buf = gst_buffer_new_and_alloc (CCN_FIFO_BLOCK_SIZE);
-      me->i_bufoffset = 0;
+    if (selfp != me->ccn_closure) {     /* retired by resume_interests() */
+      free (selfp);
+      return (CCN_UPCALL_RESULT_OK);
     }
+    if (me->i_bufoffset > 0)
+      push_buffer (me);
 /*
  * Should emit an eos here instead of the empty buffer
  */
-    GST_BUFFER_SIZE (me->buf) = 0;
-    fifo_put (me, me->buf);
-    me->i_bufoffset = 0;
+    push_buffer (me);
     return (CCN_UPCALL_RESULT_OK);
   }
 
@@ -1322,20 +4124,51 @@ incoming_content (struct ccn_closure *selfp,
     }
     segment =
         ccn_ccnb_fetch_segment (info->interest_ccnb, info->interest_comps);
-    GST_INFO ("...looks to be for segment: %d", segment);
-    GST_LOG_OBJECT (me, "CCN upcall reexpress -- timed out");
+    CCNX_TRACE_OBJECT (me, "CCN upcall reexpress -- timed out, segment %d",
+        segment);
+    me->stats.timeouts++;
+    if (me->n_rends > 0 && !rendition_segment (me,
+            info->interest_ccnb + info->pi->offset[CCN_PI_B_Name], &segment,
+            &r))
+      return (CCN_UPCALL_RESULT_OK);    /* asked before a switch, and asked again since */
     istate = fetchSegmentInterest (me, segment);
-    if (istate) {
+    if (me->n_prefixes > 1)
+      pfx = match_prefix (me,
+          info->interest_ccnb + info->pi->offset[CCN_PI_B_Name]);
+    if (pfx >= 0) {
+      me->prefixes[pfx].loss += (1.0 - me->prefixes[pfx].loss) / 8;
+      if (istate)
+        istate->timed_out |= 1u << pfx;
+    }
+    if (istate && CCNX_SRC_MODE_RELIABLE == me->run_mode) {
+      /* never give up, but back off before asking again; the event thread re-sends it */
+      /* another publisher may well have it though, so those are asked right away */
+      istate->timeouts++;
+      istate->state = OInterest_timeout;
+      istate->retry_at = gst_util_get_timestamp ();
+      if (!alternate_left (me, istate->timed_out))
+        istate->retry_at += retry_backoff (istate->timeouts);
+      return (CCN_UPCALL_RESULT_OK);
+    } else if (istate) {
       if (istate->timeouts > 5) {
         GST_LOG_OBJECT (me, "CCN upcall reexpress -- too many reexpressions");
-        if (segment == me->post_seg)    // We have been waiting for this one...process as an empty block to trigger other activity
+        if (segment == me->post_seg) {  // We have been waiting for this one...process as an empty block to trigger other activity
+          me->discont = TRUE;
+          me->stats.skipped++;
           process_or_queue (me, me->post_seg, NULL, 0, FALSE);
-        else
+        } else
           freeInterestState (me, istate);
         post_next_interest (me);        // make sure to ask for new stuff if needed, or else we stall waiting for nothing
         return (CCN_UPCALL_RESULT_OK);
       } else {
         istate->timeouts++;
+        istate->requested = gst_util_get_timestamp ();
+        me->stats.reexpressions++;
+        /* the publisher may just be slow; ask another before asking it again */
+        if (alternate_left (me, istate->timed_out)
+            && request_segment (me, segment) >= 0)
+          return (CCN_UPCALL_RESULT_OK);
+        me->stats.interests++;
         return (CCN_UPCALL_RESULT_REEXPRESS);
       }
     } else {
@@ -1348,76 +4181,98 @@ incoming_content (struct ccn_closure *selfp,
       GST_LOG_OBJECT (me, "CCN unverified content on dead closure %p", selfp);
       return (CCN_UPCALL_RESULT_OK);
     }
-    return (CCN_UPCALL_RESULT_VERIFY);
+    if (CCNX_SRC_VERIFY_OFFLOAD == me->verify && verify_offload (me, info))
+      return (CCN_UPCALL_RESULT_OK);    /* verify_drain() hands it back once checked */
+    if (CCNX_SRC_VERIFY_NONE != me->verify)
+      return (CCN_UPCALL_RESULT_VERIFY);
+    /* not checking, so on we go with it as it is */
 
   } else if (CCN_UPCALL_CONTENT != kind) {
     GST_LOG_OBJECT (me, "CCN upcall result error");
     return (CCN_UPCALL_RESULT_ERR);
   }
 
-  segment = ccn_ccnb_fetch_segment (info->content_ccnb, info->content_comps);
-  GST_INFO ("...looks to be for segment: %d", segment);
   if (selfp != me->ccn_closure) {
     GST_LOG_OBJECT (me, "CCN content on dead closure %p", selfp);
     return (CCN_UPCALL_RESULT_OK);
   }
 
+  if (me->capture
+      && capture_write (me->capture,
+          gst_util_get_timestamp () - me->capture_start, info->content_ccnb,
+          info->pco->offset[CCN_PCO_E]) < 0) {
+    GST_ELEMENT_WARNING (me, RESOURCE, WRITE, (NULL),
+        ("could not write to %s, capture stopped", me->capture_location));
+    capture_close (&me->capture);
+  }
 
   /* At this point it seems we have a data message we want to process */
 
-  ccnb = info->content_ccnb;
-  ccnb_size = info->pco->offset[CCN_PCO_E];
-
-  /* spit out some debug information */
-  for (i = 0; i < 5; ++i) {
-    GST_DEBUG ("%3d: ", i);
-    if (0 > ccn_name_comp_get (info->content_ccnb, info->content_comps, i, &cp,
-            &sz)) {
-      // fprintf(stderr, "could not get comp\n");
-    } else {
-      // hDump( DUMP_ADDR( cp ), DUMP_SIZE( sz ) );
-    }
-  }
-
-  /* go get the data and process it...note that the data pointer here is only temporary, a copy is needed to keep the data */
-  ib = info->interest_ccnb;
-  ic = info->interest_comps;
-  res = ccn_content_get_value (ccnb, ccnb_size, info->pco, &data, &data_size);
-  if (res < 0) {
+  /* one pass over what the parser already found...note that the data pointer here is only temporary, a copy is needed to keep the data */
+  if (0 > ccn_segment_parse (info->content_ccnb, info->pco,
+          info->content_comps, &si)) {
     GST_LOG_OBJECT (me, "CCN error on get value of size");
-    process_or_queue (me, segment, NULL, 0, FALSE);     // process null block to adjust interest array queue
+    segment = ccn_ccnb_fetch_segment (info->content_ccnb, info->content_comps);
+    if (0 == me->n_rends || rendition_segment (me,
+            info->content_ccnb + info->pco->offset[CCN_PCO_B_Name], &segment,
+            &r))
+      process_or_queue (me, segment, NULL, 0, FALSE);   // process null block to adjust interest array queue
     post_next_interest (me);    // Keep the data flowing
     return (CCN_UPCALL_RESULT_ERR);
   }
+  segment = si.segment;
+  data = si.data;
+  data_size = si.size;
+  me->stats.segments++;
+  me->stats.bytes += data_size;
+  CCNX_PROBE2 (content_arrive, segment, data_size);
+  CCNX_TRACE ("...looks to be for segment: %d", segment);
 
-  /* was this the last block? [code taken from a ccnx tool */
-  /* \todo  the test below should get refactored into the library */
-  if (info->pco->offset[CCN_PCO_B_FinalBlockID] !=
-      info->pco->offset[CCN_PCO_E_FinalBlockID]) {
-    const unsigned char *finalid = NULL;
-    size_t finalid_size = 0;
-    const unsigned char *nameid = NULL;
-    size_t nameid_size = 0;
-    struct ccn_indexbuf *cc = info->content_comps;
-    ccn_ref_tagged_BLOB (CCN_DTAG_FinalBlockID, ccnb,
-        info->pco->offset[CCN_PCO_B_FinalBlockID],
-        info->pco->offset[CCN_PCO_E_FinalBlockID], &finalid, &finalid_size);
-    if (cc->n < 2)
-      abort ();                 // \todo we need to behave better than this
-    ccn_ref_tagged_BLOB (CCN_DTAG_Component, ccnb,
-        cc->buf[cc->n - 2], cc->buf[cc->n - 1], &nameid, &nameid_size);
-    if (finalid_size == nameid_size
-        && 0 == memcmp (finalid, nameid, nameid_size)) {
-      b_last = TRUE;
-    }
-  }
+  /* was this the last block? */
+  b_last = si.last ? TRUE : FALSE;
 
   /* a short block can also indicate the end, if the client isn't using FinalBlockID */
   if (data_size < CCN_CHUNK_SIZE)
     b_last = TRUE;
 
+  /* with renditions, the segment's number and data are put the way we see them */
+  if (me->n_rends > 0) {
+    if (!rendition_segment (me,
+            info->content_ccnb + info->pco->offset[CCN_PCO_B_Name], &segment,
+            &r)) {
+      GST_LOG_OBJECT (me, "segment from the other side of a switch dropped");
+      return (CCN_UPCALL_RESULT_OK);
+    }
+    if (me->rend_next >= 0 && r == me->rend && segment + 1 == me->rend_at)
+      data_size = MIN (data_size, me->rend_keep);
+    else if (me->rend_next >= 0 && segment == me->rend_at) {
+      skip = MIN (data_size, me->rend_skip);
+      data += skip;
+      data_size -= skip;
+    }
+  }
+
+  /* measure the round trip, but only when we know which expression was answered */
+  now = gst_util_get_timestamp ();
+  me->seg_arrived = now;
+  istate = fetchSegmentInterest (me, segment);
+  if (istate && GST_CLOCK_TIME_NONE != istate->requested) {
+    histo_record (&me->lat_interest, now - istate->requested);
+    if (0 == istate->timeouts)
+      update_rtt (me, now - istate->requested);
+  }
+  if (me->n_prefixes > 1)
+    pfx = match_prefix (me,
+        info->content_ccnb + info->pco->offset[CCN_PCO_B_Name]);
+  if (pfx >= 0)
+    prefix_answered (me, pfx, istate, now);
+
   /* something to process */
-  process_or_queue (me, segment, data, data_size, b_last);
+  if (me->download_location)
+    bulk_store (me, segment, data, data_size);
+  else
+    process_or_queue (me, segment, data, data_size, b_last);
+  fec_have (me, segment, data, data_size, b_last);
   post_next_interest (me);
 
   if (!b_last)
@@ -1428,6 +4283,301 @@ incoming_content (struct ccn_closure *selfp,
 }
 
 
+/**
+ * Takes back the content the worker pool is done checking
+ *
+ * Content with a good signature goes through incoming_content() as if libccn had just
+ * verified it, so it is reordered with the rest by process_or_queue(); its round trip then
+ * includes the wait for a worker. A segment with a bad
+ * signature is thrown out and asked for again, as long as we are still waiting for it.
+ *
+ * \param me		source context holding the worker pool
+ */
+static void
+verify_drain (Gstccnxsrc * me)
+{
+  struct ccn_upcall_info info;
+  CcnxVerifyJob *job;
+  CcnxInterestState *is;
+  uintmax_t segment;
+  char wake[64];
+  gint r;
+
+  if (NULL == me->verified)
+    return;
+#ifndef WIN32
+  if (me->verify_wake[0] >= 0)
+    while (read (me->verify_wake[0], wake, sizeof (wake)) > 0)
+      continue;                 /* the bytes only wake us up; the jobs are in the queue */
+#endif
+  while ((job = g_async_queue_try_pop (me->verified)) != NULL) {
+    me->verify_pending--;
+    me->stats.offloaded++;
+    memset (&info, 0, sizeof (info));
+    info.h = me->ccn;
+    info.content_ccnb = job->ccnb->buf;
+    info.pco = &job->pco;
+    info.content_comps = job->comps;
+    if (job->ok) {
+      incoming_content (me->ccn_closure, CCN_UPCALL_CONTENT, &info);
+      verify_job_free (&job);
+      continue;
+    }
+    me->stats.bad_signatures++;
+    segment = ccn_ccnb_fetch_segment (job->ccnb->buf, job->comps);
+    GST_LOG_OBJECT (me, "bad signature on segment %d", segment);
+    if (0 == me->n_rends || rendition_segment (me,
+            job->ccnb->buf + job->pco.offset[CCN_PCO_B_Name], &segment, &r)) {
+      is = fetchSegmentInterest (me, segment);
+      if (is && OInterest_waiting == is->state
+          && request_segment (me, segment) >= 0) {
+        is->requested = gst_util_get_timestamp ();
+        me->stats.reexpressions++;
+      }
+    }
+    verify_job_free (&job);
+  }
+}
+
+/**
+ * Stops the worker pool, and releases what is left of its work
+ *
+ * Jobs still queued are checked before the pool goes; their results are thrown away.
+ *
+ * \param me		source context holding the worker pool
+ */
+static void
+close_verify (Gstccnxsrc * me)
+{
+  CcnxVerifyJob *job;
+
+  if (me->verify_pool)
+    g_thread_pool_free (me->verify_pool, FALSE, TRUE);
+  me->verify_pool = NULL;
+  if (me->verified) {
+    while ((job = g_async_queue_try_pop (me->verified)) != NULL)
+      verify_job_free (&job);
+    g_async_queue_unref (me->verified);
+    me->verified = NULL;
+  }
+  me->verify_pending = 0;
+#ifndef WIN32
+  if (me->verify_wake[0] >= 0) {
+    close (me->verify_wake[0]);
+    close (me->verify_wake[1]);
+  }
+#endif
+  me->verify_wake[0] = me->verify_wake[1] = -1;
+  ccn_keystore_destroy (&me->verify_key);
+}
+
+/**
+ * Starts the worker pool signatures are offloaded to, if we are asked to
+ *
+ * The workers check content signed with the key in our keystore, the one our own
+ * ccnxsink signs with; see fetchStore(). Without a keystore, everything is left to libccn.
+ *
+ * \param me		source context to hold the worker pool
+ * \return true if the pool is running, or is not wanted; false otherwise
+ */
+static gboolean
+open_verify (Gstccnxsrc * me)
+{
+  close_verify (me);
+  if (CCNX_SRC_VERIFY_OFFLOAD != me->verify)
+    return TRUE;
+  if ((me->verify_key = fetchStore ()) == NULL) {
+    GST_ELEMENT_WARNING (me, RESOURCE, NOT_FOUND, (NULL),
+        ("no keystore to check signatures with, libccn checks them instead"));
+    return TRUE;
+  }
+#ifndef WIN32
+  if (pipe (me->verify_wake) < 0) {
+    me->verify_wake[0] = me->verify_wake[1] = -1;
+  } else {                      /* neither side may block: the workers or the event thread */
+    fcntl (me->verify_wake[0], F_SETFL, O_NONBLOCK);
+    fcntl (me->verify_wake[1], F_SETFL, O_NONBLOCK);
+  }
+#endif
+  me->verified = g_async_queue_new ();
+  me->verify_pool = g_thread_pool_new (verify_job, me, me->verify_threads,
+      FALSE, NULL);
+  if (NULL == me->verified || NULL == me->verify_pool) {
+    GST_ELEMENT_ERROR (me, RESOURCE, READ, (NULL),
+        ("creating the signature workers failed"));
+    close_verify (me);
+    return FALSE;
+  }
+  GST_INFO ("checking signatures on %d threads", me->verify_threads);
+  return TRUE;
+}
+
+/**
+ * Finds the segment a capture's stream starts from
+ *
+ * Segment zero is always asked for first; the rest of the window started where the
+ * stream was when the capture was made. We take the lowest other segment among the
+ * first window's worth of objects, as they may have arrived out of order.
+ *
+ * \param me		source context with the capture open for replay
+ * \return the first segment after zero, 1 if none was found
+ */
+static uintmax_t
+replay_first_segment (Gstccnxsrc * me)
+{
+  struct ccn_charbuf *co = ccn_charbuf_create ();
+  struct ccn_indexbuf *comps = ccn_indexbuf_create ();
+  struct ccn_parsed_ContentObject pco;
+  struct ccn_segment_info si;
+  uintmax_t first = 0;
+  uint64_t ns;
+  gint i;
+
+  for (i = 0; i < me->window && capture_read (me->replay, &ns, co) > 0; ++i) {
+    if (ccn_parse_ContentObject (co->buf, co->length, &pco, comps) < 0
+        || ccn_segment_parse (co->buf, &pco, comps, &si) < 0)
+      continue;
+    if (si.segment > 0 && (0 == first || si.segment < first))
+      first = si.segment;
+  }
+  capture_rewind (me->replay);
+  ccn_indexbuf_destroy (&comps);
+  ccn_charbuf_destroy (&co);
+  return first ? first : 1;
+}
+
+/**
+ * Base loop for the background task when a capture is replayed
+ *
+ * Stands in for ccn_event_thread(): each object of the capture is handed to
+ * incoming_content(), as ccn_run() would have, at the time it arrived scaled by the
+ * replay speed, or straight away when the speed is 0. Interests never time out here,
+ * so at the end of the capture whatever it lacks is given up on, and the stream ended.
+ *
+ * \param data		the source context
+ */
+static void
+replay_thread (void *data)
+{
+  Gstccnxsrc *me = (Gstccnxsrc *) data;
+  struct ccn_charbuf *co;
+  struct ccn_indexbuf *comps;
+  struct ccn_parsed_ContentObject pco;
+  struct ccn_upcall_info info;
+  GstClockTime start;
+  GstClockTime due;
+  GstClockTime now;
+  uint64_t ns;
+  gint rc;
+  gint i;
+
+  if (NULL == me->replay) {     /* finished; nothing to do until we are stopped */
+    gst_task_pause (eventTask);
+    return;
+  }
+  GST_DEBUG ("*** replay thread starting");
+  co = ccn_charbuf_create ();
+  comps = ccn_indexbuf_create ();
+  memset (&info, 0, sizeof (info));
+  info.pco = &pco;
+  info.content_comps = comps;
+  start = gst_util_get_timestamp ();
+  while (!me->stopping && (rc = capture_read (me->replay, &ns, co)) > 0) {
+    if (me->replay_speed > 0) {
+      due = start + (GstClockTime) (ns / me->replay_speed);
+      now = gst_util_get_timestamp ();
+      if (due > now)
+        g_usleep ((due - now) / GST_USECOND);
+    }
+    if (ccn_parse_ContentObject (co->buf, co->length, &pco, comps) < 0) {
+      GST_LOG_OBJECT (me, "replay: skipping an object that does not parse");
+      continue;
+    }
+    info.content_ccnb = co->buf;
+    incoming_content (me->ccn_closure, CCN_UPCALL_CONTENT, &info);
+    check_holes (me);
+    post_stats (me);
+    capture_flush (me->capture);
+  }
+  if (rc < 0)
+    GST_ELEMENT_WARNING (me, RESOURCE, READ, (NULL),
+        ("capture %s is damaged, replay stopped early", me->replay_location));
+
+  for (i = 0; i < me->window; ++i) {
+    if (OInterest_idle != me->intStates[i].state
+        && OInterest_havedata != me->intStates[i].state) {
+      me->stats.skipped++;
+      freeInterestState (me, &me->intStates[i]);
+    }
+  }
+  drain_queued_segments (me);
+  incoming_content (me->ccn_closure, CCN_UPCALL_FINAL, NULL);
+  capture_close (&me->replay);
+  ccn_indexbuf_destroy (&comps);
+  ccn_charbuf_destroy (&co);
+  GST_DEBUG ("*** replay thread ending");
+}
+
+/**
+ * Starts replaying a capture in place of retrieving from the network
+ *
+ * The interest array is set up as gst_ccnxsrc_start() would, with segment zero and the
+ * window after it outstanding, but nothing is expressed; see request_segment().
+ *
+ * \param me		source context, its window already sized
+ * \return true if the replay started, false otherwise
+ */
+static gboolean
+replay_start (Gstccnxsrc * me)
+{
+  CcnxInterestState *istate;
+
+  capture_close (&me->replay);
+  if ((me->replay = capture_open (me->replay_location)) == NULL) {
+    GST_ELEMENT_ERROR (me, RESOURCE, OPEN_READ, (NULL),
+        ("could not open capture %s", me->replay_location));
+    return FALSE;
+  }
+  if ((me->ccn_closure = calloc (1, sizeof (struct ccn_closure))) == NULL) {
+    GST_ELEMENT_ERROR (me, RESOURCE, READ, (NULL), ("closure alloc failed"));
+    return FALSE;
+  }
+  me->ccn_closure->data = me;
+  me->ccn_closure->p = incoming_content;
+
+  me->i_seg = replay_first_segment (me);
+  me->post_seg = 0;
+  request_segment (me, 0);
+  istate = allocInterestState (me);
+  if (!istate) {
+    GST_ELEMENT_ERROR (me, RESOURCE, READ, (NULL),
+        ("trouble allocating interest state structure"));
+    return FALSE;
+  }
+  istate->seg = 0;
+  istate->state = OInterest_waiting;
+  istate->requested = gst_util_get_timestamp ();
+  post_next_interest (me);
+
+  eventTask = gst_task_create (replay_thread, me);
+  if (NULL == eventTask) {
+    GST_ELEMENT_ERROR (me, RESOURCE, READ, (NULL),
+        ("creating replay thread failed"));
+    return FALSE;
+  }
+  me->fifo_cond = g_cond_new ();
+  me->fifo_lock = g_mutex_new ();
+  gst_task_set_lock (eventTask, &task_mutex);
+  if (!gst_task_start (eventTask)) {
+    GST_ELEMENT_ERROR (me, RESOURCE, READ, (NULL),
+        ("starting replay thread failed"));
+    return FALSE;
+  }
+  GST_DEBUG ("replay of %s started", me->replay_location);
+  return TRUE;
+}
+
+
 /*** GSTURIHANDLER INTERFACE *************************************************/
 
 /**
@@ -1541,4 +4691,57 @@ gst_ccnxsrc_uri_handler_init (gpointer g_iface, /*@unused@ */
  * Details of how the FIFO queue works can be found at \ref SINKFIFOQUEUE.
  * For a discussion of content naming, please see the complement information in \subpage CCNSINKDESIGN.
  * Specifically see section \ref SINKCCNNAMING.
+ *
+ * \section SRCLOSS Dealing With Lost Segments
+ *
+ * Segments are posted to the pipeline strictly in order, so a segment that never arrives
+ * holds up everything behind it. By default we re-express its interest several times
+ * before giving up and skipping it. For live media that can be far too long; the
+ * \em max-hole-wait attribute bounds how long data already received may wait behind
+ * the missing segment. A value of -1 derives that bound from the measured round trip time.
+ * Whenever segments are skipped, the next buffer is flagged with GST_BUFFER_FLAG_DISCONT
+ * so the decoders downstream resync right away.
+ *
+ * \section SRCMODE Live and Reliable Retrieval
+ *
+ * The \em mode attribute chooses between the two. In \em live mode, the default, we start
+ * from the most recent segment and skip what cannot be had in time, as described above.
+ * In \em reliable mode we start from the first segment and never skip one: a timed out
+ * interest is parked and re-expressed by the event thread after a back off that doubles
+ * with each timeout. A larger window of interests, 64 unless \em window-size says otherwise,
+ * keeps the pipe full for bulk retrieval. Buffers carry their byte offset in the content,
+ * and a \em ccnxsrc-progress element message is posted every megabyte and at the end.
+ *
+ * \section SRCRANGE Random Access
+ *
+ * Demuxers for recorded formats, like MP4 and Matroska, want to read from anywhere in the file.
+ * Setting the \em random-access attribute makes the element operate in pull mode, in bytes.
+ * When started, we find the last segment of the versioned content, and from its size the size
+ * of the content; every other segment is full. A read then maps its byte range onto segments
+ * and is served from a cache of recently used segments. Interests go out for the window of
+ * segments following each one read, so reading forward seldom waits on the network.
+ * The network is worked from the streaming thread while a read waits; no background task runs.
+ *
+ * \section SRCBULK Downloading Into a File
+ *
+ * For archive retrieval the \em download-location attribute names a file to fetch the
+ * complete versioned object into. The file is sized from the last segment and mapped into
+ * memory, and up to 256 interests are kept in flight. Each segment is written to its final
+ * offset as it arrives and marked in a bitmap, freeing its interest slot right away instead of
+ * waiting in the reorder path for the segments ahead of it. The bytes that are contiguous from
+ * the start still flow down the pipeline in order. Retrieval is reliable, as described above.
+ *
+ * \section SRCSTATS Statistics
+ *
+ * The read-only \em stats attribute returns a \em ccnxsrc-stats structure with the counts of
+ * interests sent, re-expressions, timeouts, segments received, late, duplicated and skipped,
+ * the bytes received, the round trip time and its variation, the window size, how far segments
+ * have arrived out of order, and how full the FIFO queue is. Setting \em stats-interval to a
+ * number of msecs also posts the same structure as an element message that often.
+ * The counters are plain increments made by the thread working the network and are read
+ * without a lock, so keeping them costs next to nothing.
+ *
+ * For tuning the window and FIFO sizes, the read-only \em latency attribute gives log bucketed
+ * histograms of the time from an interest to its data, and from the data arriving to it being
+ * pushed downstream; setting \em reset-latency clears them.
  */
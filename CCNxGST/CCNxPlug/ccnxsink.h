@@ -38,6 +38,8 @@
 #include <ccn/charbuf.h>
 #include <ccn/uri.h>
 #include <ccn/header.h>
+#include "histo.h"
+#include "utils.h"
 
 
 G_BEGIN_DECLS
@@ -127,6 +129,44 @@ typedef struct _Gstccnxsink      Gstccnxsink;
 typedef struct _GstccnxsinkClass GstccnxsinkClass;
 
 
+/**
+ * Convenience definition
+ */
+typedef struct _CcnxChunkView CcnxChunkView;
+
+/**
+ * \brief A piece of a pipeline buffer, part of the next message we send
+ */
+struct _CcnxChunkView {
+  GstBuffer			 *buf;			/**< the pipeline buffer, which we hold a reference on */
+  guint				 offset;		/**< where in the buffer our piece starts */
+  guint				 size;			/**< number of bytes in our piece */
+  GstClockTime		 rendered;		/**< when the pipeline handed us the buffer */
+};
+
+/**
+ * Convenience definition
+ */
+typedef struct _CcnxSinkStats CcnxSinkStats;
+
+/**
+ * \brief Counters behind the stats attribute and the ccnxsink-stats messages
+ *
+ * Each counter is only ever written by one thread, with a plain increment; readers copy
+ * them without a lock and may see them a packet out of date.
+ */
+struct _CcnxSinkStats {
+  guint64			 segments;		/**< segments encoded and signed */
+  guint64			 sign_time;		/**< nanoseconds spent encoding and signing segments */
+  guint64			 puts;			/**< messages handed to ccnd, meta data replies included */
+  guint64			 interests;		/**< interests that reached our filter */
+  guint64			 meta_requests;	/**< interests asking for our segment or keyframe meta data */
+  guint64			 keyframes;		/**< keyframes published, see the gops ring */
+  guint64			 parity;		/**< parity segments published */
+  guint64			 fifo_drops;	/**< pipeline buffers thrown away on a full FIFO queue; written by the streaming thread */
+  guint64			 reconnects;	/**< times the connection to ccnd was lost and made again */
+};
+
 /**
  * \brief Member data definition of our CCNx sink element
  */
@@ -139,20 +179,38 @@ struct _Gstccnxsink
 
   gchar				 *uri;			/**< URI we use to name the data we publish */
   struct ccn_charbuf *name;			/**< URI converted to a name */
+  struct ccn_seqname *seqname;		/**< encodes the names of the segments we publish under name */
   
   int				 timeouts;		/**< Keeps track of interests we submit that timeout; we give up if too many */
   struct ccn		 *ccn;			/**< -> to our ccn handle, needed in all ccn calls */
   struct ccn_closure *ccn_closure;	/**< -> defines the call-back from ccn when interests arrive */
   struct ccn_charbuf *p_template;	/**< -> template for interests expressed within ccn network */
   struct ccn_charbuf *temp;			/**< -> temporary character buffer */
-  struct ccn_charbuf *partial;		/**< -> buffer used to retain outbound message data until we have enough to send */
+  CcnxChunkView		 views[CCNX_SINK_MAX_VIEWS]; /**< pieces of pipeline buffers making up the next message to send */
+  gint				 n_views;		/**< number of views in use */
+  guint				 view_bytes;	/**< number of bytes the views add up to */
+  struct ccn_segenc	 *segenc;		/**< encodes and signs our messages straight from the views */
   struct ccn_charbuf *lastPublish;	/**< -> last buffer of data we published, in case we get an interest */
   struct ccn_charbuf *signed_info;	/**< -> our signature information for preparing our data to publish */
+  struct ccn_charbuf_pool *pool;	/**< -> charbufs reused for the messages we publish and the partial data */
   struct ccn_charbuf *keylocator;	/**< -> our key information encoded for inclusion into our published data */
   struct ccn_keystore *keystore;	/**< -> our security keys information */
   struct ccn_signing_params sp;		/**< used when preparing our data to be published */
   long    expire;					/**< keeps the time we label our data for expiration; very small for streaming data */
   long    segment;					/**< keeps track of what segment of data we have published up to */
+  struct ccn_gop gops[CCN_GOP_HISTORY]; /**< where the most recent keyframes start, a ring */
+  gint		gop_next;				/**< slot in gops the next keyframe goes in */
+  gint		n_gops;					/**< number of keyframes held in gops */
+  struct ccn_charbuf *gop_meta;		/**< -> where the reply to a keyframe meta request is built */
+  guint		fec;					/**< an element attribute; segments each parity segment covers, 0 for none */
+  struct ccn_seqname *fec_seqname;	/**< encodes the names of the parity segments, under name and CCN_FEC_COMPONENT */
+  struct ccn_charbuf *fec_parity;	/**< -> parity of the segments of the current group published so far */
+  guint		stats_interval;			/**< an element attribute; msecs between ccnxsink-stats messages, 0 for none */
+  GstClockTime stats_posted;		/**< when we last posted a ccnxsink-stats message */
+  CcnxSinkStats stats;				/**< counters describing how publishing is going */
+  struct ccn_histo lat_put;			/**< latency from the pipeline handing us data to its message being put */
+  volatile gboolean stopping;		/**< set by stop(); the event thread then gives up rather than reconnect */
+  volatile gboolean ending;		/**< set at the end of the stream, or stop(); the event thread then sends out the tail */
 
   GMutex	*fifo_lock;				/**< used in some cases when adding/removing entries from the queue */
   GCond		*fifo_cond;				/**< used with the fifo_lock to wait for a queue to change from full to not full */
@@ -160,6 +218,7 @@ struct _Gstccnxsink
   GstBuffer* buf;					/**< assembles sink buffers into fifo buffers before queuing */
   GstBuffer* obuf;					/**< hold the buffer, from the fifo, being sent out as CCN packets */
   GstBuffer* fifo[CCNX_SINK_FIFO_MAX]; /**< the FIFO queue between the pipeline and the ccn network data delivery */
+  GstClockTime fifo_rendered[CCNX_SINK_FIFO_MAX]; /**< when the pipeline handed us each queued buffer */
   int		fifo_head;				/**< index to the head of the FIFO queue; for the reader */
   int		fifo_tail;				/**< index to the tail of the FIFO queue; for the writer */
 
@@ -39,6 +39,9 @@
 #include <ccn/charbuf.h>
 #include <ccn/uri.h>
 #include <ccn/header.h>
+#include "histo.h"
+#include "capture.h"
+#include "utils.h"
 
 
 G_BEGIN_DECLS
@@ -126,7 +129,32 @@ typedef struct _GstccnxsrcClass GstccnxsrcClass;
  * Convenience definition
  */
 typedef struct _CcnxInterestState CcnxInterestState;
+typedef struct _CcnxSegCacheEntry CcnxSegCacheEntry;
 typedef enum _OInterestState OInterestState;
+typedef enum _CcnxSrcMode CcnxSrcMode;
+typedef enum _CcnxSrcVerify CcnxSrcVerify;
+typedef struct _CcnxSrcStats CcnxSrcStats;
+typedef struct _CcnxSrcPrefix CcnxSrcPrefix;
+typedef struct _CcnxSrcRendition CcnxSrcRendition;
+typedef struct _CcnxFecGroup CcnxFecGroup;
+typedef struct _CcnxVerifyJob CcnxVerifyJob;
+
+/**
+ * How the source element treats segments it has trouble getting
+ */
+enum _CcnxSrcMode {
+	CCNX_SRC_MODE_LIVE			/**< Keep up with the stream; segments that do not arrive in time are skipped */
+	, CCNX_SRC_MODE_RELIABLE	/**< Fetch every segment from the start, no matter how long it takes */
+};
+
+/**
+ * Where the signatures of the content we receive are checked
+ */
+enum _CcnxSrcVerify {
+	CCNX_SRC_VERIFY_INLINE		/**< By libccn, on the thread working the ccn handle */
+	, CCNX_SRC_VERIFY_OFFLOAD	/**< By a pool of worker threads, when signed with a key we hold */
+	, CCNX_SRC_VERIFY_NONE		/**< Not at all; for trusted networks and benchmarks */
+};
 
 /**
  * Outstanding interest have one of these states
@@ -149,9 +177,100 @@ struct _CcnxInterestState {
 	guchar				*data;			/**< where the data is being held */
 	size_t				size;			/**< how much data we have */
 	gint				timeouts;		/**< count of how many times we asked for this data */
+	GstClockTime		requested;		/**< when we last expressed the interest for this segment */
+	GstClockTime		arrived;		/**< when the data arrived, used to age segments waiting behind a hole */
+	GstClockTime		retry_at;		/**< when a timed out interest is due to be expressed again */
+	guint				timed_out;		/**< bit mask of the prefixes an interest for this segment timed out under */
+};
+
+/**
+ * \brief Holds one segment in the cache used when serving random access reads
+ */
+struct _CcnxSegCacheEntry {
+	OInterestState		state;			/**< idle, waiting on the network, timed out, or holding data */
+	uintmax_t			seg;			/**< segment number held in this entry */
+	guchar				*data;			/**< the segment content, CCN_CHUNK_SIZE bytes are allocated */
+	size_t				size;			/**< how much data we have */
+	gint				timeouts;		/**< count of how many times the interest timed out */
+	guint64				used;			/**< when this entry was last touched, for least recently used replacement */
 };
 
 
+/**
+ * \brief Counters behind the stats attribute and the ccnxsrc-stats messages
+ *
+ * Each counter is only ever written by the thread working the ccn handle, with a plain
+ * increment; readers copy them without a lock and may see them a packet out of date.
+ * On a 32-bit host a guint64 is written in two halves, so a reader can also catch one
+ * as its low half carries into the high one, and see it off by as much as 2^32 for
+ * that one read. The next read is right again; the counters are for monitoring only.
+ */
+struct _CcnxSrcStats {
+	guint64		interests;				/**< interests expressed, re-expressions included */
+	guint64		reexpressions;			/**< interests expressed again after timing out */
+	guint64		timeouts;				/**< interests that timed out */
+	guint64		segments;				/**< segments received */
+	guint64		late;					/**< segments that arrived after we had moved past them */
+	guint64		duplicates;				/**< segments received that we had not asked for, or already had */
+	guint64		skipped;				/**< segments given up on */
+	guint64		bytes;					/**< payload bytes received */
+	guint64		reorder_depth;			/**< furthest a segment has arrived ahead of the one we needed */
+	guint64		reconnects;				/**< times the connection to ccnd was lost and made again */
+	guint64		switches;				/**< timed out segments asked for again under another prefix */
+	guint64		rendition_switches;		/**< times we moved to another rendition of the stream */
+	guint64		parity;					/**< parity segments received */
+	guint64		parity_bytes;			/**< payload bytes of the parity segments received, the cost of the parity */
+	guint64		recovered;				/**< segments rebuilt from parity rather than received */
+	guint64		offloaded;				/**< signatures checked by the worker pool */
+	guint64		bad_signatures;			/**< segments thrown out by the worker pool for a bad signature */
+};
+
+/**
+ * \brief One of the equivalent prefixes a stream is fetched under
+ *
+ * Kept up to date by the thread working the ccn handle, like the counters above.
+ */
+struct _CcnxSrcPrefix {
+	struct ccn_seqname	*seqname;		/**< encodes segment names under this prefix; borrowed from p_seqname for the first */
+	GstClockTime		srtt;			/**< smoothed round trip of answers under this prefix, 0 until measured */
+	gdouble				loss;			/**< smoothed fraction of interests under this prefix that time out */
+	guint64				interests;		/**< interests expressed under this prefix */
+	guint64				segments;		/**< segments received under this prefix */
+};
+
+/**
+ * \brief One rendition of a stream, published under its own name below the uri
+ */
+struct _CcnxSrcRendition {
+	gchar				*name;			/**< name component the rendition is published under */
+	guint				bitrate;		/**< its bitrate, in kbit/s */
+	struct ccn_charbuf	*vname;			/**< uri, name and the version it resolved to */
+	struct ccn_seqname	*seqname;		/**< encodes segment names under vname */
+	struct ccn_gop		gops[CCN_GOP_HISTORY]; /**< where its recent keyframes start, as last fetched */
+	gint				n_gops;			/**< number of keyframes in gops */
+};
+
+/**
+ * \brief A group of segments covered by one parity segment, as far as it has arrived
+ */
+struct _CcnxFecGroup {
+	gboolean			active;			/**< this slot holds a group */
+	uintmax_t			group;			/**< number of the group; its first segment divided by fec_group */
+	guint32				have;			/**< segments of the group folded into block, a bit each */
+	gboolean			parity;			/**< the parity segment has been folded into block */
+	struct ccn_charbuf	*block;			/**< XOR of the parity and the segments received; see fec_fold() */
+};
+
+/**
+ * \brief A content object waiting on, or done with, a signature check by the worker pool
+ */
+struct _CcnxVerifyJob {
+	struct ccn_charbuf	*ccnb;			/**< copy of the content object */
+	struct ccn_parsed_ContentObject pco; /**< where its parts are in ccnb */
+	struct ccn_indexbuf	*comps;			/**< where its name components are in ccnb */
+	gboolean			ok;				/**< set by the worker when the signature checks out */
+};
+
 /**
  * \brief Member data definition of our CCNx src element
  */
@@ -163,22 +282,109 @@ struct _Gstccnxsrc
   GstCaps		*caps;					/**< -> capabilities definition */
 
   gchar			*uri;					/**< URI we use to name the data we have interest in */
+  CcnxSrcMode	mode;					/**< an element attribute; live or reliable retrieval */
+  CcnxSrcMode	run_mode;				/**< the mode this run retrieves in; mode, unless downloading */
+  gboolean		random_access;			/**< an element attribute; serve byte ranges of finite content in pull mode */
+  gint			window_size;			/**< an element attribute; 0 picks a window suited to the mode */
+  gint			window;					/**< size of the window of outstanding interests, and of the intStates array */
   gint			intWindow;				/**< count of outstanding interests we have */
   CcnxInterestState *intStates;			/**< array of outstanding interests state structures */
   uintmax_t		post_seg;				/**< keeps track of what segment we need to post to the pipeline next */
   uintmax_t		i_seg;					/**< keeps track of what segment we need to ask for next */
   size_t		i_pos;					/**< keeps track of where we are in the stream of bytes coming in */
   size_t		i_bufoffset;			/**< keeps track of where we are in filling of the next pipeline buffer */
-  struct ccn	*ccn;					/**< handle to the ccn context with which we interact */
+  guint64		i_offset;				/**< byte offset in the stream of the buffer being filled */
+  guint64		progress_mark;			/**< byte offset at which we next report our progress */
+  gboolean		discont;				/**< set when segments were skipped; the next buffer is flagged as a discontinuity */
+  gint			max_hole_wait;			/**< msecs data may wait behind a missing segment; 0 disables, -1 derives it from the RTT */
+  GstClockTime	srtt;					/**< smoothed round trip time of our interests */
+  GstClockTime	rttvar;					/**< round trip time variation of our interests */
+  gint			pacing_burst;			/**< an element attribute; interests that may go out back to back, 0 disables pacing */
+  gdouble		pace_tokens;			/**< interests that may be expressed now, refilled at the pacing rate */
+  GstClockTime	pace_last;				/**< when the token bucket was last refilled */
+  GstClockTime	pace_next;				/**< when the next paced interest may go out, GST_CLOCK_TIME_NONE if none is held back */
+  guint64		content_size;			/**< size in bytes of the content, when random access is used */
+  uintmax_t		last_seg;				/**< number of the last segment of the content, when random access is used */
+  CcnxSegCacheEntry *cache;				/**< array of cached segments used to serve random access reads */
+  gint			cache_size;				/**< number of entries in the segment cache */
+  guint64		cache_tick;				/**< counts cache accesses, for least recently used replacement */
+  volatile gboolean flushing;			/**< set while the base class wants create() to return quickly */
+  volatile gboolean stopping;			/**< set by stop(); the background task and its waits give up */
+  guint			stats_interval;			/**< an element attribute; msecs between ccnxsrc-stats messages, 0 for none */
+  GstClockTime	stats_posted;			/**< when we last posted a ccnxsrc-stats message */
+  CcnxSrcStats	stats;					/**< counters describing how the retrieval is going */
+  struct ccn_histo lat_interest;		/**< latency from expressing an interest to its content arriving */
+  struct ccn_histo lat_push;			/**< latency from content arriving to its buffer being handed downstream */
+  GstClockTime	seg_arrived;			/**< when the segment being processed arrived */
+  GstClockTime	buf_arrived;			/**< when the oldest data in the buffer being filled arrived */
+  gchar			*download_location;		/**< an element attribute; file a complete object is fetched into */
+  int			dl_fd;					/**< descriptor of the download file, -1 when not downloading */
+  guchar		*dl_map;				/**< the download file mapped into memory */
+  size_t		dl_map_size;			/**< how much of the download file is mapped */
+  guint8		*dl_done;				/**< bitmap of the segments written into the download file */
+  uintmax_t		dl_count;				/**< number of segments written into the download file */
+  guint64		dl_size;				/**< final size of the download file, known once the last segment arrives */
+  gchar			*capture_location;		/**< an element attribute; file every content object received is recorded in */
+  struct ccn_capture *capture;			/**< the capture being recorded, NULL when not capturing */
+  GstClockTime	capture_start;			/**< when the capture was created; arrival times are kept relative to it */
+  gchar			*replay_location;		/**< an element attribute; capture replayed in place of the network */
+  struct ccn_capture *replay;			/**< the capture being replayed, NULL once it is finished */
+  gdouble		replay_speed;			/**< an element attribute; replay speed relative to the recording, 0 for as fast as possible */
+  struct ccn	*ccn;					/**< handle to the ccn context with which we interact; the first of ccns */
+  struct ccn	*ccns[CCNX_SRC_MAX_CONNECTIONS]; /**< every connection to ccnd; segment interests are spread over them */
+  gint			n_ccns;					/**< number of connections in ccns */
+  gint			connections;			/**< an element attribute; number of connections to open */
+  gchar			*hosts;					/**< an element attribute; ccnds to connect to, NULL for the usual one */
+  gchar			**host_list;			/**< hosts split up, NULL when no hosts are given */
+  gint			n_hosts;				/**< number of entries in host_list */
+  gchar			*alternates;			/**< an element attribute; uris equivalent to uri, NULL for none */
+  CcnxSrcPrefix	prefixes[CCNX_SRC_MAX_PREFIXES]; /**< uri and its alternates; segments are asked for under the best */
+  gint			n_prefixes;				/**< number of prefixes in use, 1 without alternates */
+  gchar			*renditions;			/**< an element attribute; renditions below uri, as name:kbps, NULL for none */
+  CcnxSrcRendition rends[CCNX_SRC_MAX_RENDITIONS]; /**< the renditions, lowest bitrate first */
+  gint			n_rends;				/**< number of renditions, 0 when not switching between them */
+  gint			rend;					/**< rendition our segments come from */
+  uintmax_t		rend_shift;				/**< its segment number for each of ours is ours plus this */
+  gint			rend_next;				/**< rendition being switched to, -1 when none */
+  uintmax_t		rend_next_shift;		/**< its segment number for each of ours is ours plus this */
+  uintmax_t		rend_at;				/**< first of our segments taken from rend_next */
+  gsize			rend_keep;				/**< bytes of segment rend_at - 1 kept; they come before the keyframe */
+  gsize			rend_skip;				/**< bytes of segment rend_at left out; they come before the keyframe */
+  gint			rend_target;			/**< rendition whose keyframes we are fetching to switch to, -1 when none */
+  guint			rend_meta;				/**< keyframe lists received: 1 for rend, 2 for rend_target */
+  gint			rend_tries;				/**< times we fetched the keyframe lists for this switch */
+  struct ccn_closure *rend_closure;		/**< call-back for the keyframe lists */
+  GstClockTime	abr_checked;			/**< when we last weighed switching renditions */
+  guint64		abr_bytes;				/**< payload bytes received by then */
+  guint64		abr_troubles;			/**< timeouts and skipped segments by then */
+  gint			abr_good;				/**< periods in a row without trouble */
+  gdouble		goodput;				/**< smoothed payload bits per second received */
+  GstClockTime	rtt_min;				/**< shortest round trip since abr_checked */
+  guint			fec;					/**< an element attribute; segments each parity segment covers, 0 for no parity */
+  guint			fec_group;				/**< fec as it was when we started, 0 when parity is not fetched */
+  CcnxFecGroup	*fec_groups;			/**< groups we are gathering the parity of, a ring indexed by group number */
+  gint			n_fec_groups;			/**< number of slots in fec_groups, enough to span the window */
+  uintmax_t		fec_last;				/**< the stream's last segment, once one arrives saying so; UINTMAX_MAX until then */
+  struct ccn_seqname *fec_seqname;		/**< encodes the names of the parity segments of p_name */
+  struct ccn_closure *fec_closure;		/**< call-back for the parity segments */
+  CcnxSrcVerify	verify;					/**< an element attribute; where signatures are checked */
+  gint			verify_threads;			/**< an element attribute; worker threads checking signatures when offloading */
+  GThreadPool	*verify_pool;			/**< workers checking signatures, NULL when not offloading */
+  GAsyncQueue	*verified;				/**< jobs the workers are done with, for the thread working the ccn handle */
+  gint			verify_pending;			/**< jobs handed to the workers and not yet taken back */
+  int			verify_wake[2];			/**< pipe the workers write to, so the event thread wakes up for their work; -1 if none */
+  struct ccn_keystore *verify_key;		/**< holds the key content handed to the workers is signed with */
   struct ccn_closure *ccn_closure;		/**< defines the call-back information needed when ccn has something for us */
   struct ccn_signing_params sp;			/**< signing information used when we send interests out onto the network */
   struct ccn_charbuf *p_name;			/**< the ccn encoded name we show interest in */
+  struct ccn_seqname *p_seqname;		/**< encodes the names of the segments of p_name we ask for */
   struct ccn_charbuf *p_template;		/**< the interest template used to hole key information */
 
   GMutex		*fifo_lock;				/**< used in some cases when adding/removing entries from the queue */
   GCond			*fifo_cond;				/**< used with the fifo_lock to wait for a queue to change from full to not full */
   GstBuffer*    buf;					/**< used in holding data moving between the network and the pipeline */
   GstBuffer*	fifo[CCNX_SRC_FIFO_MAX]; /**< the FIFO queue between the ccn network and the pipeline data delivery */
+  GstClockTime	fifo_arrived[CCNX_SRC_FIFO_MAX]; /**< when the oldest data in each queued buffer arrived */
   gint			fifo_head;				/**< index to the head of the FIFO queue; for the reader */
   gint			fifo_tail;				/**< index to the tail of the FIFO queue; for the writer */
 
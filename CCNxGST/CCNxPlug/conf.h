@@ -37,6 +37,31 @@
  */
 #define CCNX_SRC_FIFO_MAX	5
 
+/**
+ * Most connections to ccnd a source spreads its interests over
+ */
+#define CCNX_SRC_MAX_CONNECTIONS	8
+
+/**
+ * Most equivalent prefixes a source fetches a stream under, its own uri included
+ */
+#define CCNX_SRC_MAX_PREFIXES	8
+
+/**
+ * Most renditions of a stream a source switches between
+ */
+#define CCNX_SRC_MAX_RENDITIONS	8
+
+/**
+ * Most worker threads a source checks signatures on
+ */
+#define CCNX_SRC_MAX_VERIFY_THREADS	64
+
+/**
+ * Most pipeline buffer pieces the sink gathers into one message before copying them together
+ */
+#define CCNX_SINK_MAX_VIEWS	32
+
 #ifdef WIN32
 #  include <windows.h>
    typedef long ssize_t;
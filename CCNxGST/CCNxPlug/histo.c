@@ -0,0 +1,241 @@
+/** \file histo.c
+ * \brief Log bucketed latency histograms, cheap enough to record on the hot paths
+ *
+ * Recording a sample finds its bucket with a few shifts and bumps two counters;
+ * nothing is allocated and no lock is taken. Working out percentiles and describing
+ * the histogram is left to whoever asks for it.
+ */
+/*
+ * GStreamer-CCNx, latency histograms
+ * Copyright (C) 2009, 2010 Alcatel-Lucent Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#ifdef WIN32
+#include "StdAfx.h"
+#endif
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "conf.h"
+
+#include <string.h>
+#include "histo.h"
+
+/**
+ * Position of the highest bit set in a value; 0 for 0 and 1
+ */
+static gint
+histo_msb (guint64 v)
+{
+  gint n = 0;
+
+  if (v >> 32) {
+    v >>= 32;
+    n += 32;
+  }
+  if (v >> 16) {
+    v >>= 16;
+    n += 16;
+  }
+  if (v >> 8) {
+    v >>= 8;
+    n += 8;
+  }
+  if (v >> 4) {
+    v >>= 4;
+    n += 4;
+  }
+  if (v >> 2) {
+    v >>= 2;
+    n += 2;
+  }
+  if (v >> 1)
+    n += 1;
+  return n;
+}
+
+/**
+ * Finds the bucket a value falls in
+ */
+static gint
+histo_bucket (guint64 v)
+{
+  gint msb;
+
+  if (v < (1 << HISTO_SUB_BITS))
+    return (gint) v;
+  msb = histo_msb (v);
+  return ((msb - HISTO_SUB_BITS + 1) << HISTO_SUB_BITS)
+      + (gint) ((v >> (msb - HISTO_SUB_BITS)) & ((1 << HISTO_SUB_BITS) - 1));
+}
+
+/**
+ * Smallest value falling in a bucket
+ */
+static guint64
+histo_lower (gint bucket)
+{
+  gint shift = (bucket >> HISTO_SUB_BITS) - 1;
+
+  if (shift < 0)
+    return bucket;
+  return ((guint64) ((1 << HISTO_SUB_BITS) + (bucket & ((1 << HISTO_SUB_BITS)
+                  - 1)))) << shift;
+}
+
+/**
+ * Clears a histogram
+ *
+ * Only the thread recording into the histogram may do this once recording has
+ * started; everybody else uses histo_reset().
+ *
+ * \param h		the histogram
+ */
+void
+histo_clear (struct ccn_histo *h)
+{
+  memset (h->counts, 0, sizeof (h->counts));
+  h->total = 0;
+  h->sum = 0;
+  h->min = G_MAXUINT64;
+  h->max = 0;
+  h->reset_done = h->reset_request;
+}
+
+/**
+ * Asks for a histogram to be cleared
+ *
+ * The recording thread clears it before taking its next sample.
+ *
+ * \param h		the histogram
+ */
+void
+histo_reset (struct ccn_histo *h)
+{
+  g_atomic_int_inc (&h->reset_request);
+}
+
+/**
+ * Adds one sample to a histogram
+ *
+ * \param h		the histogram
+ * \param value	the sample, normally in nanoseconds
+ */
+void
+histo_record (struct ccn_histo *h, guint64 value)
+{
+  if (G_UNLIKELY (h->reset_done != h->reset_request))
+    histo_clear (h);
+  h->counts[histo_bucket (value)]++;
+  h->total++;
+  h->sum += value;
+  if (value < h->min)
+    h->min = value;
+  if (value > h->max)
+    h->max = value;
+}
+
+/**
+ * Finds the value below which a fraction of a given number of samples lie
+ *
+ * \param h			the histogram
+ * \param total		number of samples, as the caller read it; not 0
+ * \param fraction	between 0 and 1
+ * \return the highest value of the bucket holding that sample, never above the largest sample
+ */
+static guint64
+percentile_of (const struct ccn_histo *h, guint64 total, gdouble fraction)
+{
+  guint64 want;
+  guint64 seen = 0;
+  gint i;
+
+  want = (guint64) (fraction * total + 0.5);
+  if (want < 1)
+    want = 1;
+  for (i = 0; i < HISTO_BUCKETS; ++i) {
+    seen += h->counts[i];
+    if (seen >= want)
+      return (i + 1 < HISTO_BUCKETS) ?
+          MIN (histo_lower (i + 1) - 1, h->max) : h->max;
+  }
+  return h->max;
+}
+
+/**
+ * Finds the value below which a fraction of the samples lie
+ *
+ * \param h			the histogram
+ * \param fraction	between 0 and 1; 0.99 gives the 99th percentile
+ * \return the highest value of the bucket holding that sample, never above the largest sample
+ */
+guint64
+histo_percentile (const struct ccn_histo *h, gdouble fraction)
+{
+  guint64 total = h->total;
+
+  return total ? percentile_of (h, total, fraction) : 0;
+}
+
+/**
+ * Describes a histogram in a GstStructure
+ *
+ * Besides the count, the smallest, mean and largest samples, and the 50th, 90th, 99th
+ * and 99.9th percentiles, the field \em buckets holds every non-empty bucket as
+ * "lower-bound:count" pairs separated by spaces, for plotting. A histogram with a reset
+ * pending is described as empty. The count and sum are read once, so a reset landing
+ * part way through cannot leave us dividing by zero.
+ *
+ * \param h		the histogram
+ * \param name	name given to the structure
+ * \return a new structure, owned by the caller
+ */
+GstStructure *
+histo_to_structure (const struct ccn_histo *h, const gchar * name)
+{
+  GstStructure *s;
+  GString *buckets;
+  guint64 total = h->total;
+  guint64 sum = h->sum;
+  gboolean empty;
+  gint i;
+
+  empty = (h->reset_done != h->reset_request) || 0 == total;
+  buckets = g_string_new (NULL);
+  for (i = 0; !empty && i < HISTO_BUCKETS; ++i)
+    if (h->counts[i])
+      g_string_append_printf (buckets, "%s%" G_GUINT64_FORMAT ":%"
+          G_GUINT64_FORMAT, buckets->len ? " " : "", histo_lower (i),
+          h->counts[i]);
+
+  s = gst_structure_new (name,
+      "count", G_TYPE_UINT64, empty ? (guint64) 0 : total,
+      "min", G_TYPE_UINT64, empty ? (guint64) 0 : h->min,
+      "mean", G_TYPE_UINT64, empty ? (guint64) 0 : sum / total,
+      "p50", G_TYPE_UINT64, empty ? (guint64) 0 : percentile_of (h, total, 0.5),
+      "p90", G_TYPE_UINT64, empty ? (guint64) 0 : percentile_of (h, total, 0.9),
+      "p99", G_TYPE_UINT64, empty ? (guint64) 0 : percentile_of (h, total, 0.99),
+      "p999", G_TYPE_UINT64, empty ? (guint64) 0 : percentile_of (h, total,
+          0.999),
+      "max", G_TYPE_UINT64, empty ? (guint64) 0 : h->max,
+      "buckets", G_TYPE_STRING, buckets->str, NULL);
+  g_string_free (buckets, TRUE);
+  return s;
+}
@@ -0,0 +1,85 @@
+/** \file histo.h
+
+\brief Log bucketed latency histograms, cheap enough to record on the hot paths
+
+*/
+/*
+ * GStreamer-CCNx, interface GStreamer media flow with a CCNx network
+ * Copyright (C) 2009, 2010 Alcatel-Lucent Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+#ifndef HISTO_H
+#define HISTO_H
+
+#include <gst/gst.h>
+
+/**
+ * Bits of each value kept below its leading bit; 16 buckets per power of two, about 6% wide
+ */
+#define HISTO_SUB_BITS	4
+
+/**
+ * Number of buckets needed to cover every 64 bit value
+ */
+#define HISTO_BUCKETS	((64 - HISTO_SUB_BITS + 1) << HISTO_SUB_BITS)
+
+/**
+ * \brief A histogram of latencies, in nanoseconds
+ *
+ * Values below 16 get a bucket each; above that, every power of two is split into 16
+ * buckets, so the relative error is the same whatever the scale, as in an HDR histogram.
+ * One thread records into a histogram; others may read it at any time without a lock,
+ * and see it at most a sample out of date. A reset asked for by another thread is carried
+ * out by the recording thread, at its next sample.
+ */
+struct ccn_histo {
+	guint64			counts[HISTO_BUCKETS];	/**< samples that fell in each bucket */
+	guint64			total;					/**< number of samples recorded */
+	guint64			sum;					/**< sum of the samples, for the mean */
+	guint64			min;					/**< smallest sample */
+	guint64			max;					/**< largest sample */
+	volatile gint	reset_request;			/**< bumped by anyone wanting the histogram cleared */
+	gint			reset_done;				/**< the last reset request the recorder carried out */
+};
+
+/*
+ * Clear a histogram; only for the recording thread, or before recording starts.
+ */
+void histo_clear( struct ccn_histo *h );
+
+/*
+ * Ask for a histogram to be cleared; safe from any thread.
+ */
+void histo_reset( struct ccn_histo *h );
+
+/*
+ * Add one sample to a histogram.
+ */
+void histo_record( struct ccn_histo *h, guint64 value );
+
+/*
+ * The value below which the given fraction of the samples lie, to the precision of a bucket.
+ */
+guint64 histo_percentile( const struct ccn_histo *h, gdouble fraction );
+
+/*
+ * Describe a histogram in a new structure of the given name: count, min, mean, percentiles, max,
+ * and the non-empty buckets as a string of "lower-bound:count" pairs.
+ */
+GstStructure* histo_to_structure( const struct ccn_histo *h, const gchar *name );
+
+#endif
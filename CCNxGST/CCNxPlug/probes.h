@@ -0,0 +1,64 @@
+/** \file probes.h
+
+\brief Static tracepoints for per-segment events in the source and sink
+
+Where the system has <sys/sdt.h>, these expand to USDT probes in the \b ccnx provider.
+A probe is a single nop in the instruction stream until a tracer attaches to it, so they
+stay compiled into production builds; perf, bpftrace, SystemTap and the like find them in
+the plug-in's ELF notes. Elsewhere they compile to nothing.
+
+The probes and their arguments:
+\li \b interest_express (segment) - an interest for a segment went to ccnd
+\li \b content_arrive (segment, size) - the payload of a segment arrived from ccnd
+\li \b reorder_insert (segment, depth) - a segment arrived early and waits; depth is how far ahead it is
+\li \b reorder_drain (segment, size) - a segment that waited is sent on to the pipeline
+\li \b src_fifo_put (size, offset), \b src_fifo_pop (size, offset) - source buffers on their FIFO
+\li \b sink_fifo_put (size), \b sink_fifo_pop (size) - rendered buffers on the sink's FIFO
+\li \b sign_start (segment, size), \b sign_end (segment, size) - encoding and signing a segment
+\li \b ccn_put (segment, size, result) - a signed segment handed to ccnd
+
+For example, the time spent signing each segment:
+\code
+bpftrace -e 'usdt:/usr/lib/gstreamer-0.10/libccnx.so:ccnx:sign_start { @s[arg0] = nsecs; }
+  usdt:/usr/lib/gstreamer-0.10/libccnx.so:ccnx:sign_end /@s[arg0]/ { @us = hist((nsecs - @s[arg0]) / 1000); delete(@s[arg0]); }'
+\endcode
+
+*/
+/*
+ * GStreamer-CCNx, interface GStreamer media flow with a CCNx network
+ * Copyright (C) 2009, 2010 Alcatel-Lucent Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+#ifndef CCNX_PROBES_H
+#define CCNX_PROBES_H
+
+#ifdef HAVE_SYS_SDT_H
+#  include <sys/sdt.h>
+
+#  define CCNX_PROBE1(name, a)			DTRACE_PROBE1 (ccnx, name, a)
+#  define CCNX_PROBE2(name, a, b)		DTRACE_PROBE2 (ccnx, name, a, b)
+#  define CCNX_PROBE3(name, a, b, c)	DTRACE_PROBE3 (ccnx, name, a, b, c)
+
+#else
+
+#  define CCNX_PROBE1(name, a)			do { } while (0)
+#  define CCNX_PROBE2(name, a, b)		do { } while (0)
+#  define CCNX_PROBE3(name, a, b, c)	do { } while (0)
+
+#endif
+
+#endif /* CCNX_PROBES_H */
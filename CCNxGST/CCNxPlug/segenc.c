@@ -0,0 +1,277 @@
+/** \file segenc.c
+ * \brief Encodes and signs content objects whose data is spread over several buffers
+ *
+ * The ccn library wants the data of a content object in one piece. When the data
+ * we publish straddles two pipeline buffers that means copying it together first.
+ * Here we do the encoding ourselves, the way ccn_encode_ContentObject() does,
+ * feeding each piece to the signature and then to the output in turn.
+ *
+ * The segments of a stream differ only in their name, timestamp, data and signature.
+ * So the SignedInfo is encoded once, as a template, and only its timestamp is
+ * rewritten for each segment. The content header is kept for as long as the
+ * segments stay the same size, which they all do but the last.
+ *
+ */
+/*
+ * GStreamer-CCNx, content object encoding
+ * Copyright (C) 2009, 2010 Alcatel-Lucent Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#ifdef WIN32
+#include "StdAfx.h"
+#endif
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "conf.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "segenc.h"
+#include "utils.h"
+#include <ccn/keystore.h>
+
+/**
+ * Number of bytes in the timestamps we encode; seconds in the upper bits, 1/4096ths in the low 12
+ */
+#define SEGENC_TS_BYTES 6
+
+/**
+ * \brief State kept between encodings, so little is allocated per content object
+ */
+struct ccn_segenc {
+	struct ccn					*h;				/**< ccn handle, used when ccn_sign_content() does the work */
+	struct ccn_signing_params	sp;				/**< signing parameters of the publisher */
+	struct ccn_keystore			*keystore;		/**< keys we sign with; NULL if we fall back on ccn_sign_content() */
+	struct ccn_charbuf			*keylocator;	/**< encoded key locator included in each object */
+	struct ccn_sigc				*sigc;			/**< signing context, reused for each object */
+	struct ccn_signature		*signature;		/**< room for the largest signature */
+	struct ccn_charbuf			*signed_info;	/**< the signed info template; only the timestamp changes */
+	size_t						ts_offset;		/**< where the timestamp bytes are in the signed info */
+	struct ccn_charbuf			*header;		/**< the start and end of the content element */
+	size_t						header_size;	/**< content size the header was encoded for */
+	struct ccn_charbuf			*scratch;		/**< where the pieces are gathered for ccn_sign_content() */
+};
+
+/**
+ * Encode the SignedInfo template
+ *
+ * This is what ccn_signed_info_create() produces for data, except that the
+ * timestamp is always SEGENC_TS_BYTES long so it can be rewritten in place.
+ *
+ * \param enc		encoder whose template is built
+ * \return 0 on success, -1 otherwise
+ */
+static int
+build_signed_info (struct ccn_segenc *enc)
+{
+  struct ccn_charbuf *c = enc->signed_info;
+  int res = 0;
+
+  c->length = 0;
+  res |= ccn_charbuf_append_tt (c, CCN_DTAG_SignedInfo, CCN_DTAG);
+  res |= ccnb_append_tagged_blob (c, CCN_DTAG_PublisherPublicKeyDigest,
+      ccn_keystore_public_key_digest (enc->keystore),
+      ccn_keystore_public_key_digest_length (enc->keystore));
+  res |= ccn_charbuf_append_tt (c, CCN_DTAG_Timestamp, CCN_DTAG);
+  res |= ccn_charbuf_append_tt (c, SEGENC_TS_BYTES, CCN_BLOB);
+  enc->ts_offset = c->length;
+  res |= ccn_charbuf_reserve (c, SEGENC_TS_BYTES) == NULL ? -1 : 0;
+  c->length += SEGENC_TS_BYTES;
+  res |= ccn_charbuf_append_closer (c); /* </Timestamp> */
+  if (enc->sp.freshness >= 0)
+    res |= ccnb_tagged_putf (c, CCN_DTAG_FreshnessSeconds, "%d",
+        enc->sp.freshness);
+  res |= ccn_charbuf_append_charbuf (c, enc->keylocator);
+  res |= ccn_charbuf_append_closer (c); /* </SignedInfo> */
+  return res == 0 ? 0 : -1;
+}
+
+/**
+ * Rewrite the timestamp in the SignedInfo template with the current time
+ *
+ * \param enc		encoder holding the template
+ */
+static void
+stamp_signed_info (struct ccn_segenc *enc)
+{
+  struct timespec now;
+  unsigned long long ts;
+  unsigned char *p;
+  int i;
+
+  clock_gettime (CLOCK_REALTIME, &now);
+  /* the same arithmetic ccnb_append_timestamp_blob() uses for the fraction; */
+  /* rounding up to the next second carries into the seconds */
+  ts = ((unsigned long long) now.tv_sec << 12) +
+      ((unsigned) (now.tv_nsec / 5 * 8 + 195312) / 390625);
+  p = enc->signed_info->buf + enc->ts_offset;
+  for (i = SEGENC_TS_BYTES - 1; i >= 0; --i, ts >>= 8)
+    p[i] = ts & 0xff;
+}
+
+/**
+ * Create an encoder
+ *
+ * \param h		ccn handle of the publisher
+ * \param sp		signing parameters of the publisher; only the freshness is used when we sign ourselves
+ * \return the encoder, NULL if memory could not be had; destroy it with segenc_destroy()
+ */
+struct ccn_segenc *
+segenc_create (struct ccn *h, const struct ccn_signing_params *sp)
+{
+  struct ccn_segenc *enc;
+  size_t max;
+
+  enc = calloc (1, sizeof (struct ccn_segenc));
+  if (NULL == enc)
+    return NULL;
+  enc->h = h;
+  memcpy (&enc->sp, sp, sizeof (enc->sp));
+  enc->signed_info = ccn_charbuf_create ();
+  enc->header = ccn_charbuf_create ();
+  enc->scratch = ccn_charbuf_create ();
+  if (NULL == enc->signed_info || NULL == enc->header || NULL == enc->scratch) {
+    segenc_destroy (&enc);
+    return NULL;
+  }
+
+  enc->keystore = fetchStore ();
+  if (enc->keystore) {
+    enc->keylocator = makeLocator (ccn_keystore_public_key (enc->keystore));
+    enc->sigc = ccn_sigc_create ();
+    if (enc->sigc && 0 == ccn_sigc_init (enc->sigc, NULL,
+            ccn_keystore_private_key (enc->keystore))) {
+      max = ccn_sigc_signature_max_size (enc->sigc,
+          ccn_keystore_private_key (enc->keystore));
+      enc->signature = calloc (1, max);
+    }
+    if (NULL == enc->keylocator || NULL == enc->signature
+        || build_signed_info (enc) < 0) {
+      /* sign the slow way rather than not at all */
+      ccn_charbuf_destroy (&enc->keylocator);
+      ccn_sigc_destroy (&enc->sigc);
+      ccn_keystore_destroy (&enc->keystore);
+    }
+  }
+  return enc;
+}
+
+/**
+ * Encode and sign a content object, taking its data from several pieces
+ *
+ * The pieces go through the signature and are then appended to the object,
+ * with no copy in between.
+ *
+ * \param enc		the encoder
+ * \param out		where the encoded object is appended
+ * \param name		encoded name of the object
+ * \param views		the pieces of data, in order
+ * \param n_views	number of pieces
+ * \return 0 on success, -1 otherwise
+ */
+int
+segenc_encode (struct ccn_segenc *enc, struct ccn_charbuf *out,
+    const struct ccn_charbuf *name, const struct ccn_segview *views, int n_views)
+{
+  const void *key;
+  size_t size = 0;
+  size_t closer_start;
+  size_t sig_size = 0;
+  int res = 0;
+  int i;
+
+  for (i = 0; i < n_views; ++i)
+    size += views[i].size;
+
+  if (NULL == enc->keystore) {  /* gather the pieces, and let the library sign */
+    enc->scratch->length = 0;
+    for (i = 0; i < n_views; ++i)
+      ccn_charbuf_append (enc->scratch, views[i].data, views[i].size);
+    return ccn_sign_content (enc->h, out, name, &enc->sp, enc->scratch->buf,
+        size) == 0 ? 0 : -1;
+  }
+
+  key = ccn_keystore_private_key (enc->keystore);
+  stamp_signed_info (enc);
+
+  if (0 == enc->header->length || size != enc->header_size) {
+    enc->header->length = 0;
+    res |= ccn_charbuf_append_tt (enc->header, CCN_DTAG_Content, CCN_DTAG);
+    if (size != 0)
+      res |= ccn_charbuf_append_tt (enc->header, size, CCN_BLOB);
+    res |= ccn_charbuf_append_closer (enc->header);
+    if (res < 0) {
+      enc->header->length = 0;
+      return -1;
+    }
+    enc->header_size = size;
+  }
+  closer_start = enc->header->length - 1;       /* the closer is a single byte */
+
+  /* the signature covers the name, signed info and content, just as they are encoded */
+  res |= ccn_sigc_init (enc->sigc, NULL, key);
+  res |= ccn_sigc_update (enc->sigc, name->buf, name->length);
+  res |= ccn_sigc_update (enc->sigc, enc->signed_info->buf,
+      enc->signed_info->length);
+  res |= ccn_sigc_update (enc->sigc, enc->header->buf, closer_start);
+  for (i = 0; i < n_views; ++i)
+    res |= ccn_sigc_update (enc->sigc, views[i].data, views[i].size);
+  res |= ccn_sigc_update (enc->sigc, enc->header->buf + closer_start,
+      enc->header->length - closer_start);
+  res |= ccn_sigc_final (enc->sigc, enc->signature, &sig_size, key);
+  if (res != 0)
+    return -1;
+
+  res |= ccn_charbuf_append_tt (out, CCN_DTAG_ContentObject, CCN_DTAG);
+  res |= ccn_encode_Signature (out, NULL, NULL, 0, enc->signature, sig_size);
+  res |= ccn_charbuf_append_charbuf (out, name);
+  res |= ccn_charbuf_append_charbuf (out, enc->signed_info);
+  res |= ccn_charbuf_append (out, enc->header->buf, closer_start);
+  for (i = 0; i < n_views; ++i)
+    res |= ccn_charbuf_append (out, views[i].data, views[i].size);
+  res |= ccn_charbuf_append_closer (out);       /* </Content> */
+  res |= ccn_charbuf_append_closer (out);       /* </ContentObject> */
+  return res == 0 ? 0 : -1;
+}
+
+/**
+ * Release an encoder created by segenc_create()
+ *
+ * \param encp		points to the encoder, which is set to NULL
+ */
+void
+segenc_destroy (struct ccn_segenc **encp)
+{
+  struct ccn_segenc *enc = *encp;
+
+  if (NULL == enc)
+    return;
+  ccn_charbuf_destroy (&enc->keylocator);
+  ccn_sigc_destroy (&enc->sigc);
+  ccn_keystore_destroy (&enc->keystore);
+  free (enc->signature);
+  ccn_charbuf_destroy (&enc->signed_info);
+  ccn_charbuf_destroy (&enc->header);
+  ccn_charbuf_destroy (&enc->scratch);
+  free (enc);
+  *encp = NULL;
+}
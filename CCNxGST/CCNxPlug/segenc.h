@@ -0,0 +1,62 @@
+/** \file segenc.h
+
+\brief Encodes and signs content objects whose data is spread over several buffers
+
+*/
+/*
+ * GStreamer-CCNx, interface GStreamer media flow with a CCNx network
+ * Copyright (C) 2009, 2010 Alcatel-Lucent Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+#ifndef SEGENC_H
+#define SEGENC_H
+
+#include <ccn/ccn.h>
+#include <ccn/charbuf.h>
+#include <ccn/signing.h>
+
+/**
+ * \brief One piece of the data making up a content object
+ */
+struct ccn_segview {
+	const void		*data;		/**< where this piece of the data starts */
+	size_t			size;		/**< number of bytes in this piece */
+};
+
+/**
+ * Opaque encoder state; see segenc.c
+ */
+struct ccn_segenc;
+
+/*
+ * Create an encoder that signs with the keys of the user's keystore.
+ * Should the keystore not be available, ccn_sign_content() is used instead,
+ * after gathering the pieces into one buffer.
+ */
+struct ccn_segenc* segenc_create( struct ccn *h, const struct ccn_signing_params *sp );
+
+/*
+ * Encode and sign a content object into out, taking its data from the views given.
+ * Returns 0 on success, -1 otherwise.
+ */
+int segenc_encode( struct ccn_segenc *enc, struct ccn_charbuf *out,
+                   const struct ccn_charbuf *name,
+                   const struct ccn_segview *views, int n_views );
+
+void segenc_destroy( struct ccn_segenc **encp );
+
+#endif
@@ -0,0 +1,67 @@
+/** \file trace.h
+
+\brief Per-packet tracing for the source and sink hot paths
+
+Diagnostics come in two tiers. Element life cycle, errors and anything else that
+happens rarely keeps using GST_INFO, GST_LOG and their friends. What happens once
+for every packet uses the CCNX_TRACE macros below instead; they compile to nothing
+unless configure was run with --enable-hotpath-trace, and when compiled in they
+cost a single test of the debug threshold while the category is quiet.
+
+Formatting that is expensive in its own right, like turning an interest into a URI,
+belongs inside an <tt>if (CCNX_TRACE_ENABLED ())</tt> block so it only runs when
+someone is going to read the result.
+
+*/
+/*
+ * GStreamer-CCNx, interface GStreamer media flow with a CCNx network
+ * Copyright (C) 2009, 2010 Alcatel-Lucent Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+#ifndef CCNX_TRACE_H
+#define CCNX_TRACE_H
+
+#include <gst/gst.h>
+
+#if defined(CCNX_HOTPATH_TRACE) && !defined(GST_DISABLE_GST_DEBUG)
+
+/**
+ * True when per-packet trace output of the file's default category would be seen
+ */
+#  define CCNX_TRACE_ENABLED() \
+	G_UNLIKELY (GST_LEVEL_LOG <= __gst_debug_min \
+		&& GST_LEVEL_LOG <= gst_debug_category_get_threshold (GST_CAT_DEFAULT))
+
+/**
+ * Per-packet trace output, to the file's default category at LOG level
+ */
+#  define CCNX_TRACE(...)				GST_LOG (__VA_ARGS__)
+
+/**
+ * Per-packet trace output about an object, to the file's default category at LOG level
+ */
+#  define CCNX_TRACE_OBJECT(obj, ...)	GST_LOG_OBJECT (obj, __VA_ARGS__)
+
+#else
+
+#  define CCNX_TRACE_ENABLED()			(0)
+#  define CCNX_TRACE(...)				G_STMT_START { } G_STMT_END
+#  define CCNX_TRACE_OBJECT(obj, ...)	G_STMT_START { } G_STMT_END
+
+#endif
+
+#endif /* CCNX_TRACE_H */
@@ -62,8 +62,13 @@ const char *COPYRIGHT = " \
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
 #include "utils.h"
 #include <ccn/ccn.h>
+#include <ccn/coding.h>
 
 /**
  * Retrieve the host name where the ccnd router is located
@@ -259,6 +264,32 @@ msleep (int msecs)
   nanosleep (&tv, &rm);
 }
 
+/**
+ * How long to wait before trying to reach ccnd again
+ *
+ * The wait doubles with each failed attempt, from CCN_RECONNECT_MIN up to CCN_RECONNECT_MAX,
+ * so a ccnd that is only restarting is found again within a fraction of a second, while one
+ * that stays away is not hammered. Up to half of the wait is taken off at random, so the
+ * elements of many pipelines losing the same ccnd do not all come back at the same moment.
+ *
+ * \param attempt	number of attempts that have failed so far
+ * \return msecs to wait
+ */
+int
+reconnect_backoff (int attempt)
+{
+  static unsigned int seed;
+  int delay = CCN_RECONNECT_MIN;
+
+  if (0 == seed)
+    seed = getpid () ^ time (NULL);
+  while (attempt-- > 0 && delay < CCN_RECONNECT_MAX)
+    delay *= 2;
+  if (delay > CCN_RECONNECT_MAX)
+    delay = CCN_RECONNECT_MAX;
+  return delay - rand_r (&seed) % (delay / 2 + 1);
+}
+
 /**
  * Common routine for dumping out octal or hex
  *
@@ -467,6 +498,156 @@ compDump (struct ccn_charbuf *cbuf, int todo)
   ccn_indexbuf_destroy (&comps);
 }
 
+/**
+ * Create an encoder for the names of a stream's segments
+ *
+ * \param prefix	encoded name all the segment names start with
+ * \return the encoder, NULL if memory could not be had; destroy it with seqname_destroy()
+ */
+struct ccn_seqname *
+seqname_create (const struct ccn_charbuf *prefix)
+{
+  struct ccn_seqname *sn;
+
+  sn = calloc (1, sizeof (struct ccn_seqname));
+  if (NULL == sn)
+    return NULL;
+  sn->name = ccn_charbuf_create ();
+  if (NULL == sn->name || ccn_charbuf_append_charbuf (sn->name, prefix) < 0) {
+    seqname_destroy (&sn);
+    return NULL;
+  }
+  sn->prefix_len = sn->name->length;
+  return sn;
+}
+
+/**
+ * Encode the name of a segment
+ *
+ * The buffer is cut back to the prefix and the new sequence number appended,
+ * so once the buffer has grown large enough no more memory is allocated or copied.
+ *
+ * \param sn		encoder holding the prefix
+ * \param seq		sequence number of the segment
+ * \return the encoded name, NULL on error; it belongs to the encoder and is only good until the next call
+ */
+struct ccn_charbuf *
+seqname_encode (struct ccn_seqname *sn, uintmax_t seq)
+{
+  /* the last encoding wrote its component over the prefix's closer; put it back */
+  sn->name->length = sn->prefix_len;
+  sn->name->buf[sn->prefix_len - 1] = CCN_CLOSE;
+  if (ccn_name_append_numeric (sn->name, CCN_MARKER_SEQNUM, seq) < 0)
+    return NULL;
+  return sn->name;
+}
+
+/**
+ * Release an encoder created by seqname_create()
+ *
+ * \param snp		points to the encoder, which is set to NULL
+ */
+void
+seqname_destroy (struct ccn_seqname **snp)
+{
+  if (NULL == *snp)
+    return;
+  ccn_charbuf_destroy (&(*snp)->name);
+  free (*snp);
+  *snp = NULL;
+}
+
+/**
+ * Create a pool of reusable charbufs
+ *
+ * \param max_free	most idle charbufs the pool holds on to
+ * \param reserve	bytes to reserve up front in each charbuf the pool creates
+ * \return the pool, NULL if memory could not be had; destroy it with charbuf_pool_destroy()
+ */
+struct ccn_charbuf_pool *
+charbuf_pool_create (int max_free, size_t reserve)
+{
+  struct ccn_charbuf_pool *pool;
+
+  pool = calloc (1, sizeof (struct ccn_charbuf_pool));
+  if (NULL == pool)
+    return NULL;
+  pool->free = calloc (max_free, sizeof (struct ccn_charbuf *));
+  if (NULL == pool->free) {
+    free (pool);
+    return NULL;
+  }
+  pool->max_free = max_free;
+  pool->reserve = reserve;
+  return pool;
+}
+
+/**
+ * Get an empty charbuf from the pool
+ *
+ * Only when the pool has none to reuse is a new one created, and counted.
+ *
+ * \param pool		where the charbuf comes from
+ * \return an empty charbuf, NULL if memory could not be had
+ */
+struct ccn_charbuf *
+charbuf_pool_get (struct ccn_charbuf_pool *pool)
+{
+  struct ccn_charbuf *cb;
+
+  if (pool->n_free > 0) {
+    cb = pool->free[--pool->n_free];
+  } else {
+    cb = ccn_charbuf_create ();
+    if (NULL == cb)
+      return NULL;
+    pool->allocations++;
+    if (pool->reserve)
+      ccn_charbuf_reserve (cb, pool->reserve);
+  }
+  cb->length = 0;
+  return cb;
+}
+
+/**
+ * Return a charbuf to the pool
+ *
+ * Should the pool already hold all it cares to, the charbuf is destroyed.
+ *
+ * \param pool		where the charbuf goes back to
+ * \param cbp		points to the charbuf, which is set to NULL
+ */
+void
+charbuf_pool_put (struct ccn_charbuf_pool *pool, struct ccn_charbuf **cbp)
+{
+  if (NULL == *cbp)
+    return;
+  if (pool->n_free < pool->max_free)
+    pool->free[pool->n_free++] = *cbp;
+  else
+    ccn_charbuf_destroy (cbp);
+  *cbp = NULL;
+}
+
+/**
+ * Release a pool, and all the charbufs it holds
+ *
+ * \param poolp	points to the pool, which is set to NULL
+ */
+void
+charbuf_pool_destroy (struct ccn_charbuf_pool **poolp)
+{
+  struct ccn_charbuf_pool *pool = *poolp;
+
+  if (NULL == pool)
+    return;
+  while (pool->n_free > 0)
+    ccn_charbuf_destroy (&pool->free[--pool->n_free]);
+  free (pool->free);
+  free (pool);
+  *poolp = NULL;
+}
+
 uintmax_t
 ccn_ccnb_fetch_segment (const unsigned char *buf,
     const struct ccn_indexbuf *idx)
@@ -486,6 +667,232 @@ ccn_ccnb_fetch_segment (const unsigned char *buf,
   return ans;
 }
 
+/*
+ * Reads the ccnb token header at *pp, never looking at or beyond end.
+ * Returns the token type and leaves its value in *val, or -1 if the header runs off the end.
+ */
+static int
+ccnb_token (const unsigned char **pp, const unsigned char *end, size_t * val)
+{
+  const unsigned char *p = *pp;
+  size_t v = 0;
+
+  while (p < end && 0 == (*p & CCN_TT_HBIT))
+    v = (v << 7) + *p++;
+  if (p >= end)
+    return -1;
+  *val = (v << (7 - CCN_TT_BITS)) + ((*p >> CCN_TT_BITS) & CCN_MAX_TINY);
+  *pp = p + 1;
+  return *p & CCN_TT_MASK;
+}
+
+/*
+ * Finds the BLOB held by the element spanning [start, stop) of a ccnb buffer.
+ * An element holding no BLOB gives zero bytes.
+ * Returns 0, or -1 if the element is not a DTAG wrapping a BLOB.
+ */
+static int
+ccnb_element_blob (const unsigned char *ccnb, size_t start, size_t stop,
+    const unsigned char **blob, size_t * size)
+{
+  const unsigned char *p = ccnb + start;
+  const unsigned char *end = ccnb + stop;
+  size_t val;
+
+  if (p >= end || CCN_CLOSE == *p || CCN_DTAG != ccnb_token (&p, end, &val))
+    return -1;
+  if (p < end && CCN_CLOSE == *p) {
+    *blob = p;
+    *size = 0;
+    return 0;
+  }
+  if (CCN_BLOB != ccnb_token (&p, end, &val) || val > (size_t) (end - p))
+    return -1;
+  *blob = p;
+  *size = val;
+  return 0;
+}
+
+/**
+ * Appends one keyframe record to a _meta_/.gop reply
+ *
+ * \param out		the reply being built
+ * \param gop		the keyframe
+ */
+void
+gop_meta_append (struct ccn_charbuf *out, const struct ccn_gop *gop)
+{
+  unsigned char rec[CCN_GOP_RECORD];
+  int i;
+
+  for (i = 0; i < 8; ++i) {
+    rec[i] = gop->pts >> (56 - 8 * i);
+    rec[8 + i] = gop->segment >> (56 - 8 * i);
+  }
+  for (i = 0; i < 4; ++i)
+    rec[16 + i] = gop->offset >> (24 - 8 * i);
+  ccn_charbuf_append (out, rec, sizeof (rec));
+}
+
+/**
+ * Parses the keyframe records out of a _meta_/.gop reply
+ *
+ * \param data		the content of the reply
+ * \param size		its size; a partial record at the end is ignored
+ * \param gops		where the records are returned, oldest first
+ * \param max		room in gops
+ * \return number of records returned
+ */
+int
+gop_meta_parse (const unsigned char *data, size_t size, struct ccn_gop *gops,
+    int max)
+{
+  int n;
+  int i;
+
+  for (n = 0; n < max && size >= CCN_GOP_RECORD; ++n) {
+    gops[n].pts = 0;
+    gops[n].segment = 0;
+    gops[n].offset = 0;
+    for (i = 0; i < 8; ++i) {
+      gops[n].pts = (gops[n].pts << 8) | data[i];
+      gops[n].segment = (gops[n].segment << 8) | data[8 + i];
+    }
+    for (i = 0; i < 4; ++i)
+      gops[n].offset = (gops[n].offset << 8) | data[16 + i];
+    data += CCN_GOP_RECORD;
+    size -= CCN_GOP_RECORD;
+  }
+  return n;
+}
+
+/**
+ * XORs bytes into a parity block
+ *
+ * The block is grown with zeros to hold them; segments shorter than the longest of
+ * their group are so padded with zeros.
+ *
+ * \param block		the parity block
+ * \param offset	where in the block the bytes go
+ * \param data		the bytes
+ * \param size		how many there are
+ */
+void
+fec_fold (struct ccn_charbuf *block, size_t offset, const unsigned char *data,
+    size_t size)
+{
+  unsigned char *p;
+  size_t i;
+
+  if (offset + size > block->length) {
+    p = ccn_charbuf_reserve (block, offset + size - block->length);
+    if (NULL == p)
+      return;
+    memset (p, 0, offset + size - block->length);
+    block->length = offset + size;
+  }
+  p = block->buf + offset;
+  for (i = 0; i < size; ++i)
+    p[i] ^= data[i];
+}
+
+/**
+ * XORs the size of a segment's payload into the header of a parity block
+ *
+ * \param block		the parity block
+ * \param size		size of the payload folded in
+ */
+void
+fec_fold_size (struct ccn_charbuf *block, size_t size)
+{
+  unsigned char hdr[CCN_FEC_HEADER];
+  int i;
+
+  for (i = 0; i < CCN_FEC_HEADER; ++i)
+    hdr[i] = size >> (8 * (CCN_FEC_HEADER - 1 - i));
+  fec_fold (block, 0, hdr, sizeof (hdr));
+}
+
+/**
+ * Finds the one payload of a group missing from a parity block
+ *
+ * What is left once the parity and all the other segments have been folded in
+ * is the missing segment: its size in the header, and its payload after it.
+ *
+ * \param block		the parity block
+ * \param data		where we return the payload; it points into the block
+ * \param size		where we return its size
+ * \return 0, or -1 if the size found does not fit in the block
+ */
+int
+fec_recovered (const struct ccn_charbuf *block, const unsigned char **data,
+    size_t * size)
+{
+  size_t n = 0;
+  int i;
+
+  if (block->length < CCN_FEC_HEADER)
+    return -1;
+  for (i = 0; i < CCN_FEC_HEADER; ++i)
+    n = (n << 8) | block->buf[i];
+  if (n > block->length - CCN_FEC_HEADER)
+    return -1;
+  *data = block->buf + CCN_FEC_HEADER;
+  *size = n;
+  return 0;
+}
+
+/**
+ * Extracts what the source needs from a segment of content in a single pass
+ *
+ * This replaces the sequence of ccn_ccnb_fetch_segment(), ccn_content_get_value()
+ * and the two ccn_ref_tagged_BLOB() calls for the FinalBlockID. Nothing is decoded
+ * twice; each element is found directly from the offsets the parser left in the pco
+ * and the component index. The last component must be a sequence number, starting
+ * with CCN_MARKER_SEQNUM.
+ *
+ * \param ccnb		the encoded content object
+ * \param pco		the parsed content object
+ * \param comps		index of the name components
+ * \param si		where the results are returned; data points into ccnb
+ * \return 0 on success, -1 if the content object is not shaped like a segment
+ */
+int
+ccn_segment_parse (const unsigned char *ccnb,
+    const struct ccn_parsed_ContentObject *pco,
+    const struct ccn_indexbuf *comps, struct ccn_segment_info *si)
+{
+  const unsigned char *comp;
+  size_t comp_size;
+  const unsigned char *finalid;
+  size_t finalid_size;
+  size_t i;
+
+  if (NULL == ccnb || NULL == pco || NULL == comps || comps->n < 2)
+    return -1;
+
+  if (0 > ccnb_element_blob (ccnb, comps->buf[comps->n - 2],
+          comps->buf[comps->n - 1], &comp, &comp_size))
+    return -1;
+  if (comp_size < 1 || CCN_MARKER_SEQNUM != comp[0])
+    return -1;
+  si->segment = 0;
+  for (i = 1; i < comp_size; ++i)
+    si->segment = (si->segment << 8) + comp[i];   // skip first byte; marker
+
+  if (0 > ccnb_element_blob (ccnb, pco->offset[CCN_PCO_B_Content],
+          pco->offset[CCN_PCO_E_Content], &si->data, &si->size))
+    return -1;
+
+  si->last = 0;
+  if (pco->offset[CCN_PCO_B_FinalBlockID] != pco->offset[CCN_PCO_E_FinalBlockID]
+      && 0 == ccnb_element_blob (ccnb, pco->offset[CCN_PCO_B_FinalBlockID],
+          pco->offset[CCN_PCO_E_FinalBlockID], &finalid, &finalid_size)
+      && finalid_size == comp_size && 0 == memcmp (finalid, comp, comp_size))
+    si->last = 1;
+  return 0;
+}
+
 uintmax_t
 ccn_charbuf_fetch_segment (const struct ccn_charbuf * name)
 {
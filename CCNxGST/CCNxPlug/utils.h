@@ -31,10 +31,13 @@
 #include <ccn/keystore.h>
 #include <ccn/signing.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 #define CCND_HOST_ENV_VAR		"CCND_HOST"         /**< Environment variable storing the location of the ccnd router machine */
 #define CCN_KEYSTORE_ENV_VAR	"CCN_KEYSTORE"      /**< Environment variable storing the location of the user's key store file */
 #define CCN_PASSPHRASE_ENV_VAR	"CCN_PASSPHRASE"    /**< Environment variable storing the passphrase for the user's key store file */
+#define CCN_RECONNECT_MIN		20					/**< Msecs we wait before the first attempt to reach ccnd again after losing it */
+#define CCN_RECONNECT_MAX		1000				/**< Most msecs we wait between attempts to reach ccnd */
 
 /*
  * Gets the host where we can find the ccnd router process.
@@ -65,6 +68,12 @@ struct ccn_charbuf* interestAsUri( const struct ccn_upcall_info * info );
  */
 void msleep( int msecs );
 
+/*
+ * Msecs to wait before the next attempt to reach ccnd, after the given number have failed.
+ * Doubles with each failure, with some jitter, between CCN_RECONNECT_MIN and CCN_RECONNECT_MAX.
+ */
+int reconnect_backoff( int attempt );
+
 /*
  * Dump routines.
  */
@@ -106,6 +115,126 @@ void hDump( const DumpAddr_t ptr, const DumpSize_t size );
  */
 void compDump(struct ccn_charbuf *cbuf, int todo);
 
+/**
+ * \brief Encodes the names of a stream's segments, reusing one buffer
+ *
+ * The prefix is encoded once; only the trailing sequence number component
+ * is rewritten for each segment.
+ */
+struct ccn_seqname {
+	struct ccn_charbuf	*name;			/**< encoded prefix, followed by the last sequence number encoded */
+	size_t				prefix_len;		/**< length of the encoded prefix, including its closer */
+};
+
+/*
+ * Create, use and destroy a sequence name encoder for the given prefix.
+ * The name returned by seqname_encode() belongs to the encoder, and changes with the next call.
+ */
+struct ccn_seqname* seqname_create( const struct ccn_charbuf *prefix );
+struct ccn_charbuf* seqname_encode( struct ccn_seqname *sn, uintmax_t seq );
+void seqname_destroy( struct ccn_seqname **snp );
+
+/**
+ * \brief Keeps charbufs around for reuse, so busy code paths need not allocate them
+ */
+struct ccn_charbuf_pool {
+	struct ccn_charbuf	**free;			/**< stack of charbufs ready for reuse */
+	int					n_free;			/**< number of charbufs on the stack */
+	int					max_free;		/**< most charbufs we keep on the stack */
+	size_t				reserve;		/**< bytes reserved in each charbuf we create */
+	unsigned long		allocations;	/**< count of charbufs we had to create */
+};
+
+/*
+ * Create and destroy a charbuf pool, and get charbufs from it and put them back.
+ * A charbuf from the pool comes back empty, but keeps the memory it had before.
+ */
+struct ccn_charbuf_pool* charbuf_pool_create( int max_free, size_t reserve );
+struct ccn_charbuf* charbuf_pool_get( struct ccn_charbuf_pool *pool );
+void charbuf_pool_put( struct ccn_charbuf_pool *pool, struct ccn_charbuf **cbp );
+void charbuf_pool_destroy( struct ccn_charbuf_pool **poolp );
+
+/**
+ * \brief What the source needs out of a segment of content, all found in one pass
+ */
+struct ccn_segment_info {
+	uintmax_t			segment;	/**< segment number, from the last name component */
+	const unsigned char	*data;		/**< start of the payload, inside the content object */
+	size_t				size;		/**< size of the payload */
+	int					last;		/**< true when the FinalBlockID names this segment */
+};
+
+/*
+ * Pull the segment number, payload and last block flag out of a content object
+ * that has already been parsed, using only the parser's offsets.
+ * Returns 0, or -1 if the object is not shaped like a segment.
+ */
+int ccn_segment_parse( const unsigned char *ccnb, const struct ccn_parsed_ContentObject *pco,
+		const struct ccn_indexbuf *comps, struct ccn_segment_info *si );
+
+/**
+ * Number of recent keyframes a sink keeps, and answers _meta_/.gop requests with
+ */
+#define CCN_GOP_HISTORY		16
+
+/**
+ * Size of each keyframe record in a _meta_/.gop reply
+ */
+#define CCN_GOP_RECORD		20
+
+/**
+ * \brief Where a keyframe starts in the segments of a stream
+ *
+ * Renditions of a stream encoded with aligned keyframes give the same keyframe the same
+ * timestamp, so a receiver can switch from one to another at it.
+ */
+struct ccn_gop {
+	uint64_t			pts;		/**< timestamp of the keyframe, in nanoseconds */
+	uint64_t			segment;	/**< segment its first byte is published in */
+	uint32_t			offset;		/**< where in that segment it starts */
+};
+
+/*
+ * Append one keyframe record to a _meta_/.gop reply, or parse up to max of them back
+ * out of one. Records are the three fields, most significant byte first.
+ * Parsing returns the number of records found.
+ */
+void gop_meta_append( struct ccn_charbuf *out, const struct ccn_gop *gop );
+int gop_meta_parse( const unsigned char *data, size_t size, struct ccn_gop *gops, int max );
+
+/**
+ * Name component the parity segments of a stream are published under, next to its segments
+ */
+#define CCN_FEC_COMPONENT	"_fec_"
+
+/**
+ * Most segments one parity segment covers
+ */
+#define CCN_FEC_MAX_GROUP	32
+
+/**
+ * Size of the header in front of the XORed payloads in a parity segment
+ */
+#define CCN_FEC_HEADER		4
+
+/**
+ * Size of the group size a parity segment starts with, ahead of its block; a receiver
+ * expecting another group size cannot rebuild anything from it
+ */
+#define CCN_FEC_GROUP_BYTES	1
+
+/*
+ * Build up a parity block, the XOR of the segments of a group; it starts out empty.
+ * fec_fold() XORs bytes in at offset, growing the block with zeros as needed: a segment's
+ * payload goes at CCN_FEC_HEADER, a received parity block at 0. fec_fold_size() XORs a
+ * payload size into the header, most significant byte first.
+ * Once every segment of the group but one, and the parity, are folded in, fec_recovered()
+ * finds the missing payload in the block. It returns 0, or -1 if the block makes no sense.
+ */
+void fec_fold( struct ccn_charbuf *block, size_t offset, const unsigned char *data, size_t size );
+void fec_fold_size( struct ccn_charbuf *block, size_t size );
+int fec_recovered( const struct ccn_charbuf *block, const unsigned char **data, size_t *size );
+
 uintmax_t ccn_charbuf_fetch_segment(const struct ccn_charbuf *name);
 uintmax_t ccn_ccnb_fetch_segment( const unsigned char* buf, const struct ccn_indexbuf* idx);
 
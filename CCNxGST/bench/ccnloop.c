@@ -0,0 +1,1394 @@
+/** \file ccnloop.c
+ * \brief An in-process stand-in for ccnd and the network half of libccn
+ *
+ * The plug-in normally talks to a ccnd through ccn_connect(), ccn_run(), ccn_express_interest(),
+ * ccn_put(), ccn_set_interest_filter() and ccn_get(). This file gives those calls, and the
+ * rest of the client API the plug-in uses, a loopback implementation: interests are handed
+ * to the filters registered in the same process, content is handed to the pending interests
+ * it satisfies, and whatever is put is kept in a small content store. Nothing leaves the process,
+ * so a ccnxsink ! ... ! ccnxsrc pipeline can be measured on one machine without a ccnd
+ * and without the noise of a network.
+ *
+ * It is linked ahead of libccn in the bench build of the plug-in, see Makefile.am;
+ * the encoding, parsing and keystore parts of libccn are still the real ones.
+ *
+ * What a real ccnd does that this does not:
+ *  - Interests are not aggregated; every expressed interest goes to the matching filters.
+ *  - Segment interests are only answered from the store by an exact name match, see cs_lookup().
+ *  - Content is not verified; it arrives as CCN_UPCALL_CONTENT, or as
+ *    CCN_UPCALL_CONTENT_UNVERIFIED on a handle given ccn_defer_verification(). Asking for
+ *    that to be verified gets it delivered again as CCN_UPCALL_CONTENT, unchecked.
+ *  - ccn_sign_content() leaves out the key locator, and signs with zeros if no key was loaded.
+ *  - The connection fds are only numbers, there is no socket behind them to poll(); a
+ *    ccnxsrc with more than one connection cannot wait on them properly.
+ *
+ * The content store holds CCNLOOP_CS_SIZE content objects, 4096 unless set in the environment.
+ *
+ * The path content takes to the interests waiting on it can be impaired, to see how the
+ * source copes. CCNLOOP_IMPAIR holds a comma separated list of:
+ *  - loss=P		the fraction of content objects lost on the way
+ *  - delay=MS		msecs added to the delivery of each content object
+ *  - jitter=MS		up to this many msecs more, picked at random
+ *  - reorder=P		the fraction of content objects held back, so later ones overtake them
+ *  - hold=MS		how long those are held back, 10 msecs unless given
+ *  - rate=MBIT		the speed of the link content is delivered over, in Mbit/s
+ *
+ * e.g. CCNLOOP_IMPAIR=loss=0.02,delay=20,jitter=5. Content that would arrive after its
+ * interest has timed out is lost as well. The random choices start from CCNLOOP_SEED, 1 unless
+ * given, so a run can be repeated. Both are read whenever a handle is created.
+ */
+/*
+ * GStreamer-CCNx, loopback ccnd for benchmarks
+ * Copyright (C) 2009, 2010 Alcatel-Lucent Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ccn/ccn.h>
+#include <ccn/charbuf.h>
+#include <ccn/indexbuf.h>
+#include <ccn/keystore.h>
+#include <ccn/coding.h>
+
+/**
+ * Environment variable holding the number of content objects the store keeps
+ */
+#define LOOP_CS_SIZE_ENV "CCNLOOP_CS_SIZE"
+
+/**
+ * Number of content objects the store keeps when the environment does not say
+ */
+#define LOOP_CS_SIZE 4096
+
+/**
+ * Environment variable describing the impairment of the content path
+ */
+#define LOOP_IMPAIR_ENV "CCNLOOP_IMPAIR"
+
+/**
+ * Environment variable holding the seed for the impairment's random choices
+ */
+#define LOOP_SEED_ENV "CCNLOOP_SEED"
+
+/**
+ * Msecs reordered content is held back when the impairment does not say
+ */
+#define LOOP_REORDER_HOLD 10
+
+/**
+ * Lifetime of an interest that does not carry one, msecs; the same as ccnd's
+ */
+#define LOOP_INTEREST_LIFETIME 4000
+
+/**
+ * First of the pretend file descriptors handed out by ccn_connect()
+ */
+#define LOOP_FIRST_FD 1000
+
+/**
+ * Size of the zero signature put on content when no key has been loaded
+ */
+#define LOOP_SIGNATURE_SIZE 128
+
+/**
+ * A content object, in the store or on its way to an upcall
+ */
+struct loop_content {
+  struct loop_content *hnext;   /**< next in the same hash bucket */
+  struct ccn_charbuf *ccnb;     /**< the encoded content object */
+  struct ccn_parsed_ContentObject pco;  /**< offsets into ccnb */
+  struct ccn_indexbuf *comps;   /**< name component offsets into ccnb */
+  uint32_t hash;                /**< hash of the encoded name components */
+  uint64_t stale;               /**< usecs after which the store no longer answers with it, 0 for never */
+};
+
+/**
+ * An interest, pending or on its way to an upcall
+ */
+struct loop_interest {
+  struct loop_interest *next;   /**< next pending interest */
+  struct ccn *owner;            /**< handle the interest was expressed on */
+  struct ccn_closure *action;   /**< who is called back; NULL for ccn_get() */
+  struct ccn_charbuf *ccnb;     /**< the encoded interest */
+  struct ccn_parsed_interest pi;        /**< offsets into ccnb */
+  struct ccn_indexbuf *comps;   /**< name component offsets into ccnb */
+  uint64_t lifetime;            /**< usecs the interest stays pending */
+  uint64_t expiry;              /**< usecs at which it times out */
+  struct loop_content *answer;  /**< content found for a ccn_get() */
+};
+
+/**
+ * A prefix registered with ccn_set_interest_filter()
+ */
+struct loop_filter {
+  struct loop_filter *next;     /**< next filter */
+  struct ccn *owner;            /**< handle the filter was set on */
+  struct ccn_closure *action;   /**< who is called with the interests */
+  struct ccn_charbuf *name;     /**< the prefix */
+  struct ccn_indexbuf *comps;   /**< component offsets into name */
+};
+
+/**
+ * An upcall waiting for ccn_run() on the handle it belongs to
+ */
+struct loop_event {
+  struct loop_event *next;      /**< next upcall for the same handle */
+  enum ccn_upcall_kind kind;    /**< what sort of upcall */
+  struct ccn_closure *action;   /**< who is called */
+  struct loop_interest *interest;       /**< the interest, NULL for CCN_UPCALL_FINAL */
+  struct loop_content *content; /**< the content, for CCN_UPCALL_CONTENT */
+  int matched_comps;            /**< number of components the filter matched, for CCN_UPCALL_INTEREST */
+  uint64_t due;                 /**< usecs before which the upcall is not made */
+};
+
+/**
+ * How the content path is impaired, see CCNLOOP_IMPAIR
+ */
+struct loop_impair {
+  double loss;                  /**< fraction of content lost */
+  uint64_t delay;               /**< usecs added to every delivery */
+  uint64_t jitter;              /**< up to this many usecs more */
+  double reorder;               /**< fraction of content held back */
+  uint64_t hold;                /**< usecs it is held back */
+  double rate;                  /**< link speed in bits per usec, 0 for no limit */
+  uint64_t link_free;           /**< usecs at which the link has sent all it has been given */
+  uint64_t rng;                 /**< state of the random number generator */
+};
+
+/**
+ * Our idea of a ccn handle; the plug-in never looks inside
+ */
+struct ccn {
+  int fd;                       /**< pretend connection, -1 when not connected */
+  pthread_cond_t wake;          /**< signalled when an upcall is queued */
+  struct loop_event *head;      /**< upcalls waiting for ccn_run() */
+  struct loop_event *tail;      /**< last of them */
+  struct ccn_keystore *keystore;        /**< key loaded by ccn_load_private_key(), NULL if none */
+  unsigned char pubid[32];      /**< digest of the key's public part */
+  int defer;                    /**< set by ccn_defer_verification() */
+};
+
+/**
+ * Everything shared by the handles in the process, all of it under lock
+ */
+static struct {
+  pthread_mutex_t lock;         /**< held while any of this is looked at */
+  pthread_condattr_t attr;      /**< makes the condition variables use CLOCK_MONOTONIC */
+  pthread_cond_t answered;      /**< broadcast when a ccn_get() gets its content */
+  struct loop_content **cs;     /**< the store, used as a ring */
+  size_t cs_size;               /**< number of entries in the ring */
+  size_t cs_next;               /**< entry to be replaced next */
+  struct loop_content **buckets;        /**< the store again, by name hash */
+  struct loop_interest *pit;    /**< pending interests */
+  struct loop_filter *filters;  /**< registered prefixes */
+  int next_fd;                  /**< next pretend file descriptor */
+  uint64_t last_version;        /**< last version made by ccn_create_version() */
+  struct loop_impair impair;    /**< what happens to content on its way */
+} loop = {
+  PTHREAD_MUTEX_INITIALIZER
+};
+
+/**
+ * Makes sure the shared state exists
+ */
+static pthread_once_t loop_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Microseconds since some fixed point
+ */
+static uint64_t
+now_us (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * Wait on a condition variable until it is signalled or a point in time has passed
+ *
+ * \param cond		what to wait on, created with loop.attr
+ * \param until		usecs, as given by now_us(), after which we stop waiting
+ */
+static void
+wait_until (pthread_cond_t * cond, uint64_t until)
+{
+  struct timespec ts;
+
+  ts.tv_sec = until / 1000000;
+  ts.tv_nsec = (until % 1000000) * 1000;
+  pthread_cond_timedwait (cond, &loop.lock, &ts);
+}
+
+/**
+ * Set up the content store and the condition variable attributes, once
+ */
+static void
+loop_init (void)
+{
+  const char *env;
+  long n = 0;
+
+  pthread_condattr_init (&loop.attr);
+  pthread_condattr_setclock (&loop.attr, CLOCK_MONOTONIC);
+  pthread_cond_init (&loop.answered, &loop.attr);
+  if ((env = getenv (LOOP_CS_SIZE_ENV)) != NULL)
+    n = atol (env);
+  loop.cs_size = (n > 0) ? n : LOOP_CS_SIZE;
+  loop.cs = calloc (loop.cs_size, sizeof (struct loop_content *));
+  loop.buckets = calloc (loop.cs_size, sizeof (struct loop_content *));
+  loop.next_fd = LOOP_FIRST_FD;
+}
+
+/**
+ * FNV-1a hash of some bytes
+ */
+static uint32_t
+hash_bytes (const unsigned char *p, size_t n)
+{
+  uint32_t h = 2166136261u;
+
+  while (n-- > 0)
+    h = (h ^ *p++) * 16777619u;
+  return h;
+}
+
+/**
+ * Copy a component index
+ */
+static struct ccn_indexbuf *
+indexbuf_copy (const struct ccn_indexbuf *ib)
+{
+  struct ccn_indexbuf *ans = ccn_indexbuf_create ();
+
+  if (NULL != ans && ib->n > 0)
+    ccn_indexbuf_append (ans, ib->buf, ib->n);
+  return ans;
+}
+
+/**
+ * Compare the first components of two names
+ *
+ * \param a		encoding holding the first name
+ * \param ac		component offsets into a
+ * \param b		encoding holding the second name
+ * \param bc		component offsets into b
+ * \param n		number of components to compare
+ * \return true if both names have at least n components and the first n are the same
+ */
+static int
+same_components (const unsigned char *a, const struct ccn_indexbuf *ac,
+    const unsigned char *b, const struct ccn_indexbuf *bc, size_t n)
+{
+  size_t len;
+
+  if (ac->n < n + 1 || bc->n < n + 1)
+    return 0;
+  len = ac->buf[n] - ac->buf[0];
+  if (len != bc->buf[n] - bc->buf[0])
+    return 0;
+  return 0 == memcmp (a + ac->buf[0], b + bc->buf[0], len);
+}
+
+/**
+ * Create a content object from its encoding
+ *
+ * \param p		the encoded content object
+ * \param size		its length
+ * \return the parsed content object, NULL if it would not parse
+ */
+static struct loop_content *
+content_create (const unsigned char *p, size_t size)
+{
+  struct loop_content *c;
+  uintmax_t fresh;
+
+  c = calloc (1, sizeof (struct loop_content));
+  if (NULL == c)
+    return NULL;
+  c->ccnb = ccn_charbuf_create ();
+  c->comps = ccn_indexbuf_create ();
+  if (NULL == c->ccnb || NULL == c->comps
+      || ccn_charbuf_append (c->ccnb, p, size) < 0
+      || ccn_parse_ContentObject (c->ccnb->buf, size, &c->pco, c->comps) < 0) {
+    ccn_indexbuf_destroy (&c->comps);
+    ccn_charbuf_destroy (&c->ccnb);
+    free (c);
+    return NULL;
+  }
+  c->hash = hash_bytes (c->ccnb->buf + c->comps->buf[0],
+      c->comps->buf[c->comps->n - 1] - c->comps->buf[0]);
+  if (c->pco.offset[CCN_PCO_B_FreshnessSeconds] <
+      c->pco.offset[CCN_PCO_E_FreshnessSeconds]) {
+    fresh = ccn_fetch_tagged_nonNegativeInteger (CCN_DTAG_FreshnessSeconds,
+        c->ccnb->buf, c->pco.offset[CCN_PCO_B_FreshnessSeconds],
+        c->pco.offset[CCN_PCO_E_FreshnessSeconds]);
+    c->stale = now_us () + fresh * 1000000;
+  }
+  return c;
+}
+
+/**
+ * Copy a content object, so an upcall can have one the store will not throw away
+ */
+static struct loop_content *
+content_copy (const struct loop_content *c)
+{
+  struct loop_content *ans;
+
+  ans = calloc (1, sizeof (struct loop_content));
+  if (NULL == ans)
+    return NULL;
+  memcpy (ans, c, sizeof (struct loop_content));
+  ans->hnext = NULL;
+  ans->ccnb = ccn_charbuf_create ();
+  ccn_charbuf_append_charbuf (ans->ccnb, c->ccnb);
+  ans->comps = indexbuf_copy (c->comps);
+  return ans;
+}
+
+/**
+ * Release a content object
+ */
+static void
+content_destroy (struct loop_content **cp)
+{
+  struct loop_content *c = *cp;
+
+  if (NULL == c)
+    return;
+  ccn_charbuf_destroy (&c->ccnb);
+  ccn_indexbuf_destroy (&c->comps);
+  free (c);
+  *cp = NULL;
+}
+
+/**
+ * Put together an interest the way ccn_express_interest() does
+ *
+ * \param namebuf		the name asked for
+ * \param templ		interest whose fields after the name are copied, may be NULL
+ * \return the parsed interest, NULL if the template or the result would not parse
+ */
+static struct loop_interest *
+interest_create (struct ccn_charbuf *namebuf, struct ccn_charbuf *templ)
+{
+  struct loop_interest *i;
+  struct ccn_parsed_interest tpi = { 0 };
+  intmax_t lifetime;
+
+  i = calloc (1, sizeof (struct loop_interest));
+  if (NULL == i)
+    return NULL;
+  i->ccnb = ccn_charbuf_create ();
+  i->comps = ccn_indexbuf_create ();
+  if (NULL == i->ccnb || NULL == i->comps)
+    goto Bail;
+  ccn_charbuf_append_tt (i->ccnb, CCN_DTAG_Interest, CCN_DTAG);
+  ccn_charbuf_append_charbuf (i->ccnb, namebuf);
+  if (NULL != templ) {
+    if (ccn_parse_interest (templ->buf, templ->length, &tpi, NULL) < 0)
+      goto Bail;
+    ccn_charbuf_append (i->ccnb, templ->buf + tpi.offset[CCN_PI_E_Name],
+        tpi.offset[CCN_PI_E] - tpi.offset[CCN_PI_E_Name]);
+  }
+  ccn_charbuf_append_closer (i->ccnb);
+  if (ccn_parse_interest (i->ccnb->buf, i->ccnb->length, &i->pi, i->comps) < 0)
+    goto Bail;
+  /* lifetimes are in 1/4096 of a second */
+  i->lifetime = LOOP_INTEREST_LIFETIME * 1000;
+  if (i->pi.offset[CCN_PI_B_InterestLifetime] <
+      i->pi.offset[CCN_PI_E_InterestLifetime]) {
+    lifetime = ccn_interest_lifetime (i->ccnb->buf, &i->pi);
+    if (lifetime > 0)
+      i->lifetime = lifetime * 1000000 / 4096;
+  }
+  return i;
+
+Bail:
+  ccn_indexbuf_destroy (&i->comps);
+  ccn_charbuf_destroy (&i->ccnb);
+  free (i);
+  return NULL;
+}
+
+/**
+ * Copy an interest, so each filter's upcall gets its own
+ */
+static struct loop_interest *
+interest_copy (const struct loop_interest *i)
+{
+  struct loop_interest *ans;
+
+  ans = calloc (1, sizeof (struct loop_interest));
+  if (NULL == ans)
+    return NULL;
+  memcpy (ans, i, sizeof (struct loop_interest));
+  ans->next = NULL;
+  ans->answer = NULL;
+  ans->ccnb = ccn_charbuf_create ();
+  ccn_charbuf_append_charbuf (ans->ccnb, i->ccnb);
+  ans->comps = indexbuf_copy (i->comps);
+  return ans;
+}
+
+/**
+ * Release an interest
+ */
+static void
+interest_destroy (struct loop_interest **ip)
+{
+  struct loop_interest *i = *ip;
+
+  if (NULL == i)
+    return;
+  content_destroy (&i->answer);
+  ccn_charbuf_destroy (&i->ccnb);
+  ccn_indexbuf_destroy (&i->comps);
+  free (i);
+  *ip = NULL;
+}
+
+/**
+ * See if some content answers an interest
+ *
+ * The cheap prefix comparison weeds out most of the pending interests before libccn
+ * looks at the selectors.
+ */
+static int
+content_matches (const struct loop_interest *i, struct loop_content *c)
+{
+  if (!same_components (i->ccnb->buf, i->comps, c->ccnb->buf, c->comps,
+          i->pi.prefix_comps))
+    return 0;
+  return ccn_content_matches_interest (c->ccnb->buf, c->ccnb->length, 1,
+      &c->pco, i->ccnb->buf, i->ccnb->length, &i->pi);
+}
+
+/**
+ * Order two candidate answers by the component following the interest's prefix
+ *
+ * Components are ordered the way ccnd orders them: shorter ones first, then byte by byte.
+ * Because the length of a blob is encoded in front of it, comparing the encoded
+ * components gives the same order. A name with no such component comes first.
+ */
+static int
+child_compare (const struct loop_interest *i, const struct loop_content *a,
+    const struct loop_content *b)
+{
+  size_t k = i->pi.prefix_comps;
+  size_t alen, blen;
+
+  alen = (a->comps->n > k + 1) ? a->comps->buf[k + 1] - a->comps->buf[k] : 0;
+  blen = (b->comps->n > k + 1) ? b->comps->buf[k + 1] - b->comps->buf[k] : 0;
+  if (alen != blen || 0 == alen)
+    return (alen < blen) ? -1 : (alen > blen);
+  return memcmp (a->ccnb->buf + a->comps->buf[k],
+      b->ccnb->buf + b->comps->buf[k], alen);
+}
+
+/**
+ * Find content in the store that answers an interest
+ *
+ * An interest whose name is the whole name of some content is found through the hash.
+ * Otherwise the whole store is searched, honouring the child selector; this is skipped
+ * for interests ending in a segment number since the plug-in publishes nothing below a
+ * segment, and the source asks for segments ahead of the sink producing them.
+ *
+ * \param i		the interest
+ * \param now		usecs, for telling stale content
+ * \return the content, still owned by the store; NULL if nothing answers
+ */
+static struct loop_content *
+cs_lookup (const struct loop_interest *i, uint64_t now)
+{
+  struct loop_content *c;
+  struct loop_content *best = NULL;
+  const unsigned char *last;
+  size_t sz;
+  size_t start, stop;
+  uint32_t h;
+  size_t k;
+
+  start = i->comps->buf[0];
+  stop = i->comps->buf[i->pi.prefix_comps];
+  h = hash_bytes (i->ccnb->buf + start, stop - start);
+  for (c = loop.buckets[h % loop.cs_size]; NULL != c; c = c->hnext) {
+    if (c->hash == h && (0 == c->stale || c->stale > now)
+        && c->comps->n == i->comps->n && content_matches (i, c))
+      return c;
+  }
+
+  if (i->pi.prefix_comps > 0
+      && 0 == ccn_name_comp_get (i->ccnb->buf, i->comps,
+          i->pi.prefix_comps - 1, &last, &sz)
+      && sz > 0 && CCN_MARKER_SEQNUM == last[0])
+    return NULL;
+  for (k = 0; k < loop.cs_size; ++k) {
+    c = loop.cs[k];
+    if (NULL == c || (0 != c->stale && c->stale <= now)
+        || !content_matches (i, c))
+      continue;
+    if (NULL == best)
+      best = c;
+    else if (i->pi.orderpref & 1) {
+      if (child_compare (i, c, best) > 0)
+        best = c;
+    } else if (child_compare (i, c, best) < 0)
+      best = c;
+  }
+  return best;
+}
+
+/**
+ * Add content to the store, throwing out the oldest if it is full
+ */
+static void
+cs_insert (struct loop_content *c)
+{
+  struct loop_content *old = loop.cs[loop.cs_next];
+  struct loop_content **pp;
+
+  if (NULL != old) {
+    for (pp = &loop.buckets[old->hash % loop.cs_size]; *pp != old;
+        pp = &(*pp)->hnext);
+    *pp = old->hnext;
+    content_destroy (&old);
+  }
+  loop.cs[loop.cs_next] = c;
+  loop.cs_next = (loop.cs_next + 1) % loop.cs_size;
+  c->hnext = loop.buckets[c->hash % loop.cs_size];
+  loop.buckets[c->hash % loop.cs_size] = c;
+}
+
+/**
+ * Take an interest off the pending list
+ *
+ * \return true if it was there
+ */
+static int
+pit_remove (struct loop_interest *i)
+{
+  struct loop_interest **pp;
+
+  for (pp = &loop.pit; NULL != *pp; pp = &(*pp)->next) {
+    if (*pp == i) {
+      *pp = i->next;
+      i->next = NULL;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Queue an upcall for a ccn_run() on a handle
+ *
+ * The queue is kept in the order the upcalls fall due, those due at the same time
+ * in the order they were queued.
+ *
+ * \param due		usecs before which the upcall is not made, 0 for straight away
+ */
+static void
+event_push (struct ccn *h, enum ccn_upcall_kind kind,
+    struct ccn_closure *action, struct loop_interest *i,
+    struct loop_content *c, int matched_comps, uint64_t due)
+{
+  struct loop_event *ev;
+  struct loop_event **pp;
+
+  ev = calloc (1, sizeof (struct loop_event));
+  if (NULL == ev) {
+    interest_destroy (&i);
+    content_destroy (&c);
+    return;
+  }
+  ev->kind = kind;
+  ev->action = action;
+  ev->interest = i;
+  ev->content = c;
+  ev->matched_comps = matched_comps;
+  ev->due = due;
+  if (NULL == h->tail || h->tail->due <= due) {
+    if (NULL == h->tail)
+      h->head = ev;
+    else
+      h->tail->next = ev;
+    h->tail = ev;
+  } else {
+    for (pp = &h->head; (*pp)->due <= due; pp = &(*pp)->next);
+    ev->next = *pp;
+    *pp = ev;
+  }
+  pthread_cond_broadcast (&h->wake);
+}
+
+/**
+ * Drop a reference to a closure, queueing its final upcall on the list given if it was the last
+ */
+static void
+closure_release (struct ccn_closure *action, struct loop_event **finals)
+{
+  struct loop_event *ev;
+
+  if (NULL == action || --action->refcount > 0)
+    return;
+  ev = calloc (1, sizeof (struct loop_event));
+  if (NULL == ev)
+    return;
+  ev->kind = CCN_UPCALL_FINAL;
+  ev->action = action;
+  ev->next = *finals;
+  *finals = ev;
+}
+
+/**
+ * Make the final upcalls gathered by closure_release(); called without the lock held
+ */
+static void
+run_finals (struct ccn *h, struct loop_event *finals)
+{
+  struct ccn_upcall_info info;
+  struct loop_event *ev;
+
+  while (NULL != (ev = finals)) {
+    finals = ev->next;
+    memset (&info, 0, sizeof (info));
+    info.h = h;
+    ev->action->p (ev->action, CCN_UPCALL_FINAL, &info);
+    free (ev);
+  }
+}
+
+/**
+ * Hand an interest to every filter whose prefix it falls under
+ */
+static void
+forward_interest (const struct loop_interest *i)
+{
+  struct loop_filter *f;
+  struct loop_interest *copy;
+  size_t n;
+
+  for (f = loop.filters; NULL != f; f = f->next) {
+    n = f->comps->n - 1;
+    if (NULL == f->owner || -1 == f->owner->fd || n > i->pi.prefix_comps
+        || !same_components (i->ccnb->buf, i->comps, f->name->buf, f->comps, n))
+      continue;
+    if ((copy = interest_copy (i)) == NULL)
+      continue;
+    f->action->refcount++;      /* held until the upcall is made */
+    event_push (f->owner, CCN_UPCALL_INTEREST, f->action, copy, NULL, n, 0);
+  }
+}
+
+/**
+ * A random number in [0, 1), from the impairment's own generator
+ */
+static double
+impair_random (void)
+{
+  uint64_t x = loop.impair.rng;
+
+  /* xorshift64 */
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  loop.impair.rng = x;
+  return (x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * Read the impairment from the environment, see CCNLOOP_IMPAIR
+ */
+static void
+impair_configure (void)
+{
+  struct loop_impair *imp = &loop.impair;
+  const char *env;
+  char *copy;
+  char *item;
+  char *save = NULL;
+  char key[16];
+  double v;
+
+  memset (imp, 0, sizeof (*imp));
+  imp->hold = LOOP_REORDER_HOLD * 1000;
+  env = getenv (LOOP_SEED_ENV);
+  imp->rng = (NULL != env && atoll (env) != 0) ? (uint64_t) atoll (env) : 1;
+  if ((env = getenv (LOOP_IMPAIR_ENV)) == NULL || (copy = strdup (env)) == NULL)
+    return;
+  for (item = strtok_r (copy, ",", &save); NULL != item;
+      item = strtok_r (NULL, ",", &save)) {
+    if (sscanf (item, " %15[^=]=%lf", key, &v) != 2 || v < 0)
+      continue;
+    if (0 == strcmp (key, "loss"))
+      imp->loss = v;
+    else if (0 == strcmp (key, "delay"))
+      imp->delay = v * 1000;
+    else if (0 == strcmp (key, "jitter"))
+      imp->jitter = v * 1000;
+    else if (0 == strcmp (key, "reorder"))
+      imp->reorder = v;
+    else if (0 == strcmp (key, "hold"))
+      imp->hold = v * 1000;
+    else if (0 == strcmp (key, "rate"))
+      imp->rate = v;            /* Mbit/s is bits per usec */
+  }
+  free (copy);
+}
+
+/**
+ * Send content to a pending interest, through the impairment
+ *
+ * \param i		the interest, with its expiry set; the upcall owns it if the content is sent
+ * \param c		the content, copied for the upcall
+ * \param now		usecs
+ * \return true if the content was sent, false if it was lost and the interest is still the caller's
+ */
+static int
+content_send (struct loop_interest *i, const struct loop_content *c,
+    uint64_t now)
+{
+  struct loop_impair *imp = &loop.impair;
+  uint64_t due = now;
+
+  if (imp->loss > 0 && impair_random () < imp->loss)
+    return 0;
+  if (imp->rate > 0) {
+    due = (imp->link_free > now) ? imp->link_free : now;
+    due += (uint64_t) (c->ccnb->length * 8 / imp->rate);
+    imp->link_free = due;
+  }
+  due += imp->delay;
+  if (imp->jitter > 0)
+    due += (uint64_t) (impair_random () * imp->jitter);
+  if (imp->reorder > 0 && impair_random () < imp->reorder)
+    due += imp->hold;
+  if (due >= i->expiry)
+    return 0;
+  event_push (i->owner, i->owner->defer ? CCN_UPCALL_CONTENT_UNVERIFIED :
+      CCN_UPCALL_CONTENT, i->action, i, content_copy (c), 0,
+      (due > now) ? due : 0);
+  return 1;
+}
+
+/**
+ * Answer an interest from the store, or leave it pending and tell the filters about it
+ *
+ * \param i		the interest; an upcall or the pending list owns it afterwards
+ * \param now		usecs
+ */
+static void
+express (struct loop_interest *i, uint64_t now)
+{
+  struct loop_content *c;
+
+  i->expiry = now + i->lifetime;
+  if ((c = cs_lookup (i, now)) != NULL && content_send (i, c, now))
+    return;
+  i->next = loop.pit;
+  loop.pit = i;
+  if (NULL == c)
+    forward_interest (i);
+}
+
+/**
+ * Queue the time-out upcalls for a handle's interests that have run out
+ *
+ * \param h		handle whose interests are looked at
+ * \param now		usecs
+ * \return usecs at which the next of the handle's interests times out, 0 if none is pending
+ */
+static uint64_t
+expire_interests (struct ccn *h, uint64_t now)
+{
+  struct loop_interest **pp;
+  struct loop_interest *i;
+  uint64_t next = 0;
+
+  for (pp = &loop.pit; NULL != (i = *pp);) {
+    if (i->owner != h || NULL == i->action) {
+      pp = &i->next;
+      continue;
+    }
+    if (i->expiry <= now) {
+      *pp = i->next;
+      i->next = NULL;
+      event_push (h, CCN_UPCALL_INTEREST_TIMED_OUT, i->action, i, NULL, 0, 0);
+      continue;
+    }
+    if (0 == next || i->expiry < next)
+      next = i->expiry;
+    pp = &i->next;
+  }
+  return next;
+}
+
+/**
+ * Make one queued upcall; called without the lock held
+ */
+static void
+deliver (struct ccn *h, struct loop_event *ev)
+{
+  struct ccn_upcall_info info;
+  struct loop_event *finals = NULL;
+  enum ccn_upcall_res res;
+  struct loop_interest *i = ev->interest;
+
+  memset (&info, 0, sizeof (info));
+  info.h = h;
+  info.interest_ccnb = i->ccnb->buf;
+  info.pi = &i->pi;
+  info.interest_comps = i->comps;
+  info.matched_comps = ev->matched_comps;
+  if (NULL != ev->content) {
+    info.content_ccnb = ev->content->ccnb->buf;
+    info.pco = &ev->content->pco;
+    info.content_comps = ev->content->comps;
+  }
+  res = ev->action->p (ev->action, ev->kind, &info);
+  if (CCN_UPCALL_CONTENT_UNVERIFIED == ev->kind
+      && CCN_UPCALL_RESULT_VERIFY == res)
+    res = ev->action->p (ev->action, CCN_UPCALL_CONTENT, &info);
+
+  pthread_mutex_lock (&loop.lock);
+  if (CCN_UPCALL_INTEREST != ev->kind && CCN_UPCALL_RESULT_REEXPRESS == res
+      && -1 != h->fd) {
+    express (i, now_us ());
+    i = NULL;
+  } else
+    closure_release (ev->action, &finals);
+  pthread_mutex_unlock (&loop.lock);
+
+  interest_destroy (&i);
+  content_destroy (&ev->content);
+  free (ev);
+  run_finals (h, finals);
+}
+
+struct ccn *
+ccn_create (void)
+{
+  struct ccn *h;
+
+  pthread_once (&loop_once, loop_init);
+  if (NULL == loop.cs || NULL == loop.buckets)
+    return NULL;
+  h = calloc (1, sizeof (struct ccn));
+  if (NULL == h)
+    return NULL;
+  h->fd = -1;
+  pthread_cond_init (&h->wake, &loop.attr);
+  pthread_mutex_lock (&loop.lock);
+  impair_configure ();
+  pthread_mutex_unlock (&loop.lock);
+  return h;
+}
+
+int
+ccn_connect (struct ccn *h, const char *name)
+{
+  if (NULL == h)
+    return -1;
+  pthread_mutex_lock (&loop.lock);
+  if (-1 == h->fd)
+    h->fd = loop.next_fd++;
+  pthread_mutex_unlock (&loop.lock);
+  return h->fd;
+}
+
+int
+ccn_defer_verification (struct ccn *h, int defer)
+{
+  int old = h->defer;
+
+  h->defer = defer;
+  return old;
+}
+
+int
+ccn_get_connection_fd (struct ccn *h)
+{
+  return h->fd;
+}
+
+int
+ccn_output_is_pending (struct ccn *h)
+{
+  return 0;                     /* everything is handed over as it is sent */
+}
+
+int
+ccn_disconnect (struct ccn *h)
+{
+  pthread_mutex_lock (&loop.lock);
+  h->fd = -1;
+  pthread_cond_broadcast (&h->wake);
+  pthread_mutex_unlock (&loop.lock);
+  return 0;
+}
+
+void
+ccn_destroy (struct ccn **hp)
+{
+  struct ccn *h = *hp;
+  struct loop_interest **ip, *i;
+  struct loop_filter **fp, *f;
+  struct loop_event *ev;
+  struct loop_event *finals = NULL;
+
+  if (NULL == h)
+    return;
+  ccn_disconnect (h);
+  pthread_mutex_lock (&loop.lock);
+  for (ip = &loop.pit; NULL != (i = *ip);) {
+    if (i->owner == h && NULL != i->action) {
+      *ip = i->next;
+      closure_release (i->action, &finals);
+      interest_destroy (&i);
+    } else
+      ip = &i->next;
+  }
+  for (fp = &loop.filters; NULL != (f = *fp);) {
+    if (f->owner == h) {
+      *fp = f->next;
+      closure_release (f->action, &finals);
+      ccn_charbuf_destroy (&f->name);
+      ccn_indexbuf_destroy (&f->comps);
+      free (f);
+    } else
+      fp = &f->next;
+  }
+  while (NULL != (ev = h->head)) {
+    h->head = ev->next;
+    closure_release (ev->action, &finals);
+    interest_destroy (&ev->interest);
+    content_destroy (&ev->content);
+    free (ev);
+  }
+  pthread_mutex_unlock (&loop.lock);
+  run_finals (h, finals);
+
+  if (NULL != h->keystore)
+    ccn_keystore_destroy (&h->keystore);
+  pthread_cond_destroy (&h->wake);
+  free (h);
+  *hp = NULL;
+}
+
+int
+ccn_run (struct ccn *h, int timeout)
+{
+  struct loop_event *ev;
+  uint64_t now;
+  uint64_t until;
+  uint64_t next;
+  int res = 0;
+
+  now = now_us ();
+  until = now + (uint64_t) timeout * 1000;
+  pthread_mutex_lock (&loop.lock);
+  for (;;) {
+    if (-1 == h->fd) {
+      res = -1;
+      break;
+    }
+    next = expire_interests (h, now);
+    if (NULL != (ev = h->head) && ev->due > now) {
+      if (0 == next || ev->due < next)
+        next = ev->due;
+      ev = NULL;
+    }
+    if (NULL != ev) {
+      if (NULL == (h->head = ev->next))
+        h->tail = NULL;
+      pthread_mutex_unlock (&loop.lock);
+      deliver (h, ev);
+      pthread_mutex_lock (&loop.lock);
+      if (timeout >= 0 && now_us () > until)
+        break;
+    } else if (timeout >= 0 && now >= until) {
+      break;
+    } else {
+      if (timeout >= 0 && (0 == next || until < next))
+        next = until;
+      if (0 == next)
+        pthread_cond_wait (&h->wake, &loop.lock);
+      else
+        wait_until (&h->wake, next);
+    }
+    now = now_us ();
+  }
+  pthread_mutex_unlock (&loop.lock);
+  return res;
+}
+
+int
+ccn_express_interest (struct ccn *h, struct ccn_charbuf *namebuf,
+    struct ccn_closure *action, struct ccn_charbuf *interest_template)
+{
+  struct loop_interest *i;
+
+  if (NULL == h || NULL == action || NULL == action->p)
+    return -1;
+  if ((i = interest_create (namebuf, interest_template)) == NULL)
+    return -1;
+  i->owner = h;
+  i->action = action;
+  pthread_mutex_lock (&loop.lock);
+  action->refcount++;
+  express (i, now_us ());
+  pthread_mutex_unlock (&loop.lock);
+  return 0;
+}
+
+int
+ccn_set_interest_filter (struct ccn *h, struct ccn_charbuf *namebuf,
+    struct ccn_closure *action)
+{
+  struct loop_filter **fp, *f;
+  struct loop_event *finals = NULL;
+
+  if (NULL == h)
+    return -1;
+  pthread_mutex_lock (&loop.lock);
+  for (fp = &loop.filters; NULL != (f = *fp); fp = &f->next) {
+    if (f->owner == h && f->name->length == namebuf->length
+        && 0 == memcmp (f->name->buf, namebuf->buf, namebuf->length)) {
+      *fp = f->next;
+      closure_release (f->action, &finals);
+      ccn_charbuf_destroy (&f->name);
+      ccn_indexbuf_destroy (&f->comps);
+      free (f);
+      break;
+    }
+  }
+  if (NULL != action && (f = calloc (1, sizeof (struct loop_filter))) != NULL) {
+    f->owner = h;
+    f->action = action;
+    f->name = ccn_charbuf_create ();
+    f->comps = ccn_indexbuf_create ();
+    ccn_charbuf_append_charbuf (f->name, namebuf);
+    if (ccn_name_split (f->name, f->comps) < 0) {
+      ccn_charbuf_destroy (&f->name);
+      ccn_indexbuf_destroy (&f->comps);
+      free (f);
+    } else {
+      action->refcount++;
+      f->next = loop.filters;
+      loop.filters = f;
+    }
+  }
+  pthread_mutex_unlock (&loop.lock);
+  run_finals (h, finals);
+  return 0;
+}
+
+int
+ccn_put (struct ccn *h, const void *p, size_t length)
+{
+  struct loop_content *c;
+  struct loop_interest **pp, *i;
+  uint64_t now;
+
+  if ((c = content_create (p, length)) == NULL)
+    return -1;
+  now = now_us ();
+  pthread_mutex_lock (&loop.lock);
+  for (pp = &loop.pit; NULL != (i = *pp);) {
+    if (!content_matches (i, c)) {
+      pp = &i->next;
+      continue;
+    }
+    *pp = i->next;
+    i->next = NULL;
+    if (NULL == i->action) {
+      i->answer = content_copy (c);
+      pthread_cond_broadcast (&loop.answered);
+    } else if (!content_send (i, c, now)) {
+      /* lost on the way, the interest stays pending */
+      i->next = *pp;
+      *pp = i;
+      pp = &i->next;
+    }
+  }
+  cs_insert (c);
+  pthread_mutex_unlock (&loop.lock);
+  return 0;
+}
+
+int
+ccn_get (struct ccn *h, struct ccn_charbuf *name,
+    struct ccn_charbuf *interest_template, int timeout_ms,
+    struct ccn_charbuf *resultbuf, struct ccn_parsed_ContentObject *pcobuf,
+    struct ccn_indexbuf *compsbuf, int flags)
+{
+  struct loop_interest *i;
+  struct loop_content *c;
+  uint64_t now;
+  uint64_t until;
+
+  if ((i = interest_create (name, interest_template)) == NULL)
+    return -1;
+  i->owner = h;
+  now = now_us ();
+  until = now + (uint64_t) timeout_ms * 1000;
+  pthread_mutex_lock (&loop.lock);
+  if ((c = cs_lookup (i, now)) != NULL)
+    c = content_copy (c);
+  else {
+    i->expiry = until;
+    i->next = loop.pit;
+    loop.pit = i;
+    forward_interest (i);
+    while (NULL == i->answer && now_us () < until)
+      wait_until (&loop.answered, until);
+    if (NULL == i->answer)
+      pit_remove (i);
+    c = i->answer;
+    i->answer = NULL;
+  }
+  pthread_mutex_unlock (&loop.lock);
+  interest_destroy (&i);
+
+  if (NULL == c)
+    return -1;
+  if (NULL != resultbuf) {
+    resultbuf->length = 0;
+    ccn_charbuf_append_charbuf (resultbuf, c->ccnb);
+  }
+  if (NULL != pcobuf)
+    memcpy (pcobuf, &c->pco, sizeof (c->pco));
+  if (NULL != compsbuf) {
+    compsbuf->n = 0;
+    ccn_indexbuf_append (compsbuf, c->comps->buf, c->comps->n);
+  }
+  content_destroy (&c);
+  return 0;
+}
+
+/**
+ * Find the latest version of a name by asking for its rightmost child
+ *
+ * Only CCN_V_HIGHEST is supported, which is all the plug-in asks for.
+ * A version already on the end of the name is replaced.
+ *
+ * \return 0 if the name was extended with a version, -1 if none was found
+ */
+int
+ccn_resolve_version (struct ccn *h, struct ccn_charbuf *name,
+    int versioning_flags, int timeout_ms)
+{
+  struct ccn_charbuf *templ;
+  struct ccn_charbuf *co;
+  struct ccn_indexbuf *comps;
+  const unsigned char *cp;
+  size_t sz;
+  int n;
+  int res = -1;
+
+  comps = ccn_indexbuf_create ();
+  n = ccn_name_split (name, comps);
+  if (n > 0 && 0 == ccn_name_comp_get (name->buf, comps, n - 1, &cp, &sz)
+      && sz > 0 && CCN_MARKER_VERSION == cp[0])
+    n = ccn_name_chop (name, comps, -1);
+  if (n < 0) {
+    ccn_indexbuf_destroy (&comps);
+    return -1;
+  }
+
+  templ = ccn_charbuf_create ();
+  ccn_charbuf_append_tt (templ, CCN_DTAG_Interest, CCN_DTAG);
+  ccn_charbuf_append_tt (templ, CCN_DTAG_Name, CCN_DTAG);
+  ccn_charbuf_append_closer (templ);    /* </Name> */
+  ccnb_tagged_putf (templ, CCN_DTAG_ChildSelector, "1");      /* rightmost */
+  ccn_charbuf_append_closer (templ);    /* </Interest> */
+  co = ccn_charbuf_create ();
+
+  if (0 == ccn_get (h, name, templ, timeout_ms, co, NULL, comps, 0)
+      && 0 == ccn_name_comp_get (co->buf, comps, n, &cp, &sz)
+      && sz > 0 && CCN_MARKER_VERSION == cp[0]) {
+    ccn_name_append (name, cp, sz);
+    res = 0;
+  }
+  ccn_charbuf_destroy (&co);
+  ccn_charbuf_destroy (&templ);
+  ccn_indexbuf_destroy (&comps);
+  return res;
+}
+
+/**
+ * Append a version component made from the time
+ *
+ * The version is the time in 1/4096 of a second, big-endian in six bytes after the marker.
+ * With CCN_V_HIGH each version is made later than the one before it.
+ *
+ * \return 0 on success, -1 if the name would not parse
+ */
+int
+ccn_create_version (struct ccn *h, struct ccn_charbuf *name,
+    int versioning_flags, intmax_t secs, int nsecs)
+{
+  struct ccn_indexbuf *comps;
+  struct timespec ts;
+  unsigned char v[7];
+  const unsigned char *cp;
+  size_t sz;
+  uint64_t t;
+  int n;
+  int k;
+
+  if (versioning_flags & CCN_V_NOW) {
+    clock_gettime (CLOCK_REALTIME, &ts);
+    secs = ts.tv_sec;
+    nsecs = ts.tv_nsec;
+  }
+  t = ((uint64_t) secs << 12) + ((uint64_t) nsecs << 12) / 1000000000;
+  pthread_mutex_lock (&loop.lock);
+  if ((versioning_flags & CCN_V_HIGH) && t <= loop.last_version)
+    t = loop.last_version + 1;
+  loop.last_version = t;
+  pthread_mutex_unlock (&loop.lock);
+
+  comps = ccn_indexbuf_create ();
+  n = ccn_name_split (name, comps);
+  if (n > 0 && (versioning_flags & CCN_V_REPLACE)
+      && 0 == ccn_name_comp_get (name->buf, comps, n - 1, &cp, &sz)
+      && sz > 0 && CCN_MARKER_VERSION == cp[0])
+    n = ccn_name_chop (name, comps, -1);
+  ccn_indexbuf_destroy (&comps);
+  if (n < 0)
+    return -1;
+  v[0] = CCN_MARKER_VERSION;
+  for (k = 6; k > 0; --k, t >>= 8)
+    v[k] = t & 0xff;
+  return ccn_name_append (name, v, sizeof (v));
+}
+
+/**
+ * Load the key content is signed with
+ *
+ * \param h		handle the key is kept with
+ * \param keystore_path		keystore file
+ * \param keystore_passphrase		its passphrase
+ * \param pubid_out		where the digest of the public key is put, may be NULL
+ * \return 0 on success, -1 if the keystore could not be read
+ */
+int
+ccn_load_private_key (struct ccn *h, const char *keystore_path,
+    const char *keystore_passphrase, struct ccn_charbuf *pubid_out)
+{
+  struct ccn_keystore *ks;
+
+  ks = ccn_keystore_create ();
+  if (NULL == ks)
+    return -1;
+  if (ccn_keystore_init (ks, (char *) keystore_path,
+          (char *) keystore_passphrase) != 0
+      || ccn_keystore_public_key_digest_length (ks) != sizeof (h->pubid)) {
+    ccn_keystore_destroy (&ks);
+    return -1;
+  }
+  if (NULL != h->keystore)
+    ccn_keystore_destroy (&h->keystore);
+  h->keystore = ks;
+  memcpy (h->pubid, ccn_keystore_public_key_digest (ks), sizeof (h->pubid));
+  if (NULL != pubid_out) {
+    pubid_out->length = 0;
+    ccn_charbuf_append (pubid_out, h->pubid, sizeof (h->pubid));
+  }
+  return 0;
+}
+
+int
+ccn_default_pubid (struct ccn *h, struct ccn_signing_params *p)
+{
+  if (NULL == h->keystore)
+    return -1;
+  memcpy (p->pubid, h->pubid, sizeof (p->pubid));
+  return 0;
+}
+
+/**
+ * Encode and sign a content object
+ *
+ * Signed with the key from ccn_load_private_key(); without one the signature bits are zeros,
+ * which is fine since nothing here verifies them.
+ *
+ * \return 0 on success, -1 otherwise
+ */
+int
+ccn_sign_content (struct ccn *h, struct ccn_charbuf *resultbuf,
+    const struct ccn_charbuf *name_prefix,
+    const struct ccn_signing_params *params, const void *data, size_t size)
+{
+  struct ccn_signing_params sp = CCN_SIGNING_PARAMS_INIT;
+  struct ccn_charbuf *signed_info;
+  struct ccn_charbuf *finalblockid = NULL;
+  struct ccn_indexbuf *comps;
+  unsigned char zeros[LOOP_SIGNATURE_SIZE];
+  const unsigned char *cp;
+  size_t sz;
+  int n;
+  int res;
+
+  if (NULL != params)
+    sp = *params;
+  if (sp.sp_flags & CCN_SP_FINAL_BLOCK) {
+    comps = ccn_indexbuf_create ();
+    n = ccn_name_split (name_prefix, comps);
+    if (n > 0 && 0 == ccn_name_comp_get (name_prefix->buf, comps, n - 1, &cp,
+            &sz)) {
+      finalblockid = ccn_charbuf_create ();
+      ccn_charbuf_append (finalblockid, cp, sz);
+    }
+    ccn_indexbuf_destroy (&comps);
+  }
+  signed_info = ccn_charbuf_create ();
+  res = ccn_signed_info_create (signed_info, sp.pubid, sizeof (sp.pubid),
+      NULL, sp.type, sp.freshness, finalblockid, NULL);
+  if (res >= 0 && NULL != h && NULL != h->keystore) {
+    res = ccn_encode_ContentObject (resultbuf, name_prefix, signed_info, data,
+        size, NULL, ccn_keystore_private_key (h->keystore));
+  } else if (res >= 0) {
+    memset (zeros, 0, sizeof (zeros));
+    res |= ccnb_element_begin (resultbuf, CCN_DTAG_ContentObject);
+    res |= ccnb_element_begin (resultbuf, CCN_DTAG_Signature);
+    res |= ccnb_append_tagged_blob (resultbuf, CCN_DTAG_SignatureBits, zeros,
+        sizeof (zeros));
+    res |= ccnb_element_end (resultbuf);        /* </Signature> */
+    res |= ccn_charbuf_append_charbuf (resultbuf, name_prefix);
+    res |= ccn_charbuf_append_charbuf (resultbuf, signed_info);
+    res |= ccnb_append_tagged_blob (resultbuf, CCN_DTAG_Content, data, size);
+    res |= ccnb_element_end (resultbuf);        /* </ContentObject> */
+  }
+  ccn_charbuf_destroy (&finalblockid);
+  ccn_charbuf_destroy (&signed_info);
+  return (res < 0) ? -1 : 0;
+}
@@ -0,0 +1,214 @@
+/** \file encbench.c
+ * \brief Compares the cost of encoding and signing a segment, ccn_sign_content() against segenc
+ *
+ * Run as: encbench [segments]
+ *
+ * The keys are found the same way the plug-in finds them; see loadKey() and fetchStore().
+ * No ccnd is needed, nothing is sent.
+ *
+ * Every segment segenc writes is parsed and its signature checked, outside the timing;
+ * encbench fails if one does not hold. It also fails unless a segment encoded both ways,
+ * from the same name and payload, verifies and carries the same name and content.
+ */
+/*
+ * GStreamer-CCNx, encoder micro benchmark
+ * Copyright (C) 2009, 2010 Alcatel-Lucent Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "conf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "utils.h"
+#include "segenc.h"
+
+/**
+ * Size of the segments we encode; the same as the sink's CCN_CHUNK_SIZE
+ */
+#define BENCH_CHUNK_SIZE 4000
+
+/**
+ * Number of segments encoded when none is given
+ */
+#define BENCH_DEFAULT_SEGMENTS 2000
+
+/**
+ * Nanoseconds since some fixed point
+ */
+static double
+now_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * Checks that an encoded segment parses as a ContentObject and is signed by our key
+ *
+ * \param out		the encoded segment
+ * \param ks		keystore holding the key it should be signed with
+ * \return true if it parsed and the signature verified, false otherwise
+ */
+static int
+check_segment (struct ccn_charbuf *out, struct ccn_keystore *ks)
+{
+  struct ccn_parsed_ContentObject pco;
+
+  if (ccn_parse_ContentObject (out->buf, out->length, &pco, NULL) < 0)
+    return 0;
+  return 1 == ccn_verify_signature (out->buf, out->length, &pco,
+      ccn_keystore_public_key (ks));
+}
+
+/**
+ * Checks that two encoded segments carry the same name and the same content
+ *
+ * \param a		one encoded segment
+ * \param b		the other
+ * \return true if they do, false otherwise or if either does not parse
+ */
+static int
+same_segment (struct ccn_charbuf *a, struct ccn_charbuf *b)
+{
+  struct ccn_parsed_ContentObject pa;
+  struct ccn_parsed_ContentObject pb;
+  const unsigned char *va;
+  const unsigned char *vb;
+  size_t na;
+  size_t nb;
+
+  if (ccn_parse_ContentObject (a->buf, a->length, &pa, NULL) < 0
+      || ccn_parse_ContentObject (b->buf, b->length, &pb, NULL) < 0)
+    return 0;
+  na = pa.offset[CCN_PCO_E_Name] - pa.offset[CCN_PCO_B_Name];
+  nb = pb.offset[CCN_PCO_E_Name] - pb.offset[CCN_PCO_B_Name];
+  if (na != nb || memcmp (a->buf + pa.offset[CCN_PCO_B_Name],
+          b->buf + pb.offset[CCN_PCO_B_Name], na) != 0)
+    return 0;
+  if (ccn_content_get_value (a->buf, a->length, &pa, &va, &na) < 0
+      || ccn_content_get_value (b->buf, b->length, &pb, &vb, &nb) < 0)
+    return 0;
+  return na == nb && 0 == memcmp (va, vb, na);
+}
+
+int
+main (int argc, char *argv[])
+{
+  struct ccn *h;
+  struct ccn_signing_params sp = CCN_SIGNING_PARAMS_INIT;
+  struct ccn_charbuf *prefix;
+  struct ccn_seqname *sn;
+  struct ccn_segenc *enc;
+  struct ccn_keystore *ks;
+  struct ccn_charbuf *out;
+  struct ccn_charbuf *ref;
+  struct ccn_segview views[2];
+  unsigned char data[BENCH_CHUNK_SIZE];
+  double t0;
+  double sign_ns;
+  double segenc_ns;
+  int n;
+  int i;
+
+  n = (argc > 1) ? atoi (argv[1]) : BENCH_DEFAULT_SEGMENTS;
+  if (n <= 0)
+    n = BENCH_DEFAULT_SEGMENTS;
+  for (i = 0; i < BENCH_CHUNK_SIZE; ++i)
+    data[i] = i & 0xff;
+
+  h = ccn_create ();
+  if (NULL == h || loadKey (h, &sp) != 0) {
+    fprintf (stderr, "encbench: could not load the signing keys\n");
+    return 1;
+  }
+  prefix = ccn_charbuf_create ();
+  ccn_name_from_uri (prefix, "ccnx:/gst/bench/encbench");
+  sn = seqname_create (prefix);
+  enc = segenc_create (h, &sp);
+  out = ccn_charbuf_create ();
+  ref = ccn_charbuf_create ();
+  if (NULL == sn || NULL == enc || NULL == out || NULL == ref) {
+    fprintf (stderr, "encbench: out of memory\n");
+    return 1;
+  }
+  if ((ks = fetchStore ()) == NULL) {
+    fprintf (stderr, "encbench: could not open the keystore\n");
+    return 1;
+  }
+
+  /* the way the sink used to do it: one piece, generic encoder */
+  t0 = now_ns ();
+  for (i = 0; i < n; ++i) {
+    out->length = 0;
+    ccn_sign_content (h, out, seqname_encode (sn, i), &sp, data,
+        BENCH_CHUNK_SIZE);
+  }
+  sign_ns = (now_ns () - t0) / n;
+
+  /* the way the sink does it now: a segment straddling two pipeline buffers */
+  views[0].data = data;
+  views[0].size = BENCH_CHUNK_SIZE / 3;
+  views[1].data = data + views[0].size;
+  views[1].size = BENCH_CHUNK_SIZE - views[0].size;
+  segenc_ns = 0;
+  for (i = 0; i < n; ++i) {
+    out->length = 0;
+    t0 = now_ns ();
+    segenc_encode (enc, out, seqname_encode (sn, i), views, 2);
+    segenc_ns += now_ns () - t0;
+    if (!check_segment (out, ks)) {
+      fprintf (stderr, "encbench: segenc segment %d does not verify\n", i);
+      return 1;
+    }
+  }
+  segenc_ns /= n;
+
+  /* both ways, one name and payload: the views must add up to what was signed in one piece */
+  ref->length = 0;
+  ccn_sign_content (h, ref, seqname_encode (sn, n), &sp, data,
+      BENCH_CHUNK_SIZE);
+  out->length = 0;
+  segenc_encode (enc, out, seqname_encode (sn, n), views, 2);
+  if (!check_segment (ref, ks) || !check_segment (out, ks)
+      || !same_segment (ref, out)) {
+    fprintf (stderr, "encbench: the two encoders do not agree on a segment\n");
+    return 1;
+  }
+
+  printf ("segments: %d of %d bytes\n", n, BENCH_CHUNK_SIZE);
+  printf ("ccn_sign_content: %10.0f ns/segment\n", sign_ns);
+  printf ("segenc_encode:    %10.0f ns/segment\n", segenc_ns);
+
+  ccn_keystore_destroy (&ks);
+  ccn_charbuf_destroy (&ref);
+  ccn_charbuf_destroy (&out);
+  segenc_destroy (&enc);
+  seqname_destroy (&sn);
+  ccn_charbuf_destroy (&prefix);
+  ccn_destroy (&h);
+  return 0;
+}
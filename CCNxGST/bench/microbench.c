@@ -0,0 +1,260 @@
+/** \file microbench.c
+ * \brief Times the per-packet code paths of the elements, one function at a time
+ *
+ * Run as: microbench [operations]
+ *
+ * Covers the fifo of each element, the source's reordering of segments through
+ * process_or_queue(), the sink's chunking in gst_ccnxsink_send() with signing stubbed out,
+ * and the segment number parsers of utils.c. Each line gives the time and the number of
+ * heap allocations per operation; the allocations are the calls to malloc() and its kin,
+ * counted here by wrapping them. GLib's slice allocator hides its own from the count,
+ * run with G_SLICE=always-malloc to have those counted as well.
+ * No ccnd is needed, nothing is sent.
+ */
+/*
+ * GStreamer-CCNx, micro benchmarks
+ * Copyright (C) 2009, 2010 Alcatel-Lucent Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "conf.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <gst/gst.h>
+
+#include "utils.h"
+#include "microbench.h"
+
+/**
+ * Number of operations timed when none is given
+ */
+#define BENCH_DEFAULT_OPS 200000
+
+/**
+ * Interest windows the reorder benchmark is run with; the live and reliable defaults of the source
+ */
+static const int bench_windows[] = { 5, 64 };
+
+/**
+ * Pipeline buffer sizes handed to the sink; smaller than, equal to and straddling a segment
+ */
+static const int bench_buffer_sizes[] = { 188, 4000, 4096 };
+
+/**
+ * Number of heap allocations made so far
+ */
+static unsigned long allocs;
+
+#ifdef __GLIBC__
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t n, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+extern void *__libc_memalign (size_t align, size_t size);
+
+/*
+ * Counting wrappers around the allocator; free() is left alone.
+ */
+void *
+malloc (size_t size)
+{
+  allocs++;
+  return __libc_malloc (size);
+}
+
+void *
+calloc (size_t n, size_t size)
+{
+  allocs++;
+  return __libc_calloc (n, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+  allocs++;
+  return __libc_realloc (ptr, size);
+}
+
+void *
+memalign (size_t align, size_t size)
+{
+  allocs++;
+  return __libc_memalign (align, size);
+}
+
+int
+posix_memalign (void **ptr, size_t align, size_t size)
+{
+  allocs++;
+  *ptr = __libc_memalign (align, size);
+  return (NULL == *ptr) ? ENOMEM : 0;
+}
+#endif
+
+/**
+ * Nanoseconds since some fixed point
+ */
+static double
+now_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * Where the measurement of the running benchmark started
+ */
+static double start_ns;
+
+/**
+ * Allocation count when the running benchmark started
+ */
+static unsigned long start_allocs;
+
+/**
+ * Starts measuring a benchmark
+ */
+static void
+bench_start (void)
+{
+  start_allocs = allocs;
+  start_ns = now_ns ();
+}
+
+/**
+ * Stops measuring a benchmark and prints its line
+ *
+ * \param name		what was measured
+ * \param ops		number of operations done
+ */
+static void
+bench_stop (const char *name, int ops)
+{
+  double ns = now_ns () - start_ns;
+  unsigned long n = allocs - start_allocs;
+
+  printf ("%-36s %10.1f ns/op %8.2f allocs/op\n", name, ns / ops,
+      (double) n / ops);
+}
+
+int
+main (int argc, char *argv[])
+{
+  static const char *orders[] = { "in order", "shuffled", "reversed" };
+  struct ccn_charbuf *name;
+  struct ccn_indexbuf *comps;
+  struct ccn_seqname *sn;
+  void *ctx;
+  char label[64];
+  uintmax_t check = 0;
+  int n;
+  int i;
+  int o;
+  int segs;
+
+  gst_init (&argc, &argv);
+  n = (argc > 1) ? atoi (argv[1]) : BENCH_DEFAULT_OPS;
+  if (n <= 0)
+    n = BENCH_DEFAULT_OPS;
+  printf ("operations: %d\n", n);
+
+  ctx = microsrc_create (bench_windows[0]);
+  if (NULL == ctx) {
+    fprintf (stderr, "microbench: could not make a ccnxsrc\n");
+    return 1;
+  }
+  bench_start ();
+  microsrc_fifo (ctx, n);
+  bench_stop ("src fifo_put+fifo_pop", n);
+  microsrc_destroy (ctx);
+
+  for (i = 0; i < G_N_ELEMENTS (bench_windows); ++i) {
+    for (o = MICRO_IN_ORDER; o <= MICRO_REVERSED; ++o) {
+      ctx = microsrc_create (bench_windows[i]);
+      snprintf (label, sizeof (label), "process_or_queue w=%d %s",
+          bench_windows[i], orders[o]);
+      bench_start ();
+      microsrc_reorder (ctx, n, o);
+      bench_stop (label, n);
+      microsrc_destroy (ctx);
+    }
+  }
+
+  ctx = microsink_create ();
+  if (NULL == ctx) {
+    fprintf (stderr, "microbench: could not make a ccnxsink\n");
+    return 1;
+  }
+  bench_start ();
+  microsink_fifo (ctx, n);
+  bench_stop ("sink fifo_put+fifo_pop", n);
+  for (i = 0; i < G_N_ELEMENTS (bench_buffer_sizes); ++i) {
+    snprintf (label, sizeof (label), "gst_ccnxsink_send %d bytes",
+        bench_buffer_sizes[i]);
+    bench_start ();
+    segs = microsink_send (ctx, n, bench_buffer_sizes[i]);
+    bench_stop (label, n);
+    if (segs <= 0)
+      fprintf (stderr, "microbench: the sink made no segments\n");
+  }
+  microsink_destroy (ctx);
+
+  name = ccn_charbuf_create ();
+  comps = ccn_indexbuf_create ();
+  ccn_name_from_uri (name, "ccnx:/gst/bench/microbench");
+
+  /* the name encoder reuses its buffer, so check one name made after another */
+  sn = seqname_create (name);
+  for (i = 1; i <= 2; ++i) {
+    if (NULL == sn || NULL == seqname_encode (sn, i)
+        || ccn_charbuf_fetch_segment (sn->name) != i) {
+      fprintf (stderr, "microbench: seqname_encode broke on name %d\n", i);
+      return 1;
+    }
+  }
+  seqname_destroy (&sn);
+
+  ccn_name_append_numeric (name, CCN_MARKER_SEQNUM, 123456);
+  ccn_name_split (name, comps);
+
+  bench_start ();
+  for (i = 0; i < n; ++i)
+    check += ccn_ccnb_fetch_segment (name->buf, comps);
+  bench_stop ("ccn_ccnb_fetch_segment", n);
+
+  bench_start ();
+  for (i = 0; i < n; ++i)
+    check -= ccn_charbuf_fetch_segment (name);
+  bench_stop ("ccn_charbuf_fetch_segment", n);
+  if (check != 0)
+    fprintf (stderr, "microbench: the segment parsers disagree\n");
+
+  ccn_indexbuf_destroy (&comps);
+  ccn_charbuf_destroy (&name);
+  return 0;
+}
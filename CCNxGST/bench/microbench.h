@@ -0,0 +1,57 @@
+/** \file microbench.h
+ * \brief Entry points microbench uses to reach the static functions of the elements
+ *
+ * microsrc.c and microsink.c each compile one of the element sources whole, so that
+ * its static functions can be called, and export these few wrappers around them.
+ * Each wrapper performs \a n operations and leaves the timing to the caller.
+ */
+/*
+ * GStreamer-CCNx, micro benchmarks
+ * Copyright (C) 2009, 2010 Alcatel-Lucent Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+/**
+ * The order segments are handed to process_or_queue() within a window
+ */
+typedef enum {
+	MICRO_IN_ORDER,			/**< as they were asked for */
+	MICRO_SHUFFLED,			/**< a fixed random permutation */
+	MICRO_REVERSED			/**< last first; every segment but one waits in the array */
+} MicroOrder;
+
+/*
+ * A source element with its fifo and interest array ready, without a ccn connection.
+ */
+void* microsrc_create( int window );
+void microsrc_fifo( void *ctx, int n );
+void microsrc_reorder( void *ctx, int n, MicroOrder order );
+void microsrc_destroy( void *ctx );
+
+/*
+ * A sink element with its fifo and name encoder ready; nothing is signed or sent.
+ * microsink_send() returns the number of segments made.
+ */
+void* microsink_create( void );
+void microsink_fifo( void *ctx, int n );
+int microsink_send( void *ctx, int n, int buffer_size );
+void microsink_destroy( void *ctx );
+
+#endif
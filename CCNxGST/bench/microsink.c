@@ -0,0 +1,160 @@
+/** \file microsink.c
+ * \brief The sink element's fifo and chunking code, wrapped for microbench
+ *
+ * The element source is compiled here whole, so its static functions can be reached.
+ * segenc_encode() and ccn_put() are swapped for the stand-ins below, so what is timed is
+ * the chunking, naming and buffer handling of the sink, without signing or sending.
+ */
+/*
+ * GStreamer-CCNx, micro benchmarks
+ * Copyright (C) 2009, 2010 Alcatel-Lucent Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#define segenc_encode micro_segenc_encode
+#define ccn_put micro_ccn_put
+#include "ccnsink.c"
+
+#include "microbench.h"
+
+/**
+ * Name the benchmark publishes under
+ */
+#define MICRO_SINK_URI "ccnx:/gst/bench/microsink"
+
+/**
+ * Stands in for segenc_encode(), gathering the name and data but signing nothing
+ *
+ * \param enc		unused, no encoder is made
+ * \param out		where the message goes
+ * \param name		name of the segment
+ * \param views		pieces of the segment's data
+ * \param n_views	number of pieces
+ * \return 0 always
+ */
+int
+micro_segenc_encode (struct ccn_segenc *enc, struct ccn_charbuf *out,
+    const struct ccn_charbuf *name, const struct ccn_segview *views,
+    int n_views)
+{
+  int i;
+
+  ccn_charbuf_append_charbuf (out, name);
+  for (i = 0; i < n_views; ++i)
+    ccn_charbuf_append (out, views[i].data, views[i].size);
+  return 0;
+}
+
+/**
+ * Stands in for ccn_put(), sending nothing
+ *
+ * \param h		unused, there is no connection
+ * \param p		the message
+ * \param length	its size
+ * \return 0 always
+ */
+int
+micro_ccn_put (struct ccn *h, const void *p, size_t length)
+{
+  return 0;
+}
+
+/**
+ * Makes a sink element ready for the benchmarks
+ *
+ * \return the element, NULL if it could not be made
+ */
+void *
+microsink_create (void)
+{
+  Gstccnxsink *me;
+
+  me = g_object_new (gst_ccnxsink_get_type (), NULL);
+  if (NULL == me)
+    return NULL;
+  me->name = ccn_charbuf_create ();
+  ccn_name_from_uri (me->name, MICRO_SINK_URI);
+  me->seqname = seqname_create (me->name);
+  me->pool = charbuf_pool_create (CCN_POOL_MAX, CCN_POOL_RESERVE);
+  me->lastPublish = charbuf_pool_get (me->pool);
+  me->fifo_cond = g_cond_new ();
+  me->fifo_lock = g_mutex_new ();
+  return me;
+}
+
+/**
+ * Puts a buffer on the fifo and takes it off again, \a n times
+ *
+ * \param ctx		the element
+ * \param n		number of put and pop pairs
+ */
+void
+microsink_fifo (void *ctx, int n)
+{
+  Gstccnxsink *me = ctx;
+  GstBuffer *buf = gst_buffer_new ();
+  GstClockTime rendered;
+  gint i;
+
+  for (i = 0; i < n; ++i) {
+    fifo_put (me, buf, FALSE, i);
+    fifo_pop (me, &rendered);
+  }
+  gst_buffer_unref (buf);
+}
+
+/**
+ * Hands \a n pipeline buffers to gst_ccnxsink_send()
+ *
+ * The same buffer is sent each time; the sink holds references on it, not copies.
+ *
+ * \param ctx		the element
+ * \param n		number of buffers
+ * \param buffer_size	size of each buffer
+ * \return number of segments published
+ */
+int
+microsink_send (void *ctx, int n, int buffer_size)
+{
+  Gstccnxsink *me = ctx;
+  GstBuffer *buf = gst_buffer_new_and_alloc (buffer_size);
+  long first = me->segment;
+  gint i;
+
+  memset (GST_BUFFER_DATA (buf), 0x5a, buffer_size);
+  for (i = 0; i < n; ++i)
+    gst_ccnxsink_send (me, buf, GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE);
+  release_views (me);
+  gst_buffer_unref (buf);
+  return me->segment - first;
+}
+
+/**
+ * Releases the element
+ *
+ * \param ctx		the element
+ */
+void
+microsink_destroy (void *ctx)
+{
+  Gstccnxsink *me = ctx;
+
+  g_cond_free (me->fifo_cond);
+  g_mutex_free (me->fifo_lock);
+  ccn_charbuf_destroy (&me->name);
+  gst_object_unref (me);
+}
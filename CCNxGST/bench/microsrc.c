@@ -0,0 +1,188 @@
+/** \file microsrc.c
+ * \brief The source element's fifo and reorder code, wrapped for microbench
+ *
+ * The element source is compiled here whole, so its static functions can be reached.
+ * No ccn handle is made; the functions timed never touch the network.
+ */
+/*
+ * GStreamer-CCNx, micro benchmarks
+ * Copyright (C) 2009, 2010 Alcatel-Lucent Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#include "ccnsrc.c"
+
+#include "microbench.h"
+
+/**
+ * Seed of the permutation used for MICRO_SHUFFLED, so every run sees the same order
+ */
+#define MICRO_SHUFFLE_SEED 0x9e3779b97f4a7c15ULL
+
+/**
+ * What the reorder benchmark keeps next to the element
+ */
+typedef struct {
+  Gstccnxsrc *src;              /**< the element under test */
+  guchar *data;                 /**< payload handed in for every segment */
+  size_t size;                  /**< payload size; a window's worth fills one fifo block */
+  gint *perm[3];                /**< delivery order within a window, one per MicroOrder */
+} MicroSrc;
+
+/**
+ * Takes whatever the element has queued off its fifo and drops it
+ *
+ * \param me		element holding the fifo
+ */
+static void
+micro_drain (Gstccnxsrc * me)
+{
+  GstBuffer *buf;
+  GstClockTime arrived;
+
+  while ((buf = fifo_pop (me, &arrived)) != NULL)
+    gst_buffer_unref (buf);
+}
+
+/**
+ * Makes a source element ready for the benchmarks
+ *
+ * The segments are small enough that a window's worth of them fits in one fifo block,
+ * so that no burst of posting can fill the fifo; we only drain it between windows.
+ *
+ * \param window	number of interest slots, and the span segments are reordered over
+ * \return benchmark context, NULL if the element could not be made
+ */
+void *
+microsrc_create (int window)
+{
+  MicroSrc *ms;
+  Gstccnxsrc *me;
+  guint64 x = MICRO_SHUFFLE_SEED;
+  gint i;
+  gint j;
+  gint t;
+
+  me = g_object_new (gst_ccnxsrc_get_type (), NULL);
+  if (NULL == me)
+    return NULL;
+  ms = calloc (1, sizeof (*ms));
+  ms->src = me;
+  ms->size = CCN_CHUNK_SIZE / window;
+  ms->data = calloc (1, ms->size);
+
+  me->window = window;
+  me->intStates = calloc (window, sizeof (CcnxInterestState));
+  for (i = 0; i < window; ++i)
+    me->intStates[i].state = OInterest_idle;
+  me->fifo_cond = g_cond_new ();
+  me->fifo_lock = g_mutex_new ();
+
+  for (i = 0; i < 3; ++i)
+    ms->perm[i] = calloc (window, sizeof (gint));
+  for (i = 0; i < window; ++i) {
+    ms->perm[MICRO_IN_ORDER][i] = i;
+    ms->perm[MICRO_SHUFFLED][i] = i;
+    ms->perm[MICRO_REVERSED][i] = window - 1 - i;
+  }
+  for (i = window - 1; i > 0; --i) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    j = x % (i + 1);
+    t = ms->perm[MICRO_SHUFFLED][i];
+    ms->perm[MICRO_SHUFFLED][i] = ms->perm[MICRO_SHUFFLED][j];
+    ms->perm[MICRO_SHUFFLED][j] = t;
+  }
+  return ms;
+}
+
+/**
+ * Puts a buffer on the fifo and takes it off again, \a n times
+ *
+ * \param ctx		benchmark context
+ * \param n		number of put and pop pairs
+ */
+void
+microsrc_fifo (void *ctx, int n)
+{
+  MicroSrc *ms = ctx;
+  GstBuffer *buf = gst_buffer_new ();
+  GstClockTime arrived;
+  gint i;
+
+  for (i = 0; i < n; ++i) {
+    fifo_put (ms->src, buf, i);
+    fifo_pop (ms->src, &arrived);
+  }
+  gst_buffer_unref (buf);
+}
+
+/**
+ * Hands \a n segments to process_or_queue(), each window of them in the order given
+ *
+ * Every segment of a window has its interest slot taken before any of them arrives,
+ * as it would be once the interests are out. Segments start at one; segment zero
+ * has a special meaning to the element.
+ *
+ * \param ctx		benchmark context
+ * \param n		number of segments, rounded up to whole windows
+ * \param order		order of the segments within each window
+ */
+void
+microsrc_reorder (void *ctx, int n, MicroOrder order)
+{
+  MicroSrc *ms = ctx;
+  Gstccnxsrc *me = ms->src;
+  CcnxInterestState *istate;
+  uintmax_t base;
+  gint i;
+
+  me->post_seg = 1;
+  for (base = 1; base <= n; base += me->window) {
+    for (i = 0; i < me->window; ++i) {
+      istate = allocInterestState (me);
+      istate->seg = base + i;
+      istate->state = OInterest_waiting;
+    }
+    for (i = 0; i < me->window; ++i)
+      process_or_queue (me, base + ms->perm[order][i], ms->data, ms->size,
+          FALSE);
+    micro_drain (me);
+  }
+}
+
+/**
+ * Releases the element and everything the benchmarks made
+ *
+ * \param ctx		benchmark context
+ */
+void
+microsrc_destroy (void *ctx)
+{
+  MicroSrc *ms = ctx;
+  gint i;
+
+  micro_drain (ms->src);
+  g_cond_free (ms->src->fifo_cond);
+  g_mutex_free (ms->src->fifo_lock);
+  gst_object_unref (ms->src);
+  for (i = 0; i < 3; ++i)
+    free (ms->perm[i]);
+  free (ms->data);
+  free (ms);
+}
@@ -0,0 +1,287 @@
+/** \file parsebench.c
+ * \brief Compares the source's old sequence of ccnb lookups on incoming content with ccn_segment_parse()
+ *
+ * Run as: parsebench [file-of-content-objects] [rounds]
+ *
+ * The file holds ccnb encoded ContentObjects back to back, as captured off a ccnd face
+ * or copied out of a repository, or is a capture written by ccnxsrc. Without one, a stream of segments is made and signed
+ * here, using the same keys as the plug-in.
+ * Every object is parsed once up front, as ccn_client does before the upcall;
+ * only what the upcall does afterwards is timed.
+ */
+/*
+ * GStreamer-CCNx, parser micro benchmark
+ * Copyright (C) 2009, 2010 Alcatel-Lucent Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "conf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ccn/coding.h>
+
+#include "utils.h"
+#include "capture.h"
+
+/**
+ * Size of the segments we make when no capture is given; the same as CCN_CHUNK_SIZE
+ */
+#define BENCH_CHUNK_SIZE 4000
+
+/**
+ * Number of segments made when no capture is given
+ */
+#define BENCH_SEGMENTS 256
+
+/**
+ * Times each packet is handled, when not given
+ */
+#define BENCH_DEFAULT_ROUNDS 200
+
+/**
+ * \brief One captured content object, and what the parser found in it
+ */
+typedef struct {
+  struct ccn_charbuf *co;               /**< the encoded object */
+  struct ccn_parsed_ContentObject pco;  /**< parser offsets */
+  struct ccn_indexbuf *comps;           /**< name component index */
+} BenchPacket;
+
+/**
+ * Nanoseconds since some fixed point
+ */
+static double
+now_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * What incoming_content() did with each object before ccn_segment_parse()
+ */
+static int
+old_sequence (BenchPacket * p, uintmax_t * segment, size_t * size)
+{
+  const unsigned char *ccnb = p->co->buf;
+  struct ccn_parsed_ContentObject *pco = &p->pco;
+  struct ccn_indexbuf *cc = p->comps;
+  const unsigned char *cp;
+  size_t sz;
+  const unsigned char *data = NULL;
+  size_t data_size = 0;
+  int b_last = 0;
+  int i;
+
+  *segment = ccn_ccnb_fetch_segment (ccnb, cc);
+  for (i = 0; i < 5; ++i)
+    ccn_name_comp_get (ccnb, cc, i, &cp, &sz);
+  if (ccn_content_get_value (ccnb, pco->offset[CCN_PCO_E], pco, &data,
+          &data_size) < 0)
+    return -1;
+  if (pco->offset[CCN_PCO_B_FinalBlockID] != pco->offset[CCN_PCO_E_FinalBlockID]) {
+    const unsigned char *finalid = NULL;
+    size_t finalid_size = 0;
+    const unsigned char *nameid = NULL;
+    size_t nameid_size = 0;
+    ccn_ref_tagged_BLOB (CCN_DTAG_FinalBlockID, ccnb,
+        pco->offset[CCN_PCO_B_FinalBlockID],
+        pco->offset[CCN_PCO_E_FinalBlockID], &finalid, &finalid_size);
+    ccn_ref_tagged_BLOB (CCN_DTAG_Component, ccnb,
+        cc->buf[cc->n - 2], cc->buf[cc->n - 1], &nameid, &nameid_size);
+    if (finalid_size == nameid_size
+        && 0 == memcmp (finalid, nameid, nameid_size))
+      b_last = 1;
+  }
+  *size = data_size;
+  return b_last;
+}
+
+/**
+ * Parses one object into a packet slot
+ */
+static int
+add_packet (BenchPacket * p, const unsigned char *buf, size_t size)
+{
+  p->co = ccn_charbuf_create ();
+  p->comps = ccn_indexbuf_create ();
+  ccn_charbuf_append (p->co, buf, size);
+  return ccn_parse_ContentObject (p->co->buf, p->co->length, &p->pco,
+      p->comps);
+}
+
+/**
+ * Reads back to back content objects out of a file
+ */
+static int
+load_capture (const char *path, BenchPacket * pkts, int max)
+{
+  struct ccn_charbuf *file = ccn_charbuf_create ();
+  struct ccn_skeleton_decoder sd;
+  struct ccn_capture *cap;
+  unsigned char chunk[8192];
+  uint64_t ns;
+  size_t got;
+  size_t off = 0;
+  int n = 0;
+  FILE *f;
+
+  /* one written by ccnxsrc's capture-location */
+  if ((cap = capture_open (path)) != NULL) {
+    while (n < max && capture_read (cap, &ns, file) > 0)
+      if (add_packet (&pkts[n], file->buf, file->length) >= 0)
+        ++n;
+    capture_close (&cap);
+    ccn_charbuf_destroy (&file);
+    return n;
+  }
+
+  f = fopen (path, "rb");
+  if (NULL == f)
+    return -1;
+  while ((got = fread (chunk, 1, sizeof (chunk), f)) > 0)
+    ccn_charbuf_append (file, chunk, got);
+  fclose (f);
+
+  while (off < file->length && n < max) {
+    memset (&sd, 0, sizeof (sd));
+    ccn_skeleton_decode (&sd, file->buf + off, file->length - off);
+    if (sd.state != 0 || sd.index <= 0)
+      break;                    /* truncated or garbled; keep what we have */
+    if (add_packet (&pkts[n], file->buf + off, sd.index) >= 0)
+      ++n;
+    off += sd.index;
+  }
+  ccn_charbuf_destroy (&file);
+  return n;
+}
+
+/**
+ * Makes and signs a stream of segments, the last one short and carrying the FinalBlockID
+ */
+static int
+make_segments (BenchPacket * pkts, int max)
+{
+  struct ccn *h = ccn_create ();
+  struct ccn_signing_params sp = CCN_SIGNING_PARAMS_INIT;
+  struct ccn_charbuf *prefix = ccn_charbuf_create ();
+  struct ccn_charbuf *co = ccn_charbuf_create ();
+  struct ccn_seqname *sn;
+  unsigned char data[BENCH_CHUNK_SIZE];
+  int i;
+
+  if (NULL == h || loadKey (h, &sp) != 0)
+    return -1;
+  memset (data, 0x5a, sizeof (data));
+  ccn_name_from_uri (prefix, "ccnx:/gst/bench/parsebench");
+  sn = seqname_create (prefix);
+  for (i = 0; i < max; ++i) {
+    co->length = 0;
+    if (i == max - 1)
+      sp.sp_flags |= CCN_SP_FINAL_BLOCK;
+    ccn_sign_content (h, co, seqname_encode (sn, i), &sp, data,
+        (i == max - 1) ? BENCH_CHUNK_SIZE / 2 : BENCH_CHUNK_SIZE);
+    if (add_packet (&pkts[i], co->buf, co->length) < 0)
+      return -1;
+  }
+  seqname_destroy (&sn);
+  ccn_charbuf_destroy (&co);
+  ccn_charbuf_destroy (&prefix);
+  ccn_destroy (&h);
+  return max;
+}
+
+int
+main (int argc, char *argv[])
+{
+  BenchPacket *pkts;
+  struct ccn_segment_info si;
+  int max = 65536;
+  int n;
+  int rounds;
+  int r;
+  int i;
+  uintmax_t segment;
+  size_t size;
+  unsigned long check_old = 0;
+  unsigned long check_new = 0;
+  double t0;
+  double old_ns;
+  double new_ns;
+
+  rounds = (argc > 2) ? atoi (argv[2]) : BENCH_DEFAULT_ROUNDS;
+  if (rounds <= 0)
+    rounds = BENCH_DEFAULT_ROUNDS;
+  pkts = calloc (max, sizeof (*pkts));
+  if (NULL == pkts)
+    return 1;
+  if (argc > 1 && strcmp (argv[1], "-") != 0)
+    n = load_capture (argv[1], pkts, max);
+  else
+    n = make_segments (pkts, BENCH_SEGMENTS);
+  if (n <= 0) {
+    fprintf (stderr, "parsebench: no content objects to work on\n");
+    return 1;
+  }
+
+  t0 = now_ns ();
+  for (r = 0; r < rounds; ++r)
+    for (i = 0; i < n; ++i)
+      if (old_sequence (&pkts[i], &segment, &size) >= 0)
+        check_old += segment + size;
+  old_ns = (now_ns () - t0) / ((double) rounds * n);
+
+  t0 = now_ns ();
+  for (r = 0; r < rounds; ++r)
+    for (i = 0; i < n; ++i)
+      if (ccn_segment_parse (pkts[i].co->buf, &pkts[i].pco, pkts[i].comps,
+              &si) >= 0)
+        check_new += si.segment + si.size;
+  new_ns = (now_ns () - t0) / ((double) rounds * n);
+
+  /* both must have found the same things, or the numbers mean nothing */
+  for (i = 0; i < n; ++i) {
+    int last = old_sequence (&pkts[i], &segment, &size);
+    if (ccn_segment_parse (pkts[i].co->buf, &pkts[i].pco, pkts[i].comps,
+            &si) < 0 || si.segment != segment || si.size != size
+        || si.last != last)
+      fprintf (stderr, "parsebench: packet %d parsed differently\n", i);
+  }
+
+  printf ("packets: %d, rounds: %d\n", n, rounds);
+  printf ("old sequence:      %8.1f ns/packet\n", old_ns);
+  printf ("ccn_segment_parse: %8.1f ns/packet\n", new_ns);
+  if (check_old != check_new)
+    printf ("(checksums differ: %lu %lu)\n", check_old, check_new);
+
+  for (i = 0; i < n; ++i) {
+    ccn_charbuf_destroy (&pkts[i].co);
+    ccn_indexbuf_destroy (&pkts[i].comps);
+  }
+  free (pkts);
+  return 0;
+}
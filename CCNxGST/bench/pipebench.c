@@ -0,0 +1,489 @@
+/** \file pipebench.c
+ * \brief End to end benchmark of a ccnxsink publishing to a ccnxsrc in the same process
+ *
+ * Run as: pipebench plugin-file [seconds]
+ *
+ * The plug-in given should be the loopback build, libgstccnxloop, so the two elements
+ * talk through ccnloop.c rather than a ccnd. For each combination of bit rate, buffer size
+ * and window size in the tables below, two pipelines are run:
+ *
+ *     fakesrc ! ccnxsink		and		ccnxsrc ! fakesink
+ *
+ * The sending side stamps the time into each buffer every BENCH_STAMP_STRIDE bytes; the
+ * receiving side finds the stamps in the byte stream to measure the latency from glass to glass.
+ * Since the stride divides the segment size a skipped segment does not upset the search.
+ *
+ * A second matrix runs one rate and buffer size through each of the impairment profiles
+ * below, which ccnloop.c applies to the content on its way to the source; see CCNLOOP_IMPAIR.
+ *
+ * A last run has ccnxsrc check signatures on its worker pool, verify=offload, and fails,
+ * as does pipebench, unless the pool checked some; that needs the user's keystore, which
+ * ccnxsink signs with.
+ *
+ * The results go to stdout as JSON: sustained Mbit/s, CPU msecs per Mbit moved,
+ * latency percentiles, startup time, time spent stalled and the source's loss counters for every run.
+ */
+/*
+ * GStreamer-CCNx, pipeline benchmark
+ * Copyright (C) 2009, 2010 Alcatel-Lucent Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <gst/gst.h>
+
+#include "histo.h"
+
+/**
+ * Bytes between time stamps in the stream; must divide the segment size and the buffer sizes
+ */
+#define BENCH_STAMP_STRIDE 500
+
+/**
+ * Seconds each run lasts, once data is flowing, when none is given
+ */
+#define BENCH_DEFAULT_SECONDS 5
+
+/**
+ * Msecs the sink is given to publish before the source is started
+ */
+#define BENCH_SINK_HEAD_START 200
+
+/**
+ * Msecs we wait for the first buffer before calling the run a failure
+ */
+#define BENCH_STARTUP_LIMIT 10000
+
+/**
+ * A gap between buffers reaching fakesink at least this many msecs long counts as a stall
+ */
+#define BENCH_STALL_GAP 100
+
+/**
+ * Sending rate of the impaired runs, Mbit/s
+ */
+#define BENCH_IMPAIRED_RATE 8
+
+/**
+ * Buffer size of the impaired runs
+ */
+#define BENCH_IMPAIRED_SIZE 4000
+
+/**
+ * Sending rates tried, in Mbit/s; 0 is as fast as the pipelines go
+ */
+static const guint bench_rates[] = { 0, 2, 8, 32 };
+
+/**
+ * Sizes of the buffers fakesrc makes
+ */
+static const guint bench_sizes[] = { 500, 4000, 16000 };
+
+/**
+ * Values given to ccnxsrc's window-size; 0 leaves it to the source
+ */
+static const gint bench_windows[] = { 0, 5, 20 };
+
+/**
+ * Impairment profiles: a name for the results and the CCNLOOP_IMPAIR value
+ */
+static const struct {
+  const gchar *name;
+  const gchar *impair;
+} bench_profiles[] = {
+  {"loss-1", "loss=0.01"},
+  {"loss-5", "loss=0.05"},
+  {"delay-50", "delay=50,jitter=10"},
+  {"reorder-10", "delay=10,reorder=0.1,hold=20"},
+  {"cap-10", "rate=10"},
+  {"lossy-wan", "loss=0.02,delay=40,jitter=20,reorder=0.05,rate=20"}
+};
+
+/**
+ * What one run measured
+ */
+typedef struct {
+  const gchar *profile;         /**< name of the impairment profile */
+  const gchar *impair;          /**< the impairment, as CCNLOOP_IMPAIR */
+  guint rate_mbit;              /**< sending rate, Mbit/s */
+  guint buffer_size;            /**< fakesrc buffer size */
+  gint window;                  /**< ccnxsrc window-size */
+  const gchar *verify;          /**< ccnxsrc verify, NULL to leave it be */
+  GstClockTime started;         /**< when the source pipeline was started */
+  GstClockTime first;           /**< when the first buffer reached fakesink */
+  GstClockTime last;            /**< when the latest buffer reached fakesink */
+  guint64 bytes;                /**< bytes received after the first buffer */
+  guint64 offset;               /**< bytes received in all, for finding the stamps */
+  guint8 stamp[8];              /**< stamp being gathered, it may straddle buffers */
+  guint64 last_stamp;           /**< last stamp seen, so each buffer is counted once */
+  GstClockTime stalled;         /**< total of the gaps counted as stalls */
+  guint stalls;                 /**< number of them */
+  struct ccn_histo *latency;    /**< glass to glass latencies, nsecs */
+  gdouble cpu_secs;             /**< user and system time used by the run */
+  GstStructure *src_stats;      /**< ccnxsrc's counters at the end of the run */
+  gchar *error;                 /**< first error posted, NULL if none */
+} BenchRun;
+
+/**
+ * CPU seconds used by the process so far
+ */
+static gdouble
+cpu_seconds (void)
+{
+  struct rusage ru;
+
+  getrusage (RUSAGE_SELF, &ru);
+  return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec
+      + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+/**
+ * fakesrc handoff: stamp the time into the buffer every BENCH_STAMP_STRIDE bytes
+ */
+static void
+stamp_buffer (GstElement * fakesrc, GstBuffer * buf, GstPad * pad,
+    gpointer user_data)
+{
+  guint64 now = gst_util_get_timestamp ();
+  guint i;
+
+  for (i = 0; i + sizeof (now) <= GST_BUFFER_SIZE (buf);
+      i += BENCH_STAMP_STRIDE)
+    memcpy (GST_BUFFER_DATA (buf) + i, &now, sizeof (now));
+}
+
+/**
+ * fakesink handoff: count the bytes and record the latency of each stamp found
+ */
+static void
+read_buffer (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    gpointer user_data)
+{
+  BenchRun *run = user_data;
+  GstClockTime now = gst_util_get_timestamp ();
+  const guint8 *p = GST_BUFFER_DATA (buf);
+  guint n = GST_BUFFER_SIZE (buf);
+  guint64 stamp;
+  guint i = 0;
+  guint k;
+  guint take;
+
+  if (GST_CLOCK_TIME_NONE == run->first)
+    run->first = now;
+  else {
+    run->bytes += n;
+    if (now - run->last >= BENCH_STALL_GAP * GST_MSECOND) {
+      run->stalled += now - run->last;
+      run->stalls++;
+    }
+  }
+  run->last = now;
+
+  while (i < n) {
+    k = (run->offset + i) % BENCH_STAMP_STRIDE;
+    if (k >= sizeof (stamp)) {
+      i += BENCH_STAMP_STRIDE - k;
+      continue;
+    }
+    take = MIN (sizeof (stamp) - k, n - i);
+    memcpy (run->stamp + k, p + i, take);
+    i += take;
+    if (k + take < sizeof (stamp))
+      continue;
+    memcpy (&stamp, run->stamp, sizeof (stamp));
+    if (stamp != run->last_stamp && stamp <= now) {
+      histo_record (run->latency, now - stamp);
+      run->last_stamp = stamp;
+    }
+  }
+  run->offset += n;
+}
+
+/**
+ * Pick up the first error either pipeline has posted
+ */
+static void
+check_bus (GstElement * pipeline, BenchRun * run, GstClockTime wait)
+{
+  GstBus *bus;
+  GstMessage *msg;
+  GError *err = NULL;
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, wait, GST_MESSAGE_ERROR);
+  if (NULL != msg) {
+    gst_message_parse_error (msg, &err, NULL);
+    if (NULL == run->error)
+      run->error = g_strdup (err->message);
+    g_error_free (err);
+    gst_message_unref (msg);
+  }
+  gst_object_unref (bus);
+}
+
+/**
+ * Run one combination of rate, buffer size and window
+ *
+ * \param run		says what to run, and gets the results
+ * \param index		makes the name published unique to the run
+ * \param seconds		how long data should flow
+ */
+static void
+bench_run (BenchRun * run, guint index, guint seconds)
+{
+  GstElement *sender;
+  GstElement *receiver;
+  GstElement *e;
+  gchar *desc;
+  GstClockTime until;
+  gdouble cpu0;
+
+  /* ccnloop.c reads this when the elements create their handles */
+  g_setenv ("CCNLOOP_IMPAIR", run->impair, TRUE);
+  desc = g_strdup_printf ("fakesrc name=src is-live=TRUE sizetype=fixed"
+      " sizemax=%u datarate=%u sync=%s signal-handoffs=TRUE"
+      " ! ccnxsink uri=ccnx:/gst/bench/pipe/%u", run->buffer_size,
+      run->rate_mbit * 125000, run->rate_mbit ? "TRUE" : "FALSE", index);
+  sender = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  desc = g_strdup_printf ("ccnxsrc name=src uri=ccnx:/gst/bench/pipe/%u"
+      " window-size=%d%s%s ! fakesink name=sink sync=FALSE signal-handoffs=TRUE",
+      index, run->window, run->verify ? " verify=" : "",
+      run->verify ? run->verify : "");
+  receiver = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  if (NULL == sender || NULL == receiver) {
+    run->error = g_strdup ("could not build the pipelines");
+    if (NULL != sender)
+      gst_object_unref (sender);
+    if (NULL != receiver)
+      gst_object_unref (receiver);
+    return;
+  }
+
+  e = gst_bin_get_by_name (GST_BIN (sender), "src");
+  g_signal_connect (e, "handoff", G_CALLBACK (stamp_buffer), run);
+  gst_object_unref (e);
+  e = gst_bin_get_by_name (GST_BIN (receiver), "sink");
+  g_signal_connect (e, "handoff", G_CALLBACK (read_buffer), run);
+  gst_object_unref (e);
+
+  run->first = GST_CLOCK_TIME_NONE;
+  cpu0 = cpu_seconds ();
+  gst_element_set_state (sender, GST_STATE_PLAYING);
+  check_bus (sender, run, BENCH_SINK_HEAD_START * GST_MSECOND);
+  run->started = gst_util_get_timestamp ();
+  gst_element_set_state (receiver, GST_STATE_PLAYING);
+
+  until = run->started + BENCH_STARTUP_LIMIT * GST_MSECOND;
+  while (NULL == run->error && gst_util_get_timestamp () < until) {
+    if (GST_CLOCK_TIME_NONE != run->first)
+      until = run->first + seconds * GST_SECOND;
+    check_bus (sender, run, 0);
+    check_bus (receiver, run, 100 * GST_MSECOND);
+  }
+  if (NULL == run->error && GST_CLOCK_TIME_NONE == run->first)
+    run->error = g_strdup ("no data arrived");
+
+  e = gst_bin_get_by_name (GST_BIN (receiver), "src");
+  g_object_get (e, "stats", &run->src_stats, NULL);
+  gst_object_unref (e);
+  gst_element_set_state (receiver, GST_STATE_NULL);
+  gst_element_set_state (sender, GST_STATE_NULL);
+  run->cpu_secs = cpu_seconds () - cpu0;
+  gst_object_unref (receiver);
+  gst_object_unref (sender);
+}
+
+/**
+ * Fetch one of ccnxsrc's counters, 0 if it is not there
+ */
+static guint64
+src_counter (const BenchRun * run, const gchar * name)
+{
+  guint64 v = 0;
+
+  if (NULL != run->src_stats)
+    gst_structure_get_uint64 (run->src_stats, name, &v);
+  return v;
+}
+
+/**
+ * Write a string as a quoted JSON string
+ *
+ * g_strescape() will not do: it writes octal escapes, which JSON does not have.
+ * Bytes from 0x80 up are left alone, GStreamer's messages being UTF-8.
+ */
+static void
+print_json_string (const gchar * str)
+{
+  const guchar *p;
+
+  putchar ('"');
+  for (p = (const guchar *) str; *p; ++p) {
+    if ('"' == *p || '\\' == *p)
+      printf ("\\%c", *p);
+    else if ('\n' == *p)
+      fputs ("\\n", stdout);
+    else if ('\t' == *p)
+      fputs ("\\t", stdout);
+    else if (*p < 0x20 || 0x7f == *p)
+      printf ("\\u%04x", *p);
+    else
+      putchar (*p);
+  }
+  putchar ('"');
+}
+
+/**
+ * Write one run's results as a JSON object
+ */
+static void
+print_run (const BenchRun * run, gboolean last)
+{
+  gdouble secs = 0;
+  gdouble mbit = run->bytes * 8 / 1e6;
+
+  if (GST_CLOCK_TIME_NONE != run->first && run->last > run->first)
+    secs = (gdouble) (run->last - run->first) / GST_SECOND;
+  printf ("    {\"profile\": \"%s\", \"impair\": \"%s\",\n", run->profile,
+      run->impair);
+  printf ("     \"rate_mbit\": %u, \"buffer_size\": %u, \"window_size\": %d,\n",
+      run->rate_mbit, run->buffer_size, run->window);
+  printf ("     \"mbit_per_s\": %.3f, \"cpu_ms_per_mbit\": %.3f,",
+      secs > 0 ? mbit / secs : 0.0, mbit > 0 ? run->cpu_secs * 1e3 / mbit : 0.0);
+  printf (" \"startup_ms\": %.3f,\n", GST_CLOCK_TIME_NONE == run->first ? -1.0
+      : (gdouble) (run->first - run->started) / GST_MSECOND);
+  printf ("     \"stall_ms\": %.3f, \"stalls\": %u,\n",
+      (gdouble) run->stalled / GST_MSECOND, run->stalls);
+  printf ("     \"latency_ms\": {\"samples\": %" G_GUINT64_FORMAT
+      ", \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f},\n",
+      run->latency->total,
+      (gdouble) histo_percentile (run->latency, 0.50) / GST_MSECOND,
+      (gdouble) histo_percentile (run->latency, 0.90) / GST_MSECOND,
+      (gdouble) histo_percentile (run->latency, 0.99) / GST_MSECOND,
+      (gdouble) run->latency->max / GST_MSECOND);
+  printf ("     \"segments\": %" G_GUINT64_FORMAT ", \"skipped\": %"
+      G_GUINT64_FORMAT ", \"timeouts\": %" G_GUINT64_FORMAT ",",
+      src_counter (run, "segments"), src_counter (run, "skipped"),
+      src_counter (run, "timeouts"));
+  if (NULL != run->error) {
+    fputs (" \"error\": ", stdout);
+    print_json_string (run->error);
+    printf ("}%s\n", last ? "" : ",");
+  } else
+    printf (" \"error\": null}%s\n", last ? "" : ",");
+}
+
+/**
+ * Run one combination and write out its results
+ *
+ * A run offloading its signature checks fails if the worker pool did not check any.
+ *
+ * \param verify	ccnxsrc's verify, NULL to leave it be
+ * \param last		true for the last run, which is not followed by a comma
+ * \return true if the run went without error
+ */
+static gboolean
+bench_one (const gchar * profile, const gchar * impair, guint rate_mbit,
+    guint buffer_size, gint window, const gchar * verify, guint index,
+    guint seconds, gboolean last)
+{
+  BenchRun run;
+  gboolean ok;
+
+  memset (&run, 0, sizeof (run));
+  run.profile = profile;
+  run.impair = impair;
+  run.rate_mbit = rate_mbit;
+  run.buffer_size = buffer_size;
+  run.window = window;
+  run.verify = verify;
+  run.latency = g_new0 (struct ccn_histo, 1);
+  histo_clear (run.latency);
+  bench_run (&run, index, seconds);
+  if (NULL == run.error && NULL != verify && 0 == strcmp (verify, "offload")
+      && 0 == src_counter (&run, "offloaded"))
+    run.error = g_strdup ("no signature was checked by the worker pool");
+  ok = NULL == run.error;
+  print_run (&run, last);
+  fflush (stdout);
+  if (NULL != run.src_stats)
+    gst_structure_free (run.src_stats);
+  g_free (run.latency);
+  g_free (run.error);
+  return ok;
+}
+
+int
+main (int argc, char *argv[])
+{
+  GError *err = NULL;
+  GstPlugin *plugin;
+  guint seconds;
+  guint total;
+  guint n = 0;
+  guint r, s, w, p;
+  gboolean ok;
+
+  gst_init (&argc, &argv);
+  if (argc < 2) {
+    fprintf (stderr, "usage: pipebench plugin-file [seconds]\n");
+    return 1;
+  }
+  plugin = gst_plugin_load_file (argv[1], &err);
+  if (NULL == plugin) {
+    fprintf (stderr, "pipebench: %s\n", err->message);
+    g_error_free (err);
+    return 1;
+  }
+  seconds = (argc > 2) ? atoi (argv[2]) : BENCH_DEFAULT_SECONDS;
+  if (seconds == 0)
+    seconds = BENCH_DEFAULT_SECONDS;
+  total = G_N_ELEMENTS (bench_rates) * G_N_ELEMENTS (bench_sizes)
+      * G_N_ELEMENTS (bench_windows)
+      + G_N_ELEMENTS (bench_profiles) * G_N_ELEMENTS (bench_windows) + 1;
+
+  printf ("{\n  \"benchmark\": \"pipebench\",\n  \"seconds\": %u,\n"
+      "  \"runs\": [\n", seconds);
+  for (r = 0; r < G_N_ELEMENTS (bench_rates); ++r)
+    for (s = 0; s < G_N_ELEMENTS (bench_sizes); ++s)
+      for (w = 0; w < G_N_ELEMENTS (bench_windows); ++w, ++n)
+        bench_one ("clean", "", bench_rates[r], bench_sizes[s],
+            bench_windows[w], NULL, n, seconds, n + 1 == total);
+  for (p = 0; p < G_N_ELEMENTS (bench_profiles); ++p)
+    for (w = 0; w < G_N_ELEMENTS (bench_windows); ++w, ++n)
+      bench_one (bench_profiles[p].name, bench_profiles[p].impair,
+          BENCH_IMPAIRED_RATE, BENCH_IMPAIRED_SIZE, bench_windows[w], NULL, n,
+          seconds, n + 1 == total);
+  ok = bench_one ("verify-offload", "", BENCH_IMPAIRED_RATE,
+      BENCH_IMPAIRED_SIZE, 0, "offload", n, seconds, TRUE);
+  printf ("  ]\n}\n");
+  gst_object_unref (plugin);
+  if (!ok)
+    fprintf (stderr, "pipebench: signatures were not offloaded\n");
+  return ok ? 0 : 1;
+}